@@ -0,0 +1,107 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace hip {
+
+//! Streams in the capture mode. The streams are kept under the locks, but the numbers of
+//! the streams are atomic, hence the capture checks of the API calls don't take the global
+//! locks when no stream is capturing. The class doesn't depend on the stream type,
+//! so the bookkeeping can be measured on the host with stand-in streams.
+template <typename Stream, typename Lock> class CaptureStreams {
+ public:
+  //! Registers the stream, which begins the capture. The global mode streams are also
+  //! invalidated by the unsafe API calls on any thread
+  void Add(Stream* stream, bool global) {
+    if (global) {
+      std::lock_guard<Lock> lock(global_lock_);
+      global_.push_back(stream);
+      num_global_.store(static_cast<uint32_t>(global_.size()), std::memory_order_release);
+    }
+    std::lock_guard<Lock> lock(lock_);
+    streams_.insert(stream);
+    num_streams_.store(static_cast<uint32_t>(streams_.size()), std::memory_order_release);
+  }
+
+  //! Unregisters the stream. Returns true if the stream was capturing
+  bool Remove(Stream* stream) {
+    if (num_global_.load(std::memory_order_acquire) != 0) {
+      std::lock_guard<Lock> lock(global_lock_);
+      auto it = std::find(global_.begin(), global_.end(), stream);
+      if (it != global_.end()) {
+        global_.erase(it);
+        num_global_.store(static_cast<uint32_t>(global_.size()), std::memory_order_release);
+      }
+    }
+    if (num_streams_.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    std::lock_guard<Lock> lock(lock_);
+    if (streams_.erase(stream) == 0) {
+      return false;
+    }
+    num_streams_.store(static_cast<uint32_t>(streams_.size()), std::memory_order_release);
+    return true;
+  }
+
+  //! Calls the functor for every global mode stream. Returns true if any stream was found
+  template <typename F> bool ForEachGlobal(F func) {
+    if (num_global_.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    std::lock_guard<Lock> lock(global_lock_);
+    for (auto stream : global_) {
+      func(stream);
+    }
+    return !global_.empty();
+  }
+
+  //! Calls the functor for every capturing stream. Returns true if any stream was found
+  template <typename F> bool ForEach(F func) {
+    if (num_streams_.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    std::lock_guard<Lock> lock(lock_);
+    for (auto stream : streams_) {
+      func(stream);
+    }
+    return !streams_.empty();
+  }
+
+  //! Returns true if any stream captures in the global mode. Lock-free
+  bool HasGlobal() const { return num_global_.load(std::memory_order_acquire) != 0; }
+
+ private:
+  Lock global_lock_;                      //!< Guards the global mode streams
+  std::vector<Stream*> global_;           //!< Streams, capturing in the global mode
+  std::atomic<uint32_t> num_global_{0};   //!< Number of the global mode streams
+  Lock lock_;                             //!< Guards all capturing streams
+  std::unordered_set<Stream*> streams_;   //!< Streams, capturing in any mode
+  std::atomic<uint32_t> num_streams_{0};  //!< Number of the capturing streams
+};
+
+}  // namespace hip
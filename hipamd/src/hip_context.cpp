@@ -40,7 +40,9 @@ amd::Context* host_context = nullptr;
 // init() is only to be called from the HIP_INIT macro only once
 void init(bool* status) {
   amd::IS_HIP = true;
-  GPU_NUM_MEM_DEPENDENCY = 0;
+  // HIP stream order covers the memory, accessed indirectly by the kernels, hence
+  // the dependency tracking on the kernel arguments is available only on request
+  GPU_NUM_MEM_DEPENDENCY = flagIsDefault(GPU_NUM_MEM_DEPENDENCY) ? 0 : GPU_NUM_MEM_DEPENDENCY;
 #if DISABLE_DIRECT_DISPATCH
   constexpr bool kDirectDispatch = false;
 #else
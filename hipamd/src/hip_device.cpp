@@ -154,6 +154,8 @@ void Device::Reset() {
     mem_pools_.clear();
   }
   flags_ = hipDeviceScheduleSpin;
+  // The cached graph execs hold the streams and the memory of the device
+  ihipReleaseGraphExecCache();
   destroyAllStreams();
   amd::MemObjMap::Purge(devices()[0]);
   Create();
@@ -329,6 +331,7 @@ Device::~Device() {
 }
 
 void ihipDestroyDevice() {
+  ihipReleaseGraphExecCache();
   for (auto deviceHandle : g_devices) {
     delete deviceHandle;
   }
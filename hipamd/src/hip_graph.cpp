@@ -28,12 +28,37 @@
 
 namespace hip {
 
-std::vector<hip::Stream*> g_captureStreams;
-// StreamCaptureGlobalList lock
-amd::Monitor g_captureStreamsLock{};
-// StreamCaptureset lock
-amd::Monitor g_streamSetLock{};
-std::unordered_set<hip::Stream*> g_allCapturingStreams;
+CaptureStreams<hip::Stream, amd::Monitor> g_captureStreams;
+
+// ================================================================================================
+void AddCapturingStream(hip::Stream* stream, hipStreamCaptureMode mode) {
+  stream->GetCaptureGraph()->AddCaptureStream();
+  g_captureStreams.Add(stream, mode == hipStreamCaptureModeGlobal);
+}
+
+// ================================================================================================
+void RemoveCapturingStream(hip::Stream* stream, hip::Graph* graph) {
+  // The application could destroy the graph, provided in hipStreamBeginCaptureToGraph()
+  if (g_captureStreams.Remove(stream) && (graph != nullptr) && hip::Graph::isGraphValid(graph)) {
+    graph->RemoveCaptureStream();
+  }
+}
+
+// ================================================================================================
+bool InvalidateGlobalCaptureStreams() {
+  // Single stream captures in the thread local or relaxed modes don't take the global lock
+  return g_captureStreams.ForEachGlobal([](hip::Stream* stream) {
+    stream->SetCaptureStatus(hipStreamCaptureStatusInvalidated);
+  });
+}
+
+// ================================================================================================
+bool InvalidateAllCapturingStreams() {
+  return g_captureStreams.ForEach([](hip::Stream* stream) {
+    stream->SetCaptureStatus(hipStreamCaptureStatusInvalidated);
+  });
+}
+
 hipError_t ihipGraphDebugDotPrint(hipGraph_t graph, const char* path, unsigned int flags);
 hipError_t ihipStreamUpdateCaptureDependencies(hipStream_t stream, hipGraphNode_t* dependencies,
                                                size_t numDependencies, unsigned int flags);
@@ -67,16 +92,8 @@ inline hipError_t ihipGraphAddNode(hip::GraphNode* graphNode, hip::Graph* graph,
     DuplicateDep.insert(pDependencies[i]);
     pDependencies[i]->AddEdgeDep(graphNode);
   }
-  if (capture == false) {
-    {
-      amd::ScopedLock lock(g_streamSetLock);
-      for (auto stream : g_allCapturingStreams) {
-        if (stream->GetCaptureGraph() == graph) {
-          graph->AddManualNodeDuringCapture(graphNode);
-          break;
-        }
-      }
-    }
+  if (capture == false && graph->IsCaptureTarget()) {
+    graph->AddManualNodeDuringCapture(graphNode);
   }
   return hipSuccess;
 }
@@ -1098,14 +1115,7 @@ hipError_t hipStreamBeginCapture_common(hipStream_t stream, hipStreamCaptureMode
   if (mode != hipStreamCaptureModeRelaxed) {
     hip::tls.capture_streams_.push_back(s);
   }
-  if (mode == hipStreamCaptureModeGlobal) {
-    amd::ScopedLock lock(g_captureStreamsLock);
-    g_captureStreams.push_back(s);
-  }
-  {
-    amd::ScopedLock lock(g_streamSetLock);
-    g_allCapturingStreams.insert(s);
-  }
+  hip::AddCapturingStream(s, mode);
   return hipSuccess;
 }
 
@@ -1179,15 +1189,7 @@ hipError_t hipStreamEndCapture_common(hipStream_t stream, hip::Graph** pGraph) {
     }
     hip::tls.capture_streams_.erase(it);
   }
-  if (s->GetCaptureMode() == hipStreamCaptureModeGlobal) {
-    amd::ScopedLock lock(g_captureStreamsLock);
-    g_captureStreams.erase(std::find(g_captureStreams.begin(), g_captureStreams.end(), s));
-  }
-  {
-    amd::ScopedLock lock(g_streamSetLock);
-    g_allCapturingStreams.erase(
-        std::find(g_allCapturingStreams.begin(), g_allCapturingStreams.end(), s));
-  }
+  hip::RemoveCapturingStream(s, s->GetCaptureGraph());
   // If capture was invalidated, due to a violation of the rules of stream capture
   if (s->GetCaptureStatus() == hipStreamCaptureStatusInvalidated) {
     *pGraph = nullptr;
@@ -1470,6 +1472,109 @@ hipError_t hipGraphAddChildGraphNode(hipGraphNode_t* pGraphNode, hipGraph_t grap
   HIP_RETURN(status);
 }
 
+hipError_t ihipGraphExecUpdate(hip::GraphExec* graphExec, hip::Graph* graph,
+                               hipGraphNode_t* hErrorNode_out,
+                               hipGraphExecUpdateResult* updateResult_out,
+                               bool remapClonedNodes = false) {
+  std::vector<hip::GraphNode*> newGraphNodes;
+  graph->TopologicalOrder(newGraphNodes);
+  std::vector<hip::GraphNode*>& oldGraphExecNodes = graphExec->GetNodes();
+  if (newGraphNodes.size() != oldGraphExecNodes.size()) {
+    *updateResult_out = hipGraphExecUpdateErrorTopologyChanged;
+    *hErrorNode_out = nullptr;
+    return hipErrorGraphExecUpdateFailure;
+  }
+
+  // Match the nodes by the structure, so an equivalent graph captured in a different order
+  // can still be updated
+  std::vector<hip::GraphNode*> matchedNodes;
+  hip::GraphNode* errorNode = nullptr;
+  if (!graphExec->MatchNodes(newGraphNodes, &matchedNodes, &errorNode)) {
+    // Report the difference with the node at the same topological position
+    size_t i = std::find(newGraphNodes.begin(), newGraphNodes.end(), errorNode) -
+        newGraphNodes.begin();
+    *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(errorNode);
+    *updateResult_out = (errorNode->GetType() != oldGraphExecNodes[i]->GetType())
+        ? hipGraphExecUpdateErrorNodeTypeChanged
+        : hipGraphExecUpdateErrorTopologyChanged;
+    return hipErrorGraphExecUpdateFailure;
+  }
+
+  hip::GraphExec::UpdateStats& stats = graphExec->GetUpdateStats();
+  for (std::vector<hip::GraphNode*>::size_type i = 0; i != newGraphNodes.size(); i++) {
+    hip::GraphNode* oldGraphExecNode = matchedNodes[i];
+    // Checks if all the node types are same before updating
+    if (newGraphNodes[i]->GetType() == oldGraphExecNode->GetType()) {
+      if (newGraphNodes[i]->GetType() != hipGraphNodeTypeHost &&
+          newGraphNodes[i]->GetType() != hipGraphNodeTypeEmpty) {
+        if (newGraphNodes[i]->GetParentGraph()->Device() !=
+            oldGraphExecNode->GetParentGraph()->Device()) {
+          *updateResult_out = hipGraphExecUpdateErrorUnsupportedFunctionChange;
+          *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
+          return hipErrorGraphExecUpdateFailure;
+        }
+      }
+
+      if (newGraphNodes[i]->GetType() == hipGraphNodeTypeMemcpy) {
+        // Checks if the memcpy node's parameters are same
+        const hip::GraphMemcpyNode* newMemcpyNode =
+            static_cast<hip::GraphMemcpyNode const*>(newGraphNodes[i]);
+        const hip::GraphMemcpyNode* oldMemcpyNode =
+            static_cast<hip::GraphMemcpyNode const*>(oldGraphExecNode);
+        hipMemcpyKind newKind, oldKind;
+        newKind = newMemcpyNode->GetMemcpyKind();
+        oldKind = oldMemcpyNode->GetMemcpyKind();
+        if (newKind != oldKind) {
+          *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
+          *updateResult_out = hipGraphExecUpdateErrorParametersChanged;
+          return hipErrorGraphExecUpdateFailure;
+        }
+      }
+      // A recycled exec must not keep the node state of its previous user
+      const bool stateChanged =
+          remapClonedNodes && oldGraphExecNode->RefreshState(newGraphNodes[i]);
+      // Skip the nodes without any changes, so the packets are not recaptured
+      if (!stateChanged && oldGraphExecNode->IsParamsEqual(newGraphNodes[i])) {
+        continue;
+      }
+      stats.nodes_touched_++;
+
+      hipError_t status = oldGraphExecNode->SetParams(newGraphNodes[i]);
+      if (status != hipSuccess) {
+        *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
+        if (status == hipErrorInvalidDeviceFunction) {
+          *updateResult_out = hipGraphExecUpdateErrorUnsupportedFunctionChange;
+        } else if (status == hipErrorInvalidValue || status == hipErrorInvalidDevicePointer) {
+          *updateResult_out = hipGraphExecUpdateErrorParametersChanged;
+        } else {
+          *updateResult_out = hipGraphExecUpdateErrorNotSupported;
+        }
+        return hipErrorGraphExecUpdateFailure;
+      } else if (DEBUG_CLR_GRAPH_PACKET_CAPTURE && newGraphNodes[i]->GraphCaptureEnabled()) {
+        status = graphExec->UpdateAQLPacket(oldGraphExecNode);
+        stats.packets_rewritten_++;
+      }
+    } else {
+      *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
+      *updateResult_out = hipGraphExecUpdateErrorNodeTypeChanged;
+      return hipErrorGraphExecUpdateFailure;
+    }
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE,
+          "[hipGraph] Exec update: nodes %zu, reordered %u, touched %u, packets rewritten %u",
+          newGraphNodes.size(), stats.nodes_reordered_, stats.nodes_touched_,
+          stats.packets_rewritten_);
+  if (remapClonedNodes) {
+    // The exec is reused for the new graph, hence the node handles of the new graph
+    // must resolve into the exec nodes
+    graphExec->RemapClonedNodes(graph, newGraphNodes, matchedNodes);
+  }
+  *updateResult_out = hipGraphExecUpdateSuccess;
+  return hipSuccess;
+}
+
+void ihipReleaseGraphExecCache() { hip::GraphExec::ReleaseCachedExecs(); }
+
 hipError_t ihipGraphInstantiate(hip::GraphExec** pGraphExec, hip::Graph* graph,
                                 uint64_t flags = 0) {
   if (pGraphExec == nullptr || graph == nullptr) {
@@ -1483,15 +1588,43 @@ hipError_t ihipGraphInstantiate(hip::GraphExec** pGraphExec, hip::Graph* graph,
       }
     }
   }
+  uint64_t fingerprint = 0;
+  if (DEBUG_HIP_GRAPH_INSTANTIATE_CACHE > 0) {
+    fingerprint = graph->Fingerprint(flags);
+    hip::GraphExec* cachedExec = hip::GraphExec::TakeCachedExec(fingerprint);
+    if (cachedExec != nullptr) {
+      // Refresh the node parameters of the cached exec instead of the full instantiation
+      hipGraphNode_t errorNode = nullptr;
+      hipGraphExecUpdateResult updateResult;
+      if (ihipGraphExecUpdate(cachedExec, graph, &errorNode, &updateResult, true) ==
+          hipSuccess) {
+        graph->SetGraphInstantiated(true);
+        // The exec handle becomes valid again
+        hip::GraphExec::graphExecHandles_.Insert(cachedExec);
+        *pGraphExec = cachedExec;
+        return hipSuccess;
+      }
+      ClPrint(amd::LOG_INFO, amd::LOG_CODE, "[hipGraph] Cached exec %p refresh failed: %d",
+              cachedExec, updateResult);
+      cachedExec->release();
+    }
+  }
   *pGraphExec = new hip::GraphExec(flags);
   if (*pGraphExec == nullptr) {
     return hipErrorOutOfMemory;
   }
+  (*pGraphExec)->SetFingerprint(fingerprint);
   graph->clone(*pGraphExec, true);
+  if (DEBUG_HIP_GRAPH_TRANSITIVE_REDUCTION) {
+    // Redundant edges add cross-stream signals and waits, the user graph keeps all edges
+    (*pGraphExec)->ReduceTransitiveEdges();
+  }
   (*pGraphExec)->ScheduleNodes();
   if (false == (*pGraphExec)->TopologicalOrder()) {
     return hipErrorInvalidValue;
   }
+  (*pGraphExec)->FuseBlitNodes();
+  (*pGraphExec)->PlanMemoryAliasing();
   graph->SetGraphInstantiated(true);
   if (DEBUG_HIP_GRAPH_DOT_PRINT) {
     static int i = 1;
@@ -1584,9 +1717,11 @@ hipError_t hipGraphExecDestroy(hipGraphExec_t pGraphExec) {
     HIP_RETURN(hipErrorInvalidValue);
   }
   hip::GraphExec* ge = reinterpret_cast<hip::GraphExec*>(pGraphExec);
-  ge->release();
-  amd::ScopedLock lock(GraphExec::graphExecSetLock_);
-  GraphExec::graphExecSet_.erase(ge);
+  GraphExec::graphExecHandles_.Erase(ge);
+  // Keep the exec for the instantiation of the same graph, otherwise release it
+  if (!hip::GraphExec::CacheExec(ge)) {
+    ge->release();
+  }
   HIP_RETURN(hipSuccess);
 }
 
@@ -2649,79 +2784,10 @@ hipError_t hipGraphExecUpdate(hipGraphExec_t hGraphExec, hipGraph_t hGraph,
     HIP_RETURN(hipErrorInvalidValue);
   }
 
-  std::vector<hip::GraphNode*> newGraphNodes;
-  reinterpret_cast<hip::Graph*>(hGraph)->TopologicalOrder(newGraphNodes);
-  std::vector<hip::GraphNode*>& oldGraphExecNodes =
-      reinterpret_cast<hip::GraphExec*>(hGraphExec)->GetNodes();
-  if (newGraphNodes.size() != oldGraphExecNodes.size()) {
-    *updateResult_out = hipGraphExecUpdateErrorTopologyChanged;
-    *hErrorNode_out = nullptr;
-    HIP_RETURN(hipErrorGraphExecUpdateFailure);
-  }
-
-  for (std::vector<hip::GraphNode*>::size_type i = 0; i != newGraphNodes.size(); i++) {
-    // Checks if all the node types are same before updating
-    if (newGraphNodes[i]->GetType() == oldGraphExecNodes[i]->GetType()) {
-      if (newGraphNodes[i]->GetType() != hipGraphNodeTypeHost &&
-          newGraphNodes[i]->GetType() != hipGraphNodeTypeEmpty) {
-        if (newGraphNodes[i]->GetParentGraph()->Device() !=
-            oldGraphExecNodes[i]->GetParentGraph()->Device()) {
-          *updateResult_out = hipGraphExecUpdateErrorUnsupportedFunctionChange;
-          *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
-          return hipErrorGraphExecUpdateFailure;
-        }
-      }
-
-      if (newGraphNodes[i]->GetType() == hipGraphNodeTypeMemcpy) {
-        // Checks if the memcpy node's parameters are same
-        const hip::GraphMemcpyNode* newMemcpyNode =
-            static_cast<hip::GraphMemcpyNode const*>(newGraphNodes[i]);
-        const hip::GraphMemcpyNode* oldMemcpyNode =
-            static_cast<hip::GraphMemcpyNode const*>(oldGraphExecNodes[i]);
-        hipMemcpyKind newKind, oldKind;
-        newKind = newMemcpyNode->GetMemcpyKind();
-        oldKind = oldMemcpyNode->GetMemcpyKind();
-        if (newKind != oldKind) {
-          *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
-          *updateResult_out = hipGraphExecUpdateErrorParametersChanged;
-          HIP_RETURN(hipErrorGraphExecUpdateFailure);
-        }
-      }
-      // Checks if all the node's dependencies are same
-      const std::vector<hip::GraphNode*>& newGraphDependencies =
-                        newGraphNodes[i]->GetDependencies();
-      const std::vector<hip::GraphNode*>& oldGraphDependencies =
-                        oldGraphExecNodes[i]->GetDependencies();
-      if (newGraphDependencies.size() != oldGraphDependencies.size()) {
-        *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
-        *updateResult_out = hipGraphExecUpdateErrorTopologyChanged;
-        HIP_RETURN(hipErrorGraphExecUpdateFailure);
-      }
-
-      hipError_t status = oldGraphExecNodes[i]->SetParams(newGraphNodes[i]);
-      if (status != hipSuccess) {
-        *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
-        if (status == hipErrorInvalidDeviceFunction) {
-          *updateResult_out = hipGraphExecUpdateErrorUnsupportedFunctionChange;
-        } else if (status == hipErrorInvalidValue || status == hipErrorInvalidDevicePointer) {
-          *updateResult_out = hipGraphExecUpdateErrorParametersChanged;
-        } else {
-          *updateResult_out = hipGraphExecUpdateErrorNotSupported;
-        }
-        HIP_RETURN(hipErrorGraphExecUpdateFailure);
-      } else if (DEBUG_CLR_GRAPH_PACKET_CAPTURE && newGraphNodes[i]->GraphCaptureEnabled()) {
-        status =
-            reinterpret_cast<hip::GraphExec*>(hGraphExec)
-                ->UpdateAQLPacket(reinterpret_cast<hip::GraphKernelNode*>(oldGraphExecNodes[i]));
-      }
-    } else {
-      *hErrorNode_out = reinterpret_cast<hipGraphNode_t>(newGraphNodes[i]);
-      *updateResult_out = hipGraphExecUpdateErrorNodeTypeChanged;
-      HIP_RETURN(hipErrorGraphExecUpdateFailure);
-    }
-  }
-  *updateResult_out = hipGraphExecUpdateSuccess;
-  HIP_RETURN(hipSuccess);
+  hipError_t status = ihipGraphExecUpdate(reinterpret_cast<hip::GraphExec*>(hGraphExec),
+                                          reinterpret_cast<hip::Graph*>(hGraph), hErrorNode_out,
+                                          updateResult_out);
+  HIP_RETURN(status);
 }
 
 // ================================================================================================
@@ -2809,21 +2875,23 @@ hipError_t hipGraphAddMemFreeNode(hipGraphNode_t* pGraphNode, hipGraph_t graph,
     HIP_RETURN(hipErrorInvalidValue);
   }
   // memAllocNodePtrs_ stores only local to graph alloc dptrs whose free node is not added.
-  // and so we need to traverse all graphs of graphSet_ and below cases are handled.
+  // and so we need to traverse all graphs of graphHandles_ and below cases are handled.
   // 1) Free node cannot be added twice to the same graph
   // 2) Free node if it part of another graph cannot be added to this graph
   hip::GraphNode* pNode;
   bool bGraphFound = false;
   {
     amd::ScopedLock lock(hip::Graph::graphSetLock_);
-    for (auto itGraph : hip::Graph::graphSet_) {
+    hip::Graph::graphHandles_.ForEach([&bGraphFound, dev_ptr](hip::Graph* itGraph) {
+      if (bGraphFound) {
+        return;
+      }
       std::unordered_set<void*>::iterator itDevPtr = itGraph->memAllocNodePtrs_.find(dev_ptr);
       if (itDevPtr != itGraph->memAllocNodePtrs_.end()) {
         bGraphFound = true;
         itGraph->memAllocNodePtrs_.erase(itDevPtr);
-        break;
       }
-    }
+    });
   }
   if (bGraphFound == false) {
     HIP_RETURN(hipErrorInvalidValue);
@@ -3066,6 +3134,10 @@ hipError_t hipGraphNodeSetEnabled(hipGraphExec_t hGraphExec, hipGraphNode_t hNod
     HIP_RETURN(hipErrorInvalidValue);
   }
   clonedNode->SetEnabled(isEnabled);
+  if (clonedNode->GetBatchOwner() != nullptr) {
+    // The batched blit can't skip a single node
+    HIP_RETURN(graphExec->SplitBlitBatch(clonedNode->GetBatchOwner()));
+  }
   HIP_RETURN(hipSuccess);
 }
 
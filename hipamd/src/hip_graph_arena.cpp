@@ -0,0 +1,69 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "hip_graph_arena.hpp"
+#include <algorithm>
+#include <new>
+
+namespace hip {
+
+thread_local GraphNodeArena* GraphNodeArena::current_ = nullptr;
+
+// ================================================================================================
+void* GraphNodeArena::Alloc(size_t size) {
+  if (size > available_) {
+    // Large nodes get a dedicated chunk, so the free space of the current chunk isn't lost
+    size_t chunkSize = std::max(size, kChunkSize);
+    char* chunk = new char[chunkSize];
+    chunks_.push_back(chunk);
+    if (chunkSize != kChunkSize) {
+      return chunk;
+    }
+    current_ptr_ = chunk;
+    available_ = chunkSize;
+  }
+  void* ptr = current_ptr_;
+  current_ptr_ += size;
+  available_ -= size;
+  return ptr;
+}
+
+// ================================================================================================
+void* GraphNodeArena::AllocNode(size_t size) {
+  constexpr size_t kHeader = kAlignment;
+  size = ((size + kAlignment - 1) & ~(kAlignment - 1)) + kHeader;
+  GraphNodeArena* arena = current_;
+  char* mem = static_cast<char*>((arena != nullptr) ? arena->Alloc(size) : ::operator new(size));
+  *reinterpret_cast<GraphNodeArena**>(mem) = arena;
+  return mem + kHeader;
+}
+
+// ================================================================================================
+void GraphNodeArena::FreeNode(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  char* mem = static_cast<char*>(ptr) - kAlignment;
+  if (*reinterpret_cast<GraphNodeArena**>(mem) == nullptr) {
+    ::operator delete(mem);
+  }
+}
+
+}  // namespace hip
@@ -0,0 +1,70 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace hip {
+
+//! Bump allocator for the nodes, cloned at the graph instantiation. The nodes are allocated
+//! in large chunks, which are released only with the arena, hence node deletion is free.
+class GraphNodeArena {
+ public:
+  GraphNodeArena() = default;
+  GraphNodeArena(const GraphNodeArena&) = delete;
+  GraphNodeArena& operator=(const GraphNodeArena&) = delete;
+  ~GraphNodeArena() {
+    for (auto chunk : chunks_) {
+      delete[] chunk;
+    }
+  }
+
+  //! Allocates memory from the current chunk. The size must be a multiple of kAlignment
+  void* Alloc(size_t size);
+
+  //! Allocates a node in the arena of the current thread or on the C-heap. A header before
+  //! the node records the owning arena, so the node can be released without its graph
+  static void* AllocNode(size_t size);
+
+  //! Releases the node memory through its header. The arena memory is released with the arena
+  static void FreeNode(void* ptr);
+
+  //! Redirects the node allocations on the current thread into the arena
+  class Scope {
+   public:
+    explicit Scope(GraphNodeArena* arena) : previous_(current_) { current_ = arena; }
+    ~Scope() { current_ = previous_; }
+
+   private:
+    GraphNodeArena* previous_;  //!< Arena of the outer scope
+  };
+
+  static constexpr size_t kAlignment = 16;        //!< Alignment of all allocations
+
+ private:
+  static constexpr size_t kChunkSize = 64 * 1024;  //!< Default chunk size
+  static thread_local GraphNodeArena* current_;    //!< Arena of the thread, nullptr for C-heap
+  std::vector<char*> chunks_;                      //!< Allocated chunks
+  char* current_ptr_ = nullptr;                    //!< Free space in the last chunk
+  size_t available_ = 0;                           //!< Size of the free space in the last chunk
+};
+
+}  // namespace hip
@@ -19,7 +19,11 @@
  THE SOFTWARE. */
 
 #include "hip_graph_internal.hpp"
+#include <atomic>
 #include <queue>
+#include <thread>
+#include <limits>
+#include <unordered_set>
 
 #define CASE_STRING(X, C)                                                                          \
   case X:                                                                                          \
@@ -48,28 +52,133 @@ const char* GetGraphNodeTypeString(uint32_t op) {
   };
   return case_string;
 };
+
+inline size_t HashCombine(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Computes the structure signature of every node from the node type and the signatures of
+// the dependencies. The dependency signatures are sorted, hence the signature doesn't depend
+// on the order of the nodes or the edges. The nodes must be in a topological order.
+void ComputeSignatures(const std::vector<hip::Node>& nodes,
+                       std::unordered_map<hip::Node, size_t>* signatures) {
+  std::vector<size_t> depSignatures;
+  signatures->reserve(nodes.size());
+  for (auto node : nodes) {
+    depSignatures.clear();
+    for (auto dep : node->GetDependencies()) {
+      depSignatures.push_back((*signatures)[dep]);
+    }
+    // The edges, removed by the transitive reduction, are still a part of the structure
+    for (auto dep : node->GetPrunedDependencies()) {
+      depSignatures.push_back((*signatures)[dep]);
+    }
+    std::sort(depSignatures.begin(), depSignatures.end());
+    size_t signature = std::hash<uint32_t>()(static_cast<uint32_t>(node->GetType()));
+    for (auto depSignature : depSignatures) {
+      signature = HashCombine(signature, depSignature);
+    }
+    (*signatures)[node] = signature;
+  }
+}
+
+// Returns true if the entry can be a part of a batched blit with the provided entries.
+// The batch runs all entries concurrently, hence the written ranges can't overlap any other range
+bool CanBatchBlit(const amd::BatchCopyFillEntry& entry,
+                  const std::vector<amd::BatchCopyFillEntry>& batch) {
+  if ((entry.size_ == 0) || (entry.size_ > DEBUG_HIP_GRAPH_BLIT_FUSION_SIZE) ||
+      ((entry.elementSize_ != 0) && (entry.elementSize_ != 1) && (entry.elementSize_ != 2) &&
+       (entry.elementSize_ != 4))) {
+    return false;
+  }
+  auto overlap = [](uint64_t a, uint64_t b, uint64_t size_a, uint64_t size_b) {
+    return (a < b + size_b) && (b < a + size_a);
+  };
+  for (const auto& other : batch) {
+    if (overlap(entry.dst_, other.dst_, entry.size_, other.size_) ||
+        ((other.elementSize_ == 0) && overlap(entry.dst_, other.src_, entry.size_, other.size_)) ||
+        ((entry.elementSize_ == 0) && overlap(entry.src_, other.dst_, entry.size_, other.size_))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Builds the entries of the batched blit. Returns false if any node can't be batched anymore
+bool BuildBlitBatch(const std::vector<hip::Node>& nodes,
+                    std::vector<amd::BatchCopyFillEntry>* batch) {
+  batch->clear();
+  batch->reserve(nodes.size());
+  for (auto node : nodes) {
+    amd::BatchCopyFillEntry entry;
+    if (!node->GetBatchEntry(&entry) || !CanBatchBlit(entry, *batch)) {
+      return false;
+    }
+    batch->push_back(entry);
+  }
+  return true;
+}
 }
 
 namespace hip {
 
 int GraphNode::nextID = 0;
 int Graph::nextID = 0;
-std::unordered_set<GraphNode*> GraphNode::nodeSet_;
-// Guards global node set
-amd::Monitor GraphNode::nodeSetLock_{};
-std::unordered_set<Graph*> Graph::graphSet_;
-// Guards global graph set
+HandleTable<GraphNode> GraphNode::nodeHandles_;
+HandleTable<Graph> Graph::graphHandles_;
+// Guards graph user objects and mem alloc pointers
 amd::Monitor Graph::graphSetLock_{};
-std::unordered_set<GraphExec*> GraphExec::graphExecSet_;
-// Guards global exec graph set
-// we have graphExec object as part of child graph and we need recursive lock
-amd::Monitor GraphExec::graphExecSetLock_(true);
+HandleTable<GraphExec> GraphExec::graphExecHandles_;
+std::list<GraphExec*> GraphExec::execCache_;
+// Guards the instantiation cache of the destroyed graph execs
+amd::Monitor GraphExec::execCacheLock_{};
 std::unordered_set<UserObject*> UserObject::ObjectSet_;
 // Guards global user object
 amd::Monitor UserObject::UserObjectLock_{};
 // Guards mem map add/remove against work thread
 amd::Monitor GraphNode::WorkerThreadLock_{};
 
+// ================================================================================================
+hipError_t GraphNode::CreateBatchCommand(hip::Stream* stream) {
+  hipError_t status = GraphNode::CreateCommand(stream);
+  if (status != hipSuccess) {
+    return status;
+  }
+  Node owner = batch_owner_;
+  if (owner->batch_nodes_.front() == this) {
+    // The parameters could change after the instantiation. The first node of the batch
+    // validates it before any other node of the batch is skipped, so on a failure all nodes
+    // still create their own commands in this launch
+    if (!BuildBlitBatch(owner->batch_nodes_, &owner->batch_entries_)) {
+      ClPrint(amd::LOG_INFO, amd::LOG_CODE, "[hipGraph] Split blit batch of %zu nodes",
+              owner->batch_nodes_.size());
+      DetachBatch();
+      return CreateCommand(stream);
+    }
+  }
+  if (owner != this) {
+    return hipSuccess;
+  }
+  amd::Command::EventWaitList waitList;
+  amd::Command* command =
+      new amd::BatchCopyFillCommand(*stream, waitList, std::move(batch_entries_));
+  if (command == nullptr) {
+    return hipErrorOutOfMemory;
+  }
+  commands_.emplace_back(command);
+  return hipSuccess;
+}
+
+// ================================================================================================
+std::vector<Node> GraphNode::DetachBatch() {
+  std::vector<Node> nodes;
+  nodes.swap(batch_owner_->batch_nodes_);
+  for (auto node : nodes) {
+    node->batch_owner_ = nullptr;
+  }
+  return nodes;
+}
+
 hipError_t GraphMemcpyNode1D::ValidateParams(void* dst, const void* src, size_t count,
                                                 hipMemcpyKind kind) {
   hipError_t status = ihipMemcpy_validate(dst, src, count, kind);
@@ -111,16 +220,11 @@ hipError_t GraphMemcpyNode::ValidateParams(const hipMemcpy3DParms* pNodeParams)
 }
 
 // ================================================================================================
-bool Graph::isGraphValid(Graph* pGraph) {
-  amd::ScopedLock lock(graphSetLock_);
-  if (graphSet_.find(pGraph) == graphSet_.end()) {
-    return false;
-  }
-  return true;
-}
+bool Graph::isGraphValid(Graph* pGraph) { return graphHandles_.Contains(pGraph); }
 
 // ================================================================================================
 void Graph::AddNode(const Node& node) {
+  node->vertex_index_ = static_cast<uint32_t>(vertices_.size());
   vertices_.emplace_back(node);
   ClPrint(amd::LOG_INFO, amd::LOG_CODE, "[hipGraph] Add %s(%p)",
           GetGraphNodeTypeString(node->GetType()), node);
@@ -130,6 +234,10 @@ void Graph::AddNode(const Node& node) {
 // ================================================================================================
 void Graph::RemoveNode(const Node& node) {
   vertices_.erase(std::remove(vertices_.begin(), vertices_.end(), node), vertices_.end());
+  // The vertex indices stay dense, so the clone can translate the edges without lookups
+  for (uint32_t i = 0; i < vertices_.size(); ++i) {
+    vertices_[i]->vertex_index_ = i;
+  }
   delete node;
 }
 
@@ -210,9 +318,14 @@ void Graph::ScheduleNodes() {
   for (auto node : vertices_) {
     node->stream_id_ = -1;
     node->signal_is_required_ = false;
+    node->wait_nodes_.clear();
   }
   memset(&roots_[0], 0, sizeof(Node) * roots_.size());
   max_streams_ = 0;
+  launch_order_.clear();
+  if (DEBUG_HIP_GRAPH_LIST_SCHEDULER && ListScheduleNodes()) {
+    return;
+  }
   // Start processing all nodes in the graph to find async executions.
   int stream_id = 0;
   for (auto node : vertices_) {
@@ -232,69 +345,234 @@ void Graph::ScheduleNodes() {
   }
 }
 
+// ================================================================================================
+bool Graph::ListScheduleNodes() {
+  for (auto node : vertices_) {
+    // Child graphs are scheduled recursively on the parent streams,
+    // hence they can't be a part of the list schedule
+    if (node->GetType() == hipGraphNodeTypeGraph) {
+      return false;
+    }
+  }
+  BuildAdjacency();
+  std::vector<uint64_t> cost(vertices_.size());
+  std::vector<std::vector<uint32_t>> deps(vertices_.size());
+  for (uint32_t i = 0; i < vertices_.size(); ++i) {
+    cost[i] = vertices_[i]->GetCostEstimate();
+    deps[i].reserve(vertices_[i]->GetDependencies().size());
+    for (auto dep : vertices_[i]->GetDependencies()) {
+      deps[i].push_back(dep->vertex_index_);
+    }
+  }
+
+  GraphListScheduler::Result result;
+  if (!GraphListScheduler::Schedule(cost, deps, DEBUG_HIP_FORCE_GRAPH_QUEUES, &result)) {
+    return false;
+  }
+  max_streams_ = result.num_streams_;
+  for (uint32_t i = 0; i < vertices_.size(); ++i) {
+    Node node = vertices_[i];
+    node->stream_id_ = result.stream_id_[i];
+    node->signal_is_required_ = result.signal_is_required_[i];
+    for (auto wait : result.waits_[i]) {
+      node->wait_nodes_.push_back(vertices_[wait]);
+    }
+  }
+  // Single stream graphs use the topological order for the execution
+  if (max_streams_ > 1) {
+    launch_order_.reserve(vertices_.size());
+    for (auto i : result.launch_order_) {
+      Node node = vertices_[i];
+      launch_order_.push_back(node);
+      // Find the first root node on every extra stream
+      if ((node->GetDependencies().size() == 0) && (node->stream_id_ != 0) &&
+          (roots_[node->stream_id_] == nullptr)) {
+        roots_[node->stream_id_] = node;
+      }
+    }
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE,
+          "[hipGraph] List schedule: nodes(%zu), streams(%u), waits(%u), makespan(%llu)",
+          vertices_.size(), result.num_streams_, result.num_waits_,
+          static_cast<unsigned long long>(result.makespan_));
+  return true;
+}
+
+// ================================================================================================
+void Graph::BuildAdjacency() {
+  const uint32_t numNodes = static_cast<uint32_t>(vertices_.size());
+  edgeOffsets_.resize(numNodes + 1);
+  edgeTargets_.clear();
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    edgeOffsets_[i] = static_cast<uint32_t>(edgeTargets_.size());
+    for (auto edge : vertices_[i]->GetEdges()) {
+      edgeTargets_.push_back(edge->vertex_index_);
+    }
+  }
+  edgeOffsets_[numNodes] = static_cast<uint32_t>(edgeTargets_.size());
+}
+
 // ================================================================================================
 bool Graph::TopologicalOrder(std::vector<Node>& TopoOrder) {
-  std::queue<Node> q;
-  std::unordered_map<Node, int> inDegree;
-  for (auto entry : vertices_) {
-    // Update the dependencies if a signal is required
+  BuildAdjacency();
+  const uint32_t numNodes = static_cast<uint32_t>(vertices_.size());
+  // The queue is the tail of the order, hence the sort doesn't allocate anything per node
+  std::vector<uint32_t> order;
+  order.reserve(numNodes);
+  std::vector<uint32_t> inDegree(numNodes);
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    Node entry = vertices_[i];
+    // Update the dependencies if a signal is required.
+    // The list scheduler has already selected the minimal set of signals.
     for (auto dep: entry->GetDependencies()) {
       // Check if the stream ID doesn't match and enable signal
-      if (dep->stream_id_ != entry->stream_id_) {
+      if (launch_order_.empty() && (dep->stream_id_ != entry->stream_id_)) {
         dep->signal_is_required_ = true;
       }
     }
 
     if (entry->GetInDegree() == 0) {
-      q.push(entry);
+      order.push_back(i);
     }
-    inDegree[entry] = entry->GetInDegree();
+    inDegree[i] = static_cast<uint32_t>(entry->GetInDegree());
   }
-  while (!q.empty())
-  {
-    Node node = q.front();
-    TopoOrder.push_back(node);
-    q.pop();
-    for (auto edge : node->GetEdges()) {
-      inDegree[edge]--;
-      if (inDegree[edge] == 0) {
-        q.push(edge);
+  for (size_t i = 0; i < order.size(); ++i) {
+    const uint32_t node = order[i];
+    for (uint32_t e = edgeOffsets_[node]; e < edgeOffsets_[node + 1]; ++e) {
+      if (--inDegree[edgeTargets_[e]] == 0) {
+        order.push_back(edgeTargets_[e]);
       }
     }
   }
-  if (GetNodeCount() == TopoOrder.size()) {
+  TopoOrder.reserve(TopoOrder.size() + order.size());
+  for (auto i : order) {
+    TopoOrder.push_back(vertices_[i]);
+  }
+  if (GetNodeCount() == order.size()) {
     return true;
   }
   return false;
 }
 
+// ================================================================================================
+uint32_t Graph::ReduceTransitiveEdges() {
+  // The reachability sets are quadratic in the node count
+  constexpr uint32_t kMaxReductionNodes = 16 * 1024;
+  const uint32_t numNodes = static_cast<uint32_t>(vertices_.size());
+  if ((numNodes > kMaxReductionNodes) || (numNodes < 3)) {
+    return 0;
+  }
+  std::vector<Node> order;
+  if (!TopologicalOrder(order)) {
+    return 0;
+  }
+  std::vector<uint32_t> position(numNodes);
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    position[order[i]->vertex_index_] = i;
+  }
+  // Every node keeps the set of all nodes reachable from it. The edges are processed in
+  // the topological order of the children, hence if a child is reachable through another
+  // child, the other child has been processed already and the edge is redundant.
+  const size_t words = (numNodes + 63) / 64;
+  std::vector<uint64_t> reach(static_cast<size_t>(numNodes) * words, 0);
+  std::vector<uint32_t> children;
+  std::vector<std::pair<Node, Node>> redundant;
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    const uint32_t node = (*it)->vertex_index_;
+    uint64_t* nodeReach = &reach[node * words];
+    children.assign(edgeTargets_.begin() + edgeOffsets_[node],
+                    edgeTargets_.begin() + edgeOffsets_[node + 1]);
+    std::sort(children.begin(), children.end(), [&position](uint32_t a, uint32_t b) {
+      return position[a] < position[b];
+    });
+    for (auto child : children) {
+      if ((nodeReach[child / 64] & (1ULL << (child % 64))) != 0) {
+        redundant.push_back(std::make_pair(*it, vertices_[child]));
+        continue;
+      }
+      nodeReach[child / 64] |= (1ULL << (child % 64));
+      const uint64_t* childReach = &reach[child * words];
+      for (size_t w = 0; w < words; ++w) {
+        nodeReach[w] |= childReach[w];
+      }
+    }
+  }
+  for (auto& edge : redundant) {
+    edge.first->RemoveEdgeDep(edge.second);
+    edge.second->pruned_dependencies_.push_back(edge.first);
+  }
+  removed_edges_ += static_cast<uint32_t>(redundant.size());
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE, "[hipGraph] Transitive reduction: nodes(%u), edges(%zu)",
+          numNodes, redundant.size());
+  return static_cast<uint32_t>(redundant.size());
+}
+
+// ================================================================================================
+uint64_t Graph::Fingerprint(uint64_t flags) {
+  std::vector<Node> nodes;
+  if (!TopologicalOrder(nodes)) {
+    return 0;
+  }
+  for (auto node : nodes) {
+    // The memory nodes own the allocations and the child graphs have own topology,
+    // hence those graphs are always instantiated
+    if ((node->GetType() == hipGraphNodeTypeMemAlloc) ||
+        (node->GetType() == hipGraphNodeTypeMemFree) ||
+        (node->GetType() == hipGraphNodeTypeGraph)) {
+      return 0;
+    }
+  }
+  std::unordered_map<Node, size_t> signatures;
+  ComputeSignatures(nodes, &signatures);
+  std::vector<size_t> nodeSignatures;
+  nodeSignatures.reserve(nodes.size());
+  for (auto node : nodes) {
+    nodeSignatures.push_back(HashCombine(signatures[node], node->GetIdentityHash()));
+  }
+  std::sort(nodeSignatures.begin(), nodeSignatures.end());
+  size_t fingerprint = HashCombine(std::hash<uint64_t>()(flags), std::hash<void*>()(device_));
+  for (auto signature : nodeSignatures) {
+    fingerprint = HashCombine(fingerprint, signature);
+  }
+  // 0 is reserved for the graphs, which can't be cached
+  return (fingerprint != 0) ? fingerprint : 1;
+}
+
 // ================================================================================================
 void Graph::clone(Graph* newGraph, bool cloneNodes) const {
   newGraph->pOriginalGraph_ = this;
-  for (hip::GraphNode* entry : vertices_) {
-    GraphNode* node = entry->clone();
-    node->SetParentGraph(newGraph);
-    newGraph->vertices_.push_back(node);
-    newGraph->clonedNodes_[entry] = node;
+  const uint32_t numNodes = static_cast<uint32_t>(vertices_.size());
+  newGraph->vertices_.reserve(numNodes);
+  {
+    // All cloned nodes are allocated in the arena of the new graph
+    GraphNodeArena::Scope scope(&newGraph->nodeArena_);
+    for (uint32_t i = 0; i < numNodes; ++i) {
+      GraphNode* node = vertices_[i]->clone();
+      node->SetParentGraph(newGraph);
+      node->vertex_index_ = i;
+      newGraph->vertices_.push_back(node);
+    }
+  }
+  if (cloneNodes) {
+    newGraph->clonedNodes_.reserve(numNodes);
+    for (uint32_t i = 0; i < numNodes; ++i) {
+      newGraph->clonedNodes_[vertices_[i]] = newGraph->vertices_[i];
+    }
   }
 
-  std::vector<Node> clonedEdges;
-  std::vector<Node> clonedDependencies;
-  for (auto node : vertices_) {
-    const std::vector<Node>& edges = node->GetEdges();
-    clonedEdges.clear();
+  // The cloned nodes have the same indices, hence the edges are translated without lookups
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    const std::vector<Node>& edges = vertices_[i]->GetEdges();
+    Node node = newGraph->vertices_[i];
+    node->edges_.reserve(edges.size());
     for (auto edge : edges) {
-      clonedEdges.push_back(newGraph->clonedNodes_[edge]);
+      node->edges_.push_back(newGraph->vertices_[edge->vertex_index_]);
     }
-    newGraph->clonedNodes_[node]->SetEdges(clonedEdges);
-  }
-  for (auto node : vertices_) {
-    const std::vector<Node>& dependencies = node->GetDependencies();
-    clonedDependencies.clear();
+    const std::vector<Node>& dependencies = vertices_[i]->GetDependencies();
+    node->dependencies_.reserve(dependencies.size());
     for (auto dep : dependencies) {
-      clonedDependencies.push_back(newGraph->clonedNodes_[dep]);
+      node->dependencies_.push_back(newGraph->vertices_[dep->vertex_index_]);
     }
-    newGraph->clonedNodes_[node]->SetDependencies(clonedDependencies);
   }
   for (auto& userObj : graphUserObj_) {
     userObj.first->retain();
@@ -308,9 +586,6 @@ void Graph::clone(Graph* newGraph, bool cloneNodes) const {
     memcpy(&newGraph->roots_[0], &roots_[0], sizeof(Node) * roots_.size());
   }
   newGraph->memAllocNodePtrs_ = memAllocNodePtrs_;
-  if(!cloneNodes) {
-    newGraph->clonedNodes_.clear();
-  }
 }
 
 // ================================================================================================
@@ -322,11 +597,7 @@ Graph* Graph::clone() const {
 
 // ================================================================================================
 bool GraphExec::isGraphExecValid(GraphExec* pGraphExec) {
-  amd::ScopedLock lock(graphExecSetLock_);
-  if (graphExecSet_.find(pGraphExec) == graphExecSet_.end()) {
-    return false;
-  }
-  return true;
+  return graphExecHandles_.Contains(pGraphExec);
 }
 
 // ================================================================================================
@@ -364,6 +635,12 @@ hipError_t GraphExec::Init() {
       capture_stream_ = hip::getNullStream(false);
       // For graph nodes capture AQL packets to dispatch them directly during graph launch.
       status = CaptureAQLPackets();
+    } else if (CanCaptureMultiStream()) {
+      capture_stream_ = hip::getNullStream(false);
+      status = CaptureAQLPackets();
+      if (status == hipSuccess) {
+        BuildPacketSegments();
+      }
     }
   }
   instantiateDeviceId_ = hip::getCurrentDevice()->deviceId();
@@ -396,7 +673,7 @@ void GraphExec::GetKernelArgSizeForGraph(size_t& kernArgSizeForGraph) {
 }
 
 // ================================================================================================
-hipError_t GraphExec::AllocKernelArgForGraphNode() {
+hipError_t GraphExec::AllocKernelArgForGraphNode(std::vector<Node>* deferredNodes) {
   hipError_t status = hipSuccess;
   for (auto& node : topoOrder_) {
     if (node->GetType() == hipGraphNodeTypeKernel) {
@@ -407,7 +684,14 @@ hipError_t GraphExec::AllocKernelArgForGraphNode() {
         initialized = true;
       }
     }
-    if (node->GraphCaptureEnabled()) {
+    if (node->GraphCaptureEnabled() && (deferredNodes != nullptr) &&
+        node->CanCaptureConcurrently()) {
+      // Kernel args are reserved in the graph order, so the layout is deterministic
+      GetKernelArgManager()->ReserveSlot(&node->kernArgSlots_,
+                                         node->GetKernargSegmentByteSize(),
+                                         node->GetKernargSegmentAlignment());
+      deferredNodes->push_back(node);
+    } else if (node->GraphCaptureEnabled()) {
       status = node->CaptureAndFormPacket(capture_stream_, GetKernelArgManager());
     } else if (node->GetType() == hipGraphNodeTypeGraph) {
       auto childNode = reinterpret_cast<hip::ChildGraphNode*>(node);
@@ -435,7 +719,21 @@ hipError_t GraphExec::CaptureAQLPackets() {
     return hipErrorMemoryAllocation;
   }
 
-  status = AllocKernelArgForGraphNode();
+  // Only large graphs amortize the worker streams
+  constexpr size_t kMinNodesPerThread = 256;
+  uint32_t numThreads = std::min(DEBUG_HIP_GRAPH_CAPTURE_THREADS,
+                                 std::max(std::thread::hardware_concurrency(), 1u));
+  numThreads = static_cast<uint32_t>(
+      std::min(static_cast<size_t>(numThreads), topoOrder_.size() / kMinNodesPerThread));
+  if (numThreads > 1) {
+    std::vector<Node> deferredNodes;
+    status = AllocKernelArgForGraphNode(&deferredNodes);
+    if (status == hipSuccess) {
+      status = CaptureNodesParallel(deferredNodes, numThreads);
+    }
+  } else {
+    status = AllocKernelArgForGraphNode();
+  }
   if (status != hipSuccess) {
     return status;
   }
@@ -443,19 +741,503 @@ hipError_t GraphExec::CaptureAQLPackets() {
   return status;
 }
 
+// ================================================================================================
+hipError_t GraphExec::CaptureNodesParallel(const std::vector<Node>& nodes, uint32_t numThreads) {
+  // Each worker needs own virtual device, since the capture goes through the command submission.
+  // The calling thread uses the capture stream.
+  std::vector<hip::Stream*> streams{capture_stream_};
+  for (uint32_t i = 1; i < numThreads; ++i) {
+    auto stream = new hip::Stream(hip::getCurrentDevice(), hip::Stream::Priority::Normal,
+                                  hipStreamNonBlocking);
+    if ((stream == nullptr) || !stream->Create()) {
+      if (stream != nullptr) {
+        hip::Stream::Destroy(stream);
+      }
+      break;
+    }
+    streams.push_back(stream);
+  }
+  // Workers take the nodes in small chunks. The kernel args are already reserved, hence
+  // the captured packets don't depend on the worker, which captures the node
+  constexpr size_t kChunkSize = 16;
+  std::atomic<size_t> next(0);
+  std::vector<hipError_t> statuses(nodes.size(), hipSuccess);
+  const int deviceId = ihipGetDevice();
+  auto worker = [&](hip::Stream* stream) {
+    hip::setCurrentDevice(deviceId);
+    for (size_t first = next.fetch_add(kChunkSize); first < nodes.size();
+         first = next.fetch_add(kChunkSize)) {
+      const size_t last = std::min(first + kChunkSize, nodes.size());
+      for (size_t i = first; i < last; ++i) {
+        statuses[i] = nodes[i]->CaptureAndFormPacket(stream, kernArgManager_);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(streams.size() - 1);
+  for (size_t i = 1; i < streams.size(); ++i) {
+    threads.emplace_back(worker, streams[i]);
+  }
+  worker(capture_stream_);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 1; i < streams.size(); ++i) {
+    hip::Stream::Destroy(streams[i]);
+  }
+  hipError_t status = hipSuccess;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    // The worker streams are gone, the nodes keep the capture stream as on the serial path
+    nodes[i]->stream_ = capture_stream_;
+    if ((status == hipSuccess) && (statuses[i] != hipSuccess)) {
+      // Report the first failed node in the graph order
+      status = statuses[i];
+    }
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE, "[hipGraph] Parallel capture: nodes(%zu), threads(%zu)",
+          nodes.size(), streams.size());
+  return status;
+}
+
 // ================================================================================================
 hipError_t GraphExec::UpdateAQLPacket(hip::GraphNode* node) {
   hipError_t status = hipSuccess;
+  if (node->batch_owner_ != nullptr) {
+    // The batch owner recaptures the whole batch. If the new parameters can't be batched,
+    // then all nodes of the batch go back to the individual execution
+    Node owner = node->batch_owner_;
+    std::vector<amd::BatchCopyFillEntry> batch;
+    if (!BuildBlitBatch(owner->batch_nodes_, &batch)) {
+      return SplitBlitBatch(owner);
+    }
+    node = owner;
+  }
   if (max_streams_ == 1) {
     status = node->CaptureAndFormPacket(capture_stream_, kernArgManager_);
+  } else if (!segments_.empty()) {
+    status = node->CaptureAndFormPacket(capture_stream_, kernArgManager_);
+    // New parameters may switch the node between the packet and the command execution
+    if ((node->segment_id_ != -1) &&
+        (segments_[node->segment_id_].packets_ != node->GraphCaptureEnabled())) {
+      BuildPacketSegments();
+    }
+  }
+  if ((status == hipSuccess) && (kernArgManager_ != nullptr)) {
+    // Kernel args could be rewritten in place, hence make sure they are visible to GPU
+    kernArgManager_->ReadBackOrFlush();
   }
   return status;
 }
 
+// ================================================================================================
+void GraphExec::FuseBlitNodes() {
+  if ((DEBUG_HIP_GRAPH_BLIT_FUSION_SIZE == 0) ||
+      !g_devices[ihipGetDevice()]->devices()[0]->settings().rocr_backend_) {
+    return;
+  }
+  // Limits the quadratic overlap validation
+  constexpr size_t kMaxBatchSize = 256;
+  // Returns true if the node runs only after the work on its own stream, so the node can
+  // be delayed until the end of the batch without any cross-stream wait
+  auto canFuse = [](Node node) {
+    if (!node->wait_nodes_.empty()) {
+      return false;
+    }
+    for (auto dep : node->GetDependencies()) {
+      if (dep->stream_id_ != node->stream_id_) {
+        return false;
+      }
+    }
+    return true;
+  };
+  std::vector<amd::BatchCopyFillEntry> batch;
+  std::vector<Node> chain;
+  uint32_t fusedNodes = 0;
+  for (auto node : topoOrder_) {
+    amd::BatchCopyFillEntry entry;
+    if ((node->batch_owner_ != nullptr) || !canFuse(node) || !node->GetBatchEntry(&entry)) {
+      continue;
+    }
+    batch.clear();
+    chain.clear();
+    if (!CanBatchBlit(entry, batch)) {
+      continue;
+    }
+    batch.push_back(entry);
+    chain.push_back(node);
+    // Only the last node can have other successors, since it dispatches the batch
+    while ((chain.back()->GetEdges().size() == 1) && (chain.size() < kMaxBatchSize)) {
+      Node next = chain.back()->GetEdges()[0];
+      if ((next->GetDependencies().size() != 1) || (next->stream_id_ != node->stream_id_) ||
+          (next->GraphCaptureEnabled() != node->GraphCaptureEnabled()) || !canFuse(next) ||
+          !next->GetBatchEntry(&entry) || !CanBatchBlit(entry, batch)) {
+        break;
+      }
+      batch.push_back(entry);
+      chain.push_back(next);
+    }
+    if (chain.size() > 1) {
+      Node owner = chain.back();
+      for (auto fused : chain) {
+        fused->batch_owner_ = owner;
+      }
+      owner->batch_nodes_ = chain;
+      fusedNodes += static_cast<uint32_t>(chain.size());
+    }
+  }
+  if (fusedNodes > 0) {
+    ClPrint(amd::LOG_INFO, amd::LOG_CODE, "[hipGraph] Fused %u memset/memcpy nodes", fusedNodes);
+  }
+}
+
+// ================================================================================================
+hipError_t GraphExec::SplitBlitBatch(Node owner) {
+  std::vector<Node> nodes = owner->DetachBatch();
+  hipError_t status = hipSuccess;
+  if (DEBUG_CLR_GRAPH_PACKET_CAPTURE) {
+    for (auto node : nodes) {
+      status = UpdateAQLPacket(node);
+      if (status != hipSuccess) {
+        break;
+      }
+    }
+  }
+  return status;
+}
+
+// ================================================================================================
+void GraphExec::PlanMemoryAliasing() {
+  if (!DEBUG_HIP_GRAPH_MEM_ALIASING || !HIP_MEM_POOL_USE_VM) {
+    return;
+  }
+  // Only the allocations, freed inside the graph, have the lifetime known at instantiation.
+  // The other allocations stay valid after the launch and keep the memory from the pool.
+  struct Allocation {
+    GraphMemAllocNode* alloc_;  //!< Allocation node
+    GraphMemFreeNode* free_;    //!< Node, which frees the allocation
+    size_t size_;               //!< Allocation size, aligned to the mapping granularity
+    size_t offset_;             //!< Assigned offset in the backing
+  };
+  const auto& dev_info = device_->devices()[0]->info();
+  std::unordered_map<void*, GraphMemFreeNode*> frees;
+  for (auto node : topoOrder_) {
+    if (node->GetType() == hipGraphNodeTypeMemFree) {
+      void* ptr = nullptr;
+      static_cast<GraphMemFreeNode*>(node)->GetParams(&ptr);
+      frees[ptr] = static_cast<GraphMemFreeNode*>(node);
+    }
+  }
+  std::vector<Allocation> allocations;
+  for (auto node : topoOrder_) {
+    if (node->GetType() != hipGraphNodeTypeMemAlloc) {
+      continue;
+    }
+    hipMemAllocNodeParams params;
+    static_cast<GraphMemAllocNode*>(node)->GetParams(&params);
+    auto it = frees.find(params.dptr);
+    if ((it != frees.end()) && (params.poolProps.location.id == device_->deviceId())) {
+      allocations.push_back({static_cast<GraphMemAllocNode*>(node), it->second,
+                             amd::alignUp(params.bytesize, dev_info.virtualMemAllocGranularity_),
+                             0});
+    }
+  }
+  if (allocations.empty()) {
+    return;
+  }
+  // The allocation j can reuse the memory of the allocation i, if the free of i is
+  // an ancestor of the alloc of j. The topological order alone isn't enough, because
+  // the nodes without a path between them can run concurrently on different streams.
+  const size_t count = allocations.size();
+  std::vector<std::vector<bool>> follows(count, std::vector<bool>(count, false));
+  std::unordered_map<Node, size_t> allocIndex;
+  for (size_t i = 0; i < count; ++i) {
+    allocIndex[allocations[i].alloc_] = i;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    std::unordered_set<Node> visited;
+    std::vector<Node> stack{allocations[i].free_};
+    while (!stack.empty()) {
+      Node node = stack.back();
+      stack.pop_back();
+      for (auto edge : node->GetEdges()) {
+        if (visited.insert(edge).second) {
+          auto it = allocIndex.find(edge);
+          if (it != allocIndex.end()) {
+            follows[i][it->second] = true;
+          }
+          stack.push_back(edge);
+        }
+      }
+    }
+  }
+  // Greedy packing: the largest allocations are placed first at the lowest offset,
+  // which doesn't overlap any placed allocation with an overlapped lifetime
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&allocations](size_t a, size_t b) {
+    return allocations[a].size_ > allocations[b].size_;
+  });
+  size_t backingSize = 0;
+  size_t totalSize = 0;
+  std::vector<size_t> placed;
+  for (auto i : order) {
+    std::vector<std::pair<size_t, size_t>> busy;
+    for (auto j : placed) {
+      if (!follows[i][j] && !follows[j][i]) {
+        busy.push_back({allocations[j].offset_, allocations[j].offset_ + allocations[j].size_});
+      }
+    }
+    std::sort(busy.begin(), busy.end());
+    size_t offset = 0;
+    for (const auto& range : busy) {
+      if (offset + allocations[i].size_ <= range.first) {
+        break;
+      }
+      offset = std::max(offset, range.second);
+    }
+    allocations[i].offset_ = offset;
+    placed.push_back(i);
+    backingSize = std::max(backingSize, offset + allocations[i].size_);
+    totalSize += allocations[i].size_;
+  }
+  void* ptr = amd::SvmBuffer::malloc(*device_->asContext(), ROCCLR_MEM_PHYMEM, backingSize,
+                                     dev_info.memBaseAddrAlign_, nullptr);
+  if (ptr == nullptr) {
+    // The allocations fall back to the pool on every launch
+    LogPrintfError("Graph memory aliasing failed to allocate %zu bytes", backingSize);
+    return;
+  }
+  size_t offset = 0;
+  memAliasBacking_ = getMemoryObject(ptr, offset);
+  memAliasBacking_->getUserData().deviceId = device_->deviceId();
+  for (const auto& allocation : allocations) {
+    allocation.alloc_->SetAliasBacking(memAliasBacking_, allocation.offset_);
+    allocation.free_->SetAliased(true);
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_MEM_POOL,
+          "[hipGraph] Memory aliasing: allocations(%zu), size(%zu), backing(%zu)", count,
+          totalSize, backingSize);
+}
+
+// ================================================================================================
+bool GraphExec::MatchNodes(const std::vector<Node>& newNodes, std::vector<Node>* matchedNodes,
+                           Node* errorNode) {
+  const std::vector<Node>& oldNodes = topoOrder_;
+  update_stats_ = UpdateStats();
+  if (newNodes.size() != oldNodes.size()) {
+    *errorNode = nullptr;
+    return false;
+  }
+  std::unordered_map<Node, size_t> newSignatures;
+  std::unordered_map<Node, size_t> oldSignatures;
+  ComputeSignatures(newNodes, &newSignatures);
+  ComputeSignatures(oldNodes, &oldSignatures);
+
+  // Candidates are kept in the topological order, so the unchanged graph matches by position
+  struct Candidates {
+    std::vector<Node> nodes_;  //!< Executable nodes with the same signature
+    size_t next_ = 0;          //!< First candidate, which may be still unmatched
+  };
+  std::unordered_map<size_t, Candidates> structureMatch;
+  std::unordered_map<size_t, Candidates> identityMatch;
+  for (auto node : oldNodes) {
+    size_t signature = oldSignatures[node];
+    structureMatch[signature].nodes_.push_back(node);
+    identityMatch[HashCombine(signature, node->GetIdentityHash())].nodes_.push_back(node);
+  }
+  std::unordered_set<Node> used;
+  auto takeNext = [&used](Candidates& candidates) -> Node {
+    while (candidates.next_ < candidates.nodes_.size()) {
+      Node node = candidates.nodes_[candidates.next_++];
+      if (used.insert(node).second) {
+        return node;
+      }
+    }
+    return nullptr;
+  };
+
+  // The nodes with the same function are matched first, then the remaining nodes with
+  // the same structure. The later will have the function changed by SetParams()
+  matchedNodes->assign(newNodes.size(), nullptr);
+  for (size_t i = 0; i < newNodes.size(); ++i) {
+    auto it = identityMatch.find(
+        HashCombine(newSignatures[newNodes[i]], newNodes[i]->GetIdentityHash()));
+    if (it != identityMatch.end()) {
+      (*matchedNodes)[i] = takeNext(it->second);
+    }
+  }
+  std::unordered_map<Node, Node> newToOld;
+  newToOld.reserve(newNodes.size());
+  for (size_t i = 0; i < newNodes.size(); ++i) {
+    if ((*matchedNodes)[i] == nullptr) {
+      auto it = structureMatch.find(newSignatures[newNodes[i]]);
+      if (it != structureMatch.end()) {
+        (*matchedNodes)[i] = takeNext(it->second);
+      }
+      if ((*matchedNodes)[i] == nullptr) {
+        *errorNode = newNodes[i];
+        return false;
+      }
+    }
+    newToOld[newNodes[i]] = (*matchedNodes)[i];
+  }
+
+  // Signatures may collide or nodes with the same signature may swap their dependencies,
+  // hence validate that the matched graph has exactly the same edges
+  for (size_t i = 0; i < newNodes.size(); ++i) {
+    const std::vector<Node>& newDeps = newNodes[i]->GetDependencies();
+    const std::vector<Node>& oldDeps = (*matchedNodes)[i]->GetDependencies();
+    const std::vector<Node>& prunedDeps = (*matchedNodes)[i]->GetPrunedDependencies();
+    if (newDeps.size() != (oldDeps.size() + prunedDeps.size())) {
+      *errorNode = newNodes[i];
+      return false;
+    }
+    for (auto dep : newDeps) {
+      if ((std::find(oldDeps.begin(), oldDeps.end(), newToOld[dep]) == oldDeps.end()) &&
+          (std::find(prunedDeps.begin(), prunedDeps.end(), newToOld[dep]) == prunedDeps.end())) {
+        *errorNode = newNodes[i];
+        return false;
+      }
+    }
+    if ((*matchedNodes)[i] != oldNodes[i]) {
+      update_stats_.nodes_reordered_++;
+    }
+  }
+  return true;
+}
+
+// ================================================================================================
+void GraphExec::RemapClonedNodes(const Graph* graph, const std::vector<Node>& newNodes,
+                                 const std::vector<Node>& matchedNodes) {
+  pOriginalGraph_ = graph;
+  clonedNodes_.clear();
+  for (size_t i = 0; i < newNodes.size(); ++i) {
+    clonedNodes_[newNodes[i]] = matchedNodes[i];
+  }
+}
+
+// ================================================================================================
+bool GraphExec::CacheExec(GraphExec* graphExec) {
+  if ((DEBUG_HIP_GRAPH_INSTANTIATE_CACHE == 0) || (graphExec->fingerprint_ == 0)) {
+    return false;
+  }
+  GraphExec* evicted = nullptr;
+  {
+    amd::ScopedLock lock(execCacheLock_);
+    execCache_.push_front(graphExec);
+    if (execCache_.size() > DEBUG_HIP_GRAPH_INSTANTIATE_CACHE) {
+      // Evict the least recently destroyed exec
+      evicted = execCache_.back();
+      execCache_.pop_back();
+    }
+  }
+  if (evicted != nullptr) {
+    evicted->release();
+  }
+  return true;
+}
+
+// ================================================================================================
+GraphExec* GraphExec::TakeCachedExec(uint64_t fingerprint) {
+  if (fingerprint == 0) {
+    return nullptr;
+  }
+  amd::ScopedLock lock(execCacheLock_);
+  auto it = std::find_if(execCache_.begin(), execCache_.end(),
+                         [fingerprint](GraphExec* ge) { return ge->fingerprint_ == fingerprint; });
+  if (it == execCache_.end()) {
+    return nullptr;
+  }
+  GraphExec* graphExec = *it;
+  execCache_.erase(it);
+  return graphExec;
+}
+
+// ================================================================================================
+void GraphExec::ReleaseCachedExecs() {
+  std::list<GraphExec*> cache;
+  {
+    amd::ScopedLock lock(execCacheLock_);
+    cache.swap(execCache_);
+  }
+  for (auto graphExec : cache) {
+    graphExec->release();
+  }
+}
+
+// ================================================================================================
+bool GraphExec::CanCaptureMultiStream() const {
+  // Segments rely on the immediate submission of the accumulate commands for the waits
+  if (!AMD_DIRECT_DISPATCH) {
+    return false;
+  }
+  bool has_packets = false;
+  for (auto node : topoOrder_) {
+    // Child graphs are executed recursively on the parent streams
+    if (node->GetType() == hipGraphNodeTypeGraph) {
+      return false;
+    }
+    has_packets |= node->GraphCaptureEnabled();
+  }
+  return has_packets;
+}
+
+// ================================================================================================
+void GraphExec::BuildPacketSegments() {
+  segments_.clear();
+  for (auto node : topoOrder_) {
+    node->segment_id_ = -1;
+  }
+  // The list scheduler provides the launch order and the minimal waits,
+  // otherwise any topological order is valid, since it preserves the order on each stream
+  const bool list_schedule = !launch_order_.empty();
+  const std::vector<Node>& order = list_schedule ? launch_order_ : topoOrder_;
+  std::vector<int32_t> open_segment(max_streams_, -1);
+  std::vector<int32_t> waits(max_streams_, -1);
+  for (auto node : order) {
+    const int32_t stream_id = node->stream_id_;
+    const bool packets = node->GraphCaptureEnabled();
+    // Find the latest segment on every other stream this node depends on
+    bool has_waits = false;
+    std::fill(waits.begin(), waits.end(), -1);
+    const std::vector<Node>& deps = list_schedule ? node->wait_nodes_ : node->GetDependencies();
+    for (auto dep : deps) {
+      if (dep->stream_id_ != stream_id) {
+        waits[dep->stream_id_] = std::max(waits[dep->stream_id_], dep->segment_id_);
+        has_waits = true;
+      }
+    }
+    int32_t segment_id = open_segment[stream_id];
+    if ((segment_id == -1) || has_waits || !packets) {
+      segment_id = static_cast<int32_t>(segments_.size());
+      segments_.push_back({stream_id, packets, {}, {}});
+      for (auto wait : waits) {
+        if (wait != -1) {
+          segments_.back().waits_.push_back(wait);
+        }
+      }
+    }
+    segments_[segment_id].nodes_.push_back(node);
+    node->segment_id_ = segment_id;
+    // Other streams wait for the end of a segment, hence a signal producer closes the segment
+    open_segment[stream_id] = (packets && !node->signal_is_required_) ? segment_id : -1;
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_CODE, "[hipGraph] Multi-stream capture: nodes(%zu), segments(%zu)",
+          order.size(), segments_.size());
+}
+
 // ================================================================================================
 
 void GraphExec::DecrementRefCount(cl_event event, cl_int command_exec_status, void* user_data) {
-  GraphExec* graphExec = reinterpret_cast<GraphExec*>(user_data);
+  LaunchCallbackData* data = reinterpret_cast<LaunchCallbackData*>(user_data);
+  GraphExec* graphExec = data->graphExec_;
+  if (graphExec->kernArgManager_ != nullptr) {
+    // Kernel arg slots of this launch can be reused
+    graphExec->kernArgManager_->LaunchCompleted(data->launchId_);
+  }
+  delete data;
   graphExec->release();
 }
 
@@ -469,20 +1251,34 @@ hipError_t GraphExec::EnqueueGraphWithSingleList(hip::Stream* hip_stream) {
   if (DEBUG_CLR_GRAPH_PACKET_CAPTURE) {
     accumulate = new amd::AccumulateCommand(*hip_stream, {}, nullptr);
   }
+  // Consecutive captured packets share one doorbell ring
+  bool doorbell_batch = false;
   for (int i = 0; i < topoOrder_.size(); i++) {
     if (topoOrder_[i]->GraphCaptureEnabled()) {
       if (topoOrder_[i]->GetEnabled()) {
+        if (!doorbell_batch) {
+          hip_stream->vdev()->BeginDoorbellBatch();
+          doorbell_batch = true;
+        }
         std::vector<uint8_t*>& gpuPackets = topoOrder_[i]->GetAqlPackets();
         for (auto& packet : gpuPackets) {
           hip_stream->vdev()->dispatchAqlPacket(packet, topoOrder_[i]->GetKernelName(), accumulate);
         }
       }
     } else {
+      // The commands of other nodes may wait for the queue progress
+      if (doorbell_batch) {
+        hip_stream->vdev()->EndDoorbellBatch();
+        doorbell_batch = false;
+      }
       topoOrder_[i]->SetStream(hip_stream);
       status = topoOrder_[i]->CreateCommand(topoOrder_[i]->GetQueue());
       topoOrder_[i]->EnqueueCommands(hip_stream);
     }
   }
+  if (doorbell_batch) {
+    hip_stream->vdev()->EndDoorbellBatch();
+  }
 
   if (DEBUG_CLR_GRAPH_PACKET_CAPTURE) {
     accumulate->enqueue();
@@ -491,6 +1287,94 @@ hipError_t GraphExec::EnqueueGraphWithSingleList(hip::Stream* hip_stream) {
   return status;
 }
 
+// ================================================================================================
+hipError_t GraphExec::EnqueueGraphWithSegments(hip::Stream* launch_stream) {
+  hipError_t status = hipSuccess;
+  UpdateStreams(launch_stream, parallel_streams_);
+  segment_commands_.assign(segments_.size(), nullptr);
+  std::vector<int32_t> last_segment(max_streams_, -1);
+
+  // Parallel streams must wait for the previous work in the app's launch stream
+  constexpr bool kRetainCommand = true;
+  amd::Command* last_command = launch_stream->getLastQueuedCommand(kRetainCommand);
+
+  for (uint32_t i = 0; i < segments_.size(); ++i) {
+    const PacketSegment& segment = segments_[i];
+    hip::Stream* stream = streams_[segment.stream_id_];
+    amd::Command::EventWaitList waitList;
+    for (auto wait : segment.waits_) {
+      if (segment_commands_[wait] != nullptr) {
+        waitList.push_back(segment_commands_[wait]);
+      }
+    }
+    if ((segment.stream_id_ != 0) && (last_segment[segment.stream_id_] == -1) &&
+        (last_command != nullptr)) {
+      waitList.push_back(last_command);
+    }
+    if (segment.packets_) {
+      // A single barrier resolves all cross-stream waits before the packets of the segment
+      if (!waitList.empty()) {
+        auto start_marker = new amd::Marker(*stream, true, waitList);
+        start_marker->enqueue();
+        start_marker->release();
+      }
+      auto accumulate = new amd::AccumulateCommand(*stream, {}, nullptr);
+      stream->vdev()->BeginDoorbellBatch();
+      for (auto node : segment.nodes_) {
+        if (node->GetEnabled()) {
+          for (auto& packet : node->GetAqlPackets()) {
+            stream->vdev()->dispatchAqlPacket(packet, node->GetKernelName(), accumulate);
+          }
+        }
+      }
+      stream->vdev()->EndDoorbellBatch();
+      // Keep the reference for the waits in other streams
+      accumulate->enqueue();
+      segment_commands_[i] = accumulate;
+    } else {
+      Node node = segment.nodes_[0];
+      node->SetStream(streams_);
+      status = node->CreateCommand(node->GetQueue());
+      if (status != hipSuccess) {
+        LogPrintfError("Command creation for node id(%d) failed!", node->GetID());
+        break;
+      }
+      if (!waitList.empty()) {
+        node->UpdateEventWaitLists(waitList);
+      }
+      if (!node->GetCommands().empty()) {
+        segment_commands_[i] = node->GetCommands().back();
+        segment_commands_[i]->retain();
+      }
+      node->EnqueueCommands(node->GetQueue());
+    }
+    last_segment[segment.stream_id_] = i;
+  }
+  if (last_command != nullptr) {
+    last_command->release();
+  }
+
+  // The launch stream waits for the last segments on all parallel streams
+  amd::Command::EventWaitList waitList;
+  for (int32_t stream_id = 1; stream_id < max_streams_; ++stream_id) {
+    int32_t segment_id = last_segment[stream_id];
+    if ((segment_id != -1) && (segment_commands_[segment_id] != nullptr)) {
+      waitList.push_back(segment_commands_[segment_id]);
+    }
+  }
+  if (!waitList.empty()) {
+    auto end_marker = new amd::Marker(*launch_stream, true, waitList);
+    end_marker->enqueue();
+    end_marker->release();
+  }
+  for (auto command : segment_commands_) {
+    if (command != nullptr) {
+      command->release();
+    }
+  }
+  return status;
+}
+
 // ================================================================================================
 void Graph::UpdateStreams(hip::Stream* launch_stream,
                           const std::vector<hip::Stream*>& parallel_streams) {
@@ -599,6 +1483,40 @@ bool Graph::RunOneNode(Node node, bool wait) {
   return true;
 }
 
+// ================================================================================================
+bool Graph::RunScheduledNode(Node node) {
+  amd::Command::EventWaitList waitList;
+  // The list scheduler already removed the waits, covered transitively by other waits
+  for (auto dep : node->wait_nodes_) {
+    for (auto command : dep->GetCommands()) {
+      waitList.push_back(command);
+    }
+  }
+  // Assign a stream to the current node
+  node->SetStream(streams_);
+  // Create the execution commands on the assigned stream
+  auto status = node->CreateCommand(node->GetQueue());
+  if (status != hipSuccess) {
+    LogPrintfError("Command creation for node id(%d) failed!", current_id_ + 1);
+    return false;
+  }
+  // Retain all commands, since potentially the command can finish before a wait signal
+  for (auto command : node->GetCommands()) {
+    command->retain();
+  }
+  if (!waitList.empty()) {
+    node->UpdateEventWaitLists(waitList);
+  }
+  // Start the execution
+  node->EnqueueCommands(node->GetQueue());
+  node->launch_id_ = current_id_++;
+  if (node->GetEdges().empty()) {
+    // The launch order is in-order per stream, hence the last leaf is the latest one
+    leafs_[node->stream_id_] = node;
+  }
+  return true;
+}
+
 // ================================================================================================
 bool Graph::RunNodes(
     int32_t base_stream,
@@ -642,12 +1560,20 @@ bool Graph::RunNodes(
   }
 
   // Run all commands in the graph
-  for (auto node : vertices_) {
-    if (node->launch_id_ == -1) {
-      if (!RunOneNode(node, true)) {
+  if (!launch_order_.empty()) {
+    for (auto node : launch_order_) {
+      if (!RunScheduledNode(node)) {
         return false;
       }
     }
+  } else {
+    for (auto node : vertices_) {
+      if (node->launch_id_ == -1) {
+        if (!RunOneNode(node, true)) {
+          return false;
+        }
+      }
+    }
   }
   wait_list.clear();
   // Check if the graph has multiple leaf nodes
@@ -715,6 +1641,13 @@ hipError_t GraphExec::Run(hipStream_t graph_launch_stream) {
       }
     }
     status = EnqueueGraphWithSingleList(launch_stream);
+  } else if (!segments_.empty() && instantiateDeviceId_ == launch_stream->DeviceId()) {
+    static bool initialized = false;
+    if (!initialized && HasHiddenHeap()) {
+      launch_stream->vdev()->HiddenHeapInit();
+      initialized = true;
+    }
+    status = EnqueueGraphWithSegments(launch_stream);
   } else if (max_streams_ == 1 && instantiateDeviceId_ != launch_stream->DeviceId()) {
     for (int i = 0; i < topoOrder_.size(); i++) {
       topoOrder_[i]->SetStream(launch_stream);
@@ -736,7 +1669,11 @@ hipError_t GraphExec::Run(hipStream_t graph_launch_stream) {
   CallbackCommand->setEventScope(amd::Device::kCacheStateIgnore);
   amd::Event& event = CallbackCommand->event();
   constexpr bool kBlocking = false;
-  if (!event.setCallback(CL_COMPLETE, GraphExec::DecrementRefCount, this, kBlocking)) {
+  // Track the launch, so the updates don't overwrite kernel args in use
+  LaunchCallbackData* data = new LaunchCallbackData{
+      this, (kernArgManager_ != nullptr) ? kernArgManager_->LaunchStarted() : 0};
+  if (!event.setCallback(CL_COMPLETE, GraphExec::DecrementRefCount, data, kBlocking)) {
+    delete data;
     return hipErrorInvalidHandle;
   }
   CallbackCommand->enqueue();
@@ -768,8 +1705,136 @@ bool GraphKernelArgManager::AllocGraphKernargPool(size_t pool_size) {
   return true;
 }
 
+thread_local std::vector<GraphKernelArgManager::KernArgSlot>*
+    GraphKernelArgManager::owner_slots_ = nullptr;
+thread_local size_t GraphKernelArgManager::owner_index_ = 0;
+
+// ================================================================================================
 address GraphKernelArgManager::AllocKernArg(size_t size, size_t alignment) {
   assert(alignment != 0);
+  if (owner_slots_ == nullptr) {
+    amd::ScopedLock lock(alloc_lock_);
+    return AllocFromPool(size, alignment);
+  }
+  address result = nullptr;
+  if (owner_index_ < owner_slots_->size()) {
+    KernArgSlot& slot = (*owner_slots_)[owner_index_];
+    // Rewrite the slot in place if the new args fit and GPU can't access the old ones
+    if ((slot.addr_ != nullptr) && (size <= slot.size_) && (alignment <= slot.alignment_) &&
+        !IsLaunchInFlight()) {
+      result = slot.addr_;
+    } else {
+      amd::ScopedLock lock(alloc_lock_);
+      RetireSlot(slot);
+      slot = AllocSlot(size, alignment);
+      result = slot.addr_;
+    }
+  } else {
+    amd::ScopedLock lock(alloc_lock_);
+    KernArgSlot slot = AllocSlot(size, alignment);
+    owner_slots_->push_back(slot);
+    result = slot.addr_;
+  }
+  owner_index_++;
+  return result;
+}
+
+// ================================================================================================
+void GraphKernelArgManager::ReserveSlot(std::vector<KernArgSlot>* slots, size_t size,
+                                        size_t alignment) {
+  if (!slots->empty() || (size == 0)) {
+    return;
+  }
+  amd::ScopedLock lock(alloc_lock_);
+  slots->push_back(AllocSlot(size, alignment));
+}
+
+// ================================================================================================
+void GraphKernelArgManager::EndCapture() {
+  amd::ScopedLock lock(alloc_lock_);
+  // The node may require less kernel args after the update
+  for (size_t i = owner_index_; i < owner_slots_->size(); ++i) {
+    RetireSlot((*owner_slots_)[i]);
+  }
+  owner_slots_->resize(owner_index_);
+  owner_slots_ = nullptr;
+  owner_index_ = 0;
+}
+
+// ================================================================================================
+uint64_t GraphKernelArgManager::LaunchStarted() {
+  amd::ScopedLock lock(launch_lock_);
+  uint64_t launch_id = next_launch_id_++;
+  launches_in_flight_.insert(launch_id);
+  return launch_id;
+}
+
+// ================================================================================================
+void GraphKernelArgManager::LaunchCompleted(uint64_t launch_id) {
+  amd::ScopedLock lock(launch_lock_);
+  launches_in_flight_.erase(launch_id);
+}
+
+// ================================================================================================
+bool GraphKernelArgManager::IsLaunchInFlight() {
+  amd::ScopedLock lock(launch_lock_);
+  return !launches_in_flight_.empty();
+}
+
+// ================================================================================================
+void GraphKernelArgManager::RetireSlot(const KernArgSlot& slot) {
+  if (slot.addr_ == nullptr) {
+    return;
+  }
+  amd::ScopedLock lock(launch_lock_);
+  if (launches_in_flight_.empty()) {
+    free_slots_.push_back(slot);
+  } else {
+    // All launches, submitted so far, may still read the slot
+    retired_slots_.push_back({slot, next_launch_id_});
+  }
+}
+
+// ================================================================================================
+void GraphKernelArgManager::ReclaimSlots() {
+  amd::ScopedLock lock(launch_lock_);
+  uint64_t oldest_launch = launches_in_flight_.empty() ? std::numeric_limits<uint64_t>::max()
+                                                       : *launches_in_flight_.begin();
+  auto it = retired_slots_.begin();
+  while (it != retired_slots_.end()) {
+    // The slot is free if all launches, which could access it, are complete
+    if (it->launch_id_ <= oldest_launch) {
+      free_slots_.push_back(it->slot_);
+      it = retired_slots_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+// ================================================================================================
+GraphKernelArgManager::KernArgSlot GraphKernelArgManager::AllocSlot(size_t size,
+                                                                     size_t alignment) {
+  ReclaimSlots();
+  // Find the best fit in the free slots
+  auto best = free_slots_.end();
+  for (auto it = free_slots_.begin(); it != free_slots_.end(); ++it) {
+    if ((it->size_ >= size) && ((reinterpret_cast<uintptr_t>(it->addr_) % alignment) == 0) &&
+        ((best == free_slots_.end()) || (it->size_ < best->size_))) {
+      best = it;
+    }
+  }
+  if (best != free_slots_.end()) {
+    KernArgSlot slot = *best;
+    *best = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+  }
+  return {AllocFromPool(size, alignment), size, alignment};
+}
+
+// ================================================================================================
+address GraphKernelArgManager::AllocFromPool(size_t size, size_t alignment) {
   address result = nullptr;
   result = amd::alignUp(
       kernarg_graph_.back().kernarg_pool_addr_ + kernarg_graph_.back().kernarg_pool_offset_,
@@ -784,7 +1849,7 @@ address GraphKernelArgManager::AllocKernArg(size_t size, size_t alignment) {
       return nullptr;
     } else {
       // Allocte kernel arg memory from new chunck
-      return AllocKernArg(size, alignment);
+      return AllocFromPool(size, alignment);
     }
   }
   return result;
@@ -21,8 +21,10 @@
 #pragma once
 #include <algorithm>
 #include <queue>
+#include <set>
 #include <stack>
 #include <iostream>
+#include <list>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -34,6 +36,9 @@
 #include "hip_platform.hpp"
 #include "hip_mempool_impl.hpp"
 #include "hip_vm.hpp"
+#include "hip_handle_table.hpp"
+#include "hip_graph_scheduler.hpp"
+#include "hip_graph_arena.hpp"
 
 typedef struct ihipExtKernelEvents {
   hipEvent_t startEvent_;
@@ -154,7 +159,15 @@ class hipGraphNodeDOTAttribute {
 class GraphKernelArgManager : public amd::ReferenceCountedObject,
                               public amd::GraphKernelArgManager {
  public:
-  GraphKernelArgManager() : amd::ReferenceCountedObject() {}
+  //! Kernel arg slot, owned by a captured graph node and rewritten on the node updates
+  struct KernArgSlot {
+    address addr_;      //! Slot address in the kernel arg pool
+    size_t size_;       //! Slot size
+    size_t alignment_;  //! Alignment of the slot address
+  };
+
+  GraphKernelArgManager()
+      : amd::ReferenceCountedObject(), alloc_lock_(true), launch_lock_(true) {}
   ~GraphKernelArgManager() {
     //! Release the kernel arg pools
     if (device_ != nullptr) {
@@ -175,7 +188,48 @@ class GraphKernelArgManager : public amd::ReferenceCountedObject,
   // Do HDP flush/When HDP flush register is invalid fallback to Readback
   void ReadBackOrFlush();
 
+  // Start packet capture for a node. Kernel args are allocated from the slots owned by the node.
+  // The capture state is per thread, so the nodes can be captured concurrently.
+  void BeginCapture(std::vector<KernArgSlot>* slots) {
+    owner_slots_ = slots;
+    owner_index_ = 0;
+  }
+
+  // Assign a slot to the node before the capture, if the node doesn't own any slot yet.
+  // The concurrent capture doesn't allocate from the pool, hence the pool layout doesn't depend
+  // on the capture order.
+  void ReserveSlot(std::vector<KernArgSlot>* slots, size_t size, size_t alignment);
+
+  // Finish packet capture for a node and retire the slots the node doesn't use anymore.
+  void EndCapture();
+
+  // Register a new graph launch, which can access kernel args. Returns the launch ID.
+  uint64_t LaunchStarted();
+
+  // Notify that the launch with the provided ID is complete.
+  void LaunchCompleted(uint64_t launch_id);
+
  private:
+  // Returns true if any graph launch may still access the kernel arg pool.
+  bool IsLaunchInFlight();
+
+  // Move retired slots, which can't be accessed by GPU anymore, into the free list.
+  void ReclaimSlots();
+
+  // Allocate a new slot from the free list or from the kernel arg pool.
+  KernArgSlot AllocSlot(size_t size, size_t alignment);
+
+  // Allocate kernel args from the current chunk of the kernel arg pool.
+  address AllocFromPool(size_t size, size_t alignment);
+
+  // Retire slot, which may be still in use by the launches in flight.
+  void RetireSlot(const KernArgSlot& slot);
+
+  struct RetiredSlot {
+    KernArgSlot slot_;    //! Retired slot
+    uint64_t launch_id_;  //! Launches below this ID may still access the slot
+  };
+
   struct KernelArgPoolGraph {
     KernelArgPoolGraph(address base_addr, size_t size)
         : kernarg_pool_addr_(base_addr), kernarg_pool_size_(size), kernarg_pool_offset_(0) {}
@@ -186,11 +240,24 @@ class GraphKernelArgManager : public amd::ReferenceCountedObject,
   bool device_kernarg_pool_ = false;  //! Indicate if kernel pool in device mem
   amd::Device* device_ = nullptr;     //! Device from where kernel arguments are allocated
   std::vector<KernelArgPoolGraph> kernarg_graph_;  //! Vector of allocated kernarg pool
+  static thread_local std::vector<KernArgSlot>* owner_slots_;  //! Slots of the node under capture
+  static thread_local size_t owner_index_;  //! Next slot of the node under capture
+  amd::Monitor alloc_lock_;                 //! Guards the pool and the free slots
+  std::vector<KernArgSlot> free_slots_;     //! Slots available for reuse
+  std::vector<RetiredSlot> retired_slots_;  //! Slots waiting for the launches completion
+  amd::Monitor launch_lock_;                //! Guards the launches in flight
+  std::set<uint64_t> launches_in_flight_;   //! IDs of the launches, which aren't complete
+  uint64_t next_launch_id_ = 0;             //! ID of the next graph launch
   using KernelArgImpl = device::Settings::KernelArgImpl;
 };
 
 class GraphNode : public hipGraphNodeDOTAttribute {
  public:
+  /// Allocates the node in the arena of the current thread or on the C-heap
+  static void* operator new(size_t size) { return GraphNodeArena::AllocNode(size); }
+  /// Releases the node memory. The arena memory is released with the arena
+  static void operator delete(void* ptr) { GraphNodeArena::FreeNode(ptr); }
+
   GraphNode(hipGraphNodeType type, std::string style = "", std::string shape = "",
             std::string label = "")
       : type_(type),
@@ -201,8 +268,7 @@ class GraphNode : public hipGraphNodeDOTAttribute {
         parentGraph_(nullptr),
         isEnabled_(1),
         hipGraphNodeDOTAttribute(style, shape, label) {
-    amd::ScopedLock lock(nodeSetLock_);
-    nodeSet_.insert(this);
+    nodeHandles_.Insert(this);
   }
   /// Copy Constructor
   GraphNode(const GraphNode& node) : hipGraphNodeDOTAttribute(node) {
@@ -212,8 +278,7 @@ class GraphNode : public hipGraphNodeDOTAttribute {
     visited_ = false;
     id_ = node.id_;
     parentGraph_ = nullptr;
-    amd::ScopedLock lock(nodeSetLock_);
-    nodeSet_.insert(this);
+    nodeHandles_.Insert(this);
     isEnabled_ = node.isEnabled_;
   }
 
@@ -227,18 +292,11 @@ class GraphNode : public hipGraphNodeDOTAttribute {
     for (auto packet : gpuPackets_) {
       delete[] packet;
     }
-    amd::ScopedLock lock(nodeSetLock_);
-    nodeSet_.erase(this);
+    nodeHandles_.Erase(this);
   }
 
   // check node validity
-  static bool isNodeValid(GraphNode* pGraphNode) {
-    amd::ScopedLock lock(nodeSetLock_);
-    if (pGraphNode == nullptr || nodeSet_.find(pGraphNode) == nodeSet_.end()) {
-      return false;
-    }
-    return true;
-  }
+  static bool isNodeValid(GraphNode* pGraphNode) { return nodeHandles_.Contains(pGraphNode); }
   // Return gpu packet address to update with actual packet under capture.
   std::vector<uint8_t*>& GetAqlPackets() { return gpuPackets_; }
   void SetKernelName(const std::string& kernelName) { capturedKernelName_ = kernelName; }
@@ -252,7 +310,13 @@ class GraphNode : public hipGraphNodeDOTAttribute {
       return status;
     }
 
+    // Packets are copied into the HW queue on dispatch, hence the old ones can be freed
+    for (auto packet : gpuPackets_) {
+      delete[] packet;
+    }
     gpuPackets_.clear();
+    // Kernel args are written into the slots, owned by the node, if possible
+    kernArgMgr->BeginCapture(&kernArgSlots_);
     for (auto& command : commands_) {
       command->setPktCapturingState(true, &gpuPackets_, kernArgMgr, &capturedKernelName_);
       // Enqueue command to capture GPU Packet. The packet is not submitted to the device.
@@ -260,6 +324,7 @@ class GraphNode : public hipGraphNodeDOTAttribute {
       command->submit(*(command->queue())->vdev());
       command->release();
     }
+    kernArgMgr->EndCapture();
     // Commands are captured and released. Clear them from the object.
     commands_.clear();
 
@@ -285,6 +350,32 @@ class GraphNode : public hipGraphNodeDOTAttribute {
   }
   /// Return node unique ID
   int GetID() const { return id_; }
+  /// Returns the relative execution cost of the node, used by the graph list scheduler
+  virtual uint64_t GetCostEstimate() const { return kLaunchCost; }
+  /// Returns the hash of the node function identity, used by the exec update node matching
+  virtual size_t GetIdentityHash() const { return 0; }
+  /// Returns true if the node parameters are identical to the parameters of the node
+  /// with the same type. The default is conservative and always reports a change
+  virtual bool IsParamsEqual(const GraphNode* node) const { return false; }
+  /// Restores the node state, which the app can change on an exec node outside of the node
+  /// parameters, from the node with the same type. Returns true if the state was changed
+  virtual bool RefreshState(const GraphNode* node) {
+    const bool changed = (isEnabled_ != node->isEnabled_);
+    isEnabled_ = node->isEnabled_;
+    return changed;
+  }
+  /// Describes the node as an entry of the batched blit. Returns false if it can't be batched
+  virtual bool GetBatchEntry(amd::BatchCopyFillEntry* entry) const { return false; }
+  /// Creates the batched blit command in the batch owner, other fused nodes have no commands.
+  /// Falls back to the individual commands if the batch isn't valid anymore
+  hipError_t CreateBatchCommand(hip::Stream* stream);
+  /// Returns the nodes of the batch with this node to the individual execution
+  std::vector<Node> DetachBatch();
+  /// Returns the node, which dispatches the batched blit with this node
+  Node GetBatchOwner() const { return batch_owner_; }
+  /// Returns true if the AQL packets of the node don't depend on the capture queue,
+  /// so the node can be captured on a worker thread
+  virtual bool CanCaptureConcurrently() const { return false; }
   /// Returns command for graph node
   virtual std::vector<amd::Command*>& GetCommands() { return commands_; }
   /// Returns graph node type
@@ -307,6 +398,8 @@ class GraphNode : public hipGraphNodeDOTAttribute {
       dependencies_.push_back(entry);
     }
   }
+  /// Returns the dependencies, removed by the transitive reduction of the executable graph
+  const std::vector<Node>& GetPrunedDependencies() const { return pruned_dependencies_; }
   /// Add graph node dependency
   void AddDependency(const Node& node) {
     dependencies_.push_back(node);
@@ -459,14 +552,25 @@ class GraphNode : public hipGraphNodeDOTAttribute {
   size_t outDegree_;        //!< count of outgoing edges (@todo: remove, it's edges_.size())
   int32_t stream_id_ = -1;  //! Stream ID on which this node will be executed
   int32_t launch_id_ = -1;  //! Launch ID of this node in the entire graph execution sequence
+  uint32_t vertex_index_ = 0;  //! Index of this node in the vertices of the parent graph
   static int nextID;
+  //! Fixed cost of a node launch in the scheduler units. A unit is roughly one wavefront of work
+  static constexpr uint64_t kLaunchCost = 16;
   Graph* parentGraph_;
-  static std::unordered_set<GraphNode*> nodeSet_;
-  static amd::Monitor nodeSetLock_;
+  static HandleTable<GraphNode> nodeHandles_;  //!< Live nodes for the handle validation
   static amd::Monitor WorkerThreadLock_;
   unsigned int isEnabled_;
   bool signal_is_required_ = false;   //!< This node requires a signal on the command
+  std::vector<Node> wait_nodes_;      //!< Cross-stream nodes to wait for, from the list scheduler
+  std::vector<Node> pruned_dependencies_;  //!< Dependencies implied by other paths
+  Node batch_owner_ = nullptr;        //!< Node, which dispatches the fused blit of this node
+  std::vector<Node> batch_nodes_;     //!< Nodes of the fused blit in the batch owner
+  //! Entries of the fused blit in the batch owner, validated at every launch
+  std::vector<amd::BatchCopyFillEntry> batch_entries_;
+  int32_t segment_id_ = -1;           //!< Packet segment of the node in the multi-stream capture
   std::vector<uint8_t*> gpuPackets_;  //!< GPU Packet to enqueue during graph launch
+  //! Kernel arg slots of the captured packets, reused on the node updates
+  std::vector<GraphKernelArgManager::KernArgSlot> kernArgSlots_;
   std::string capturedKernelName_;
   size_t alignedKernArgSize_ = 256;       //!< Aligned size required for kernel args
   size_t kernargSegmentByteSize_ = 512;   //!< Kernel arg segment byte size
@@ -477,12 +581,11 @@ class Graph {
  public:
   //!< Contains mem alloc dptrs whose corresponding free node is not added to the graph.
   std::unordered_set<void*> memAllocNodePtrs_;
-  static std::unordered_set<Graph*> graphSet_;
+  static HandleTable<Graph> graphHandles_;  //!< Live graphs for the handle validation
   static amd::Monitor graphSetLock_;
   Graph(hip::Device* device, const Graph* original = nullptr)
       : pOriginalGraph_(original), id_(nextID++), device_(device) {
-    amd::ScopedLock lock(graphSetLock_);
-    graphSet_.insert(this);
+    graphHandles_.Insert(this);
     mem_pool_ = device->GetGraphMemoryPool();
     graphInstantiated_ = false;
     roots_.resize(DEBUG_HIP_FORCE_GRAPH_QUEUES);
@@ -500,8 +603,8 @@ class Graph {
     for (auto node : vertices_) {
       delete node;
     }
+    graphHandles_.Erase(this);
     amd::ScopedLock lock(graphSetLock_);
-    graphSet_.erase(this);
     for (auto& userobj : graphUserObj_) {
       // Graph is destorying so remove it from user object's graph list.
       userobj.first->owning_graphs_.erase(this);
@@ -526,6 +629,12 @@ class Graph {
 
   void AddManualNodeDuringCapture(GraphNode* node) { capturedNodes_.insert(node); }
 
+  /// Tracks the streams, which capture into the graph
+  void AddCaptureStream() { captureStreams_.fetch_add(1, std::memory_order_relaxed); }
+  void RemoveCaptureStream() { captureStreams_.fetch_sub(1, std::memory_order_relaxed); }
+  /// Returns true if any stream captures into the graph
+  bool IsCaptureTarget() const { return captureStreams_.load(std::memory_order_relaxed) != 0; }
+
   std::unordered_set<GraphNode*> GetManualNodesDuringCapture() { return capturedNodes_; }
 
   void RemoveManualNodesDuringCapture() {
@@ -596,6 +705,10 @@ class Graph {
   //! Schedules all nodes in the graph into different streams
   void ScheduleNodes();
 
+  //! Schedules all nodes with the critical path list scheduler, based on the node cost estimate.
+  //! Returns false if the graph can't be list scheduled and the default scheduling must be used
+  bool ListScheduleNodes();
+
   //! Update streams for the graph execution
   void UpdateStreams(
     hip::Stream* launch_stream, //!< Launch stream from the application
@@ -608,6 +721,11 @@ class Graph {
     bool wait     //!< Wait dependencies
     );
 
+  //! Runs one node in the list scheduler launch order, without recursion into the edges
+  bool RunScheduledNode(
+    Node node     //!< Node for the execution on GPU
+    );
+
   //! Runs all nodes from the execution graph on the assigned streams
   bool RunNodes(
     int32_t base_stream = 0,  //!< The base stream to run the graph on
@@ -616,12 +734,20 @@ class Graph {
   );
 
   bool TopologicalOrder(std::vector<Node>& TopoOrder);
+  //! Removes the edges, implied by other paths in the graph. Returns the number of removed edges
+  uint32_t ReduceTransitiveEdges();
+  //! Builds the compressed sparse row adjacency over the vertex indices
+  void BuildAdjacency();
 
   void clone(Graph* newGraph, bool cloneNodes = false) const;
   Graph* clone() const;
   void GenerateDOT(std::ostream& fout, hipGraphDebugDotFlags flag) {
     fout << "subgraph cluster_" << GetID() << " {" << std::endl;
-    fout << "label=\"graph_" << GetID() <<"\"graph[style=\"dashed\"];\n";
+    fout << "label=\"graph_" << GetID();
+    if (removed_edges_ > 0) {
+      fout << "\\nRemovedTransitiveEdges: " << removed_edges_;
+    }
+    fout << "\"graph[style=\"dashed\"];\n";
     for (auto node : vertices_) {
       node->GenerateDOTNode(GetID(), fout, flag);
     }
@@ -707,6 +833,9 @@ class Graph {
   void DecrementMemAllocNodeCount() { memalloc_nodes_--; }
   //! returns device object
   hip::Device* Device() { return device_; }
+  //! Returns the fingerprint of the graph topology and the node functions for the provided
+  //! instantiation flags. Returns 0 if the graph can't be reused from the instantiation cache
+  uint64_t Fingerprint(uint64_t flags);
 
  protected:
   int max_streams_ = 0;  //!< Maximum number of streams used in the graph launch
@@ -725,26 +854,34 @@ class Graph {
   //!< Used as a temporary storage for the waiting nodes
   //!< to reduce the stack pressure in recursion
   std::vector<Node> wait_order_;
+  std::vector<Node> launch_order_;     //!< Launch sequence of the nodes from the list scheduler
   std::vector<hip::Stream*> streams_;  //!< The list of streams, used in the execution
   int32_t current_id_ = 0;             //!< The current node ID in the graph execution sequence
   hip::Device* device_;                //!< HIP device object
   hip::MemoryPool* mem_pool_;          //!< Memory pool, associated with this graph
   std::unordered_set<GraphNode*> capturedNodes_;
+  std::atomic<uint32_t> captureStreams_{0};  //!< Number of streams, capturing into the graph
   bool graphInstantiated_;
   std::unordered_map<Node, Node> clonedNodes_;
+  uint32_t removed_edges_ = 0;  //!< Number of edges removed by the transitive reduction
+  //! Compressed sparse row adjacency of the vertices, built at the instantiation
+  std::vector<uint32_t> edgeOffsets_;  //!< Start of the edges of every vertex, size + 1
+  std::vector<uint32_t> edgeTargets_;  //!< Vertex indices of the edges
+  //! Arena for the cloned nodes. Must be declared after all members, which refer to the nodes
+  GraphNodeArena nodeArena_;
 };
 
 class GraphExec : public amd::ReferenceCountedObject, public Graph {
  public:
-  static std::unordered_set<GraphExec*> graphExecSet_;
-  static amd::Monitor graphExecSetLock_;
+  static HandleTable<GraphExec> graphExecHandles_;  //!< Live execs for the handle validation
   GraphExec(uint64_t flags = 0)
       : ReferenceCountedObject(), Graph(hip::getCurrentDevice()), flags_(flags) {
-    amd::ScopedLock lock(graphExecSetLock_);
-    graphExecSet_.insert(this);
+    graphExecHandles_.Insert(this);
   }
 
   ~GraphExec() {
+    // Child graph nodes never go through hipGraphExecDestroy
+    graphExecHandles_.Erase(this);
     for (auto stream : parallel_streams_) {
       if (stream != nullptr) {
         constexpr bool kForceDestroy = true;
@@ -756,6 +893,9 @@ class GraphExec : public amd::ReferenceCountedObject, public Graph {
         kernArgManager_->release();
       }
     }
+    if (memAliasBacking_ != nullptr) {
+      amd::SvmBuffer::free(memAliasBacking_->getContext(), memAliasBacking_->getSvmPtr());
+    }
     if (instantiateDeviceId_ != -1) {
       static_cast<ReferenceCountedObject*>(g_devices[instantiateDeviceId_])->release();
     }
@@ -786,6 +926,13 @@ class GraphExec : public amd::ReferenceCountedObject, public Graph {
   // Capture GPU Packets from graph commands
   hipError_t CaptureAQLPackets();
   hipError_t UpdateAQLPacket(hip::GraphNode* node);
+  //! Fuses the chains of small memset and memcpy nodes into batched blits
+  void FuseBlitNodes();
+  //! Restores the individual execution of all nodes in the blit batch of the provided owner
+  hipError_t SplitBlitBatch(Node owner);
+  //! Assigns the offsets in one backing to the graph allocations freed inside the graph,
+  //! so the allocations with disjoint lifetimes share the same memory
+  void PlanMemoryAliasing();
   // Kenrel arg manger is for the entire graph.
   // Child graph also shares the same kernel arg manager object. some apps have 100's of
   // child graph nodes and each child graph has only one node.
@@ -796,25 +943,88 @@ class GraphExec : public amd::ReferenceCountedObject, public Graph {
     return kernArgManager_;
   }
   static void DecrementRefCount(cl_event event, cl_int command_exec_status, void* user_data);
-  hipError_t AllocKernelArgForGraphNode();
+  //! Data for the launch completion callback
+  struct LaunchCallbackData {
+    GraphExec* graphExec_;  //!< Launched graph
+    uint64_t launchId_;     //!< Launch ID in the kernel arg manager
+  };
+  //! Captures AQL packets of the nodes. The kernel nodes are only added into the deferred list
+  //! with the reserved kernel args, if the list is provided
+  hipError_t AllocKernelArgForGraphNode(std::vector<Node>* deferredNodes = nullptr);
+  //! Captures AQL packets of the kernel nodes with the reserved kernel args on the worker threads
+  hipError_t CaptureNodesParallel(const std::vector<Node>& nodes, uint32_t numThreads);
   void GetKernelArgSizeForGraph(size_t& kernArgSizeForGraph);
   hipError_t EnqueueGraphWithSingleList(hip::Stream* hip_stream);
+  //! Dispatches the captured packet segments of a multi-stream graph on the parallel streams
+  hipError_t EnqueueGraphWithSegments(hip::Stream* launch_stream);
+  //! Returns true if AQL packets can be captured for the multi-stream graph
+  bool CanCaptureMultiStream() const;
+  //! Splits the multi-stream graph into per-stream packet segments, separated by stream waits
+  void BuildPacketSegments();
   bool TopologicalOrder() { return Graph::TopologicalOrder(topoOrder_); }
 
+  //! Statistics of the last exec update
+  struct UpdateStats {
+    uint32_t nodes_reordered_ = 0;    //!< Nodes matched at a different topological position
+    uint32_t nodes_touched_ = 0;      //!< Nodes with the changed parameters
+    uint32_t packets_rewritten_ = 0;  //!< Nodes with the recaptured AQL packets
+  };
+  //! Matches the nodes of the new graph with the executable nodes by the structure signature,
+  //! which doesn't depend on the topological order. Returns false if the topology changed
+  bool MatchNodes(const std::vector<Node>& newNodes, std::vector<Node>* matchedNodes,
+                  Node* errorNode);
+  UpdateStats& GetUpdateStats() { return update_stats_; }
+  //! Maps the nodes of the new graph into the exec nodes, when the exec is reused for the graph
+  void RemapClonedNodes(const Graph* graph, const std::vector<Node>& newNodes,
+                        const std::vector<Node>& matchedNodes);
+  void SetFingerprint(uint64_t fingerprint) { fingerprint_ = fingerprint; }
+  //! Keeps the destroyed exec in the instantiation cache. Returns false if it can't be cached
+  static bool CacheExec(GraphExec* graphExec);
+  //! Removes the most recently cached exec with the fingerprint from the instantiation cache
+  static GraphExec* TakeCachedExec(uint64_t fingerprint);
+  //! Releases all execs in the instantiation cache
+  static void ReleaseCachedExecs();
+
  protected:
+  UpdateStats update_stats_;                       //!< Statistics of the last exec update
+  //! A sequence of nodes on one stream, which doesn't have any cross-stream waits inside.
+  //! The packet segments dispatch the captured AQL packets with a single accumulate command.
+  struct PacketSegment {
+    int32_t stream_id_;            //!< Stream ID of the segment
+    bool packets_;                 //!< Segment has captured AQL packets, otherwise a single node
+    std::vector<Node> nodes_;      //!< Nodes of the segment in the launch order
+    std::vector<int32_t> waits_;   //!< Segments on other streams to wait for before the launch
+  };
+  std::vector<PacketSegment> segments_;           //!< Packet segments for multi-stream graphs
+  std::vector<amd::Command*> segment_commands_;   //!< Completion commands of the launched segments
+
   //! Topological order of the graph doesn't include nodes embedded as part of the child graph
   std::vector<Node> topoOrder_;
   std::vector<hip::Stream*> parallel_streams_;
   hip::Stream* capture_stream_;
   uint64_t flags_ = 0;
+  uint64_t fingerprint_ = 0;  //!< Fingerprint of the instantiated graph, 0 if it can't be cached
+  static std::list<GraphExec*> execCache_;   //!< Destroyed execs, the most recent first
+  static amd::Monitor execCacheLock_;        //!< Guards the instantiation cache
   GraphKernelArgManager* kernArgManager_ = nullptr;  //!< Kernel Arg manager for graph.
   int instantiateDeviceId_ = -1;
   bool hasHiddenHeap_ = false;  //!< Hidden heap indicator for Kernel node
   bool repeatLaunch_ = false;
+  amd::Memory* memAliasBacking_ = nullptr;  //!< Physical memory of the aliased allocations
 };
 
 class ChildGraphNode : public GraphNode, public GraphExec {
  public:
+  /// The node is reference counted and may outlive the arena of its graph, hence it's always
+  /// allocated on the C-heap, but with the node header. Resolves the ambiguity between
+  /// the GraphNode and ReferenceCountedObject operators
+  static void* operator new(size_t size) {
+    GraphNodeArena::Scope scope(nullptr);
+    return GraphNodeArena::AllocNode(size);
+  }
+  /// Releases the node through the node header, also on the last release()
+  static void operator delete(void* ptr) { GraphNodeArena::FreeNode(ptr); }
+
   ChildGraphNode(Graph* g) : GraphNode(hipGraphNodeTypeGraph, "solid", "rectangle"), GraphExec() {
     g->clone(this);
     graphCaptureStatus_ = false;
@@ -889,8 +1099,35 @@ class ChildGraphNode : public GraphNode, public GraphExec {
   bool graphCaptureStatus_;
 };
 
+//! Argument buffers of a kernel node. The clones of the node share the buffers until one of
+//! the nodes changes the arguments, so the graph clones don't copy the arguments (copy-on-write)
+class GraphKernelArgs : public amd::ReferenceCountedObject {
+ public:
+  GraphKernelArgs() {}
+
+  void** kernelParams_ = nullptr;  //!< Arguments passed with 'kernelParams'
+  uint32_t numParams_ = 0;         //!< Number of the arguments in 'kernelParams'
+  void** extra_ = nullptr;         //!< Arguments passed with 'extra'
+  bool exposed_ = false;           //!< The app has the buffer pointers and can change them
+
+ protected:
+  ~GraphKernelArgs() {
+    if (kernelParams_ != nullptr) {
+      for (uint32_t i = 0; i < numParams_; ++i) {
+        free(kernelParams_[i]);
+      }
+      free(kernelParams_);
+    } else if (extra_ != nullptr) {
+      free(extra_[1]);
+      free(extra_[3]);
+      free(extra_);
+    }
+  }
+};
+
 class GraphKernelNode : public GraphNode {
   hipKernelNodeParams kernelParams_;   //!< Kernel node parameters
+  GraphKernelArgs* kernelArgs_ = nullptr;  //!< Argument buffers, shared with the clones
   unsigned int numParams_;             //!< No. of kernel params as part of signature
   hipKernelNodeAttrValue kernelAttr_;  //!< Kernel node attributes
   unsigned int kernelAttrInUse_;       //!< Kernel attributes in use
@@ -1016,7 +1253,10 @@ class GraphKernelNode : public GraphNode {
     return func;
   }
 
-  hipError_t copyParams(const hipKernelNodeParams* pNodeParams) {
+  //! Copies the node parameters. The argument buffers are shared with the provided
+  //! buffers object instead of the allocation if it isn't nullptr
+  hipError_t copyParams(const hipKernelNodeParams* pNodeParams,
+                        GraphKernelArgs* sharedArgs = nullptr) {
     hasHiddenHeap_ = false;
     hipFunction_t func = getFunc(*pNodeParams, ihipGetDevice());
     if (!func) {
@@ -1038,12 +1278,30 @@ class GraphKernelNode : public GraphNode {
     // Copy gridDim, blockDim, sharedMemBytes and func
     kernelParams_ = *pNodeParams;
 
+    if (pNodeParams->kernelParams != nullptr) {
+      for (uint32_t i = signature.numParameters(); i < signature.numParametersAll(); ++i) {
+        if (signature.at(i).info_.oclObject_ == amd::KernelParameterDescriptor::HiddenHeap) {
+          hasHiddenHeap_ = true;
+        }
+      }
+    }
+
+    if ((sharedArgs != nullptr) && ((pNodeParams->kernelParams != nullptr) ||
+                                    (pNodeParams->extra != nullptr))) {
+      sharedArgs->retain();
+      kernelArgs_ = sharedArgs;
+      return hipSuccess;
+    }
+
     // Allocate/assign memory if params are passed part of 'kernelParams'
     if (pNodeParams->kernelParams != nullptr) {
-      kernelParams_.kernelParams = (void**)malloc(numParams_ * sizeof(void*));
+      kernelParams_.kernelParams = (void**)calloc(numParams_, sizeof(void*));
       if (kernelParams_.kernelParams == nullptr) {
         return hipErrorOutOfMemory;
       }
+      kernelArgs_ = new GraphKernelArgs();
+      kernelArgs_->kernelParams_ = kernelParams_.kernelParams;
+      kernelArgs_->numParams_ = numParams_;
 
       for (uint32_t i = 0; i < numParams_; ++i) {
         const amd::KernelParameterDescriptor& desc = signature.at(i);
@@ -1053,11 +1311,6 @@ class GraphKernelNode : public GraphNode {
         }
         ::memcpy(kernelParams_.kernelParams[i], (pNodeParams->kernelParams[i]), desc.size_);
       }
-      for (uint32_t i = signature.numParameters(); i < signature.numParametersAll(); ++i) {
-        if (signature.at(i).info_.oclObject_ == amd::KernelParameterDescriptor::HiddenHeap) {
-          hasHiddenHeap_ = true;
-        }
-      }
     }
 
     // Allocate/assign memory if params are passed as part of 'extra'
@@ -1067,10 +1320,12 @@ class GraphKernelNode : public GraphNode {
       // HIP_LAUNCH_PARAM_BUFFER_SIZE, &kernargs_size,
       // HIP_LAUNCH_PARAM_END }
       unsigned int numExtra = 5;
-      kernelParams_.extra = (void**)malloc(numExtra * sizeof(void*));
+      kernelParams_.extra = (void**)calloc(numExtra, sizeof(void*));
       if (kernelParams_.extra == nullptr) {
         return hipErrorOutOfMemory;
       }
+      kernelArgs_ = new GraphKernelArgs();
+      kernelArgs_->extra_ = kernelParams_.extra;
       kernelParams_.extra[0] = pNodeParams->extra[0];
       size_t kernargs_size = *((size_t*)pNodeParams->extra[3]);
       kernelParams_.extra[1] = malloc(kernargs_size);
@@ -1108,32 +1363,35 @@ class GraphKernelNode : public GraphNode {
   ~GraphKernelNode() { freeParams(); }
 
   void freeParams() {
-    // Deallocate memory allocated for kernargs passed via 'kernelParams'
-    if (kernelParams_.kernelParams != nullptr) {
-      for (size_t i = 0; i < numParams_; ++i) {
-        if (kernelParams_.kernelParams[i] != nullptr) {
-          free(kernelParams_.kernelParams[i]);
-        }
-        kernelParams_.kernelParams[i] = nullptr;
-      }
-      free(kernelParams_.kernelParams);
-      kernelParams_.kernelParams = nullptr;
+    // The buffers are released with the last node, which shares them
+    if (kernelArgs_ != nullptr) {
+      kernelArgs_->release();
+      kernelArgs_ = nullptr;
     }
-    // Deallocate memory allocated for kernargs passed via 'extra'
-    else if (kernelParams_.extra != nullptr) {
-      free(kernelParams_.extra[1]);
-      free(kernelParams_.extra[3]);
-      memset(kernelParams_.extra, 0, 5 * sizeof(kernelParams_.extra[0]));  // 5 items
-      free(kernelParams_.extra);
-      kernelParams_.extra = nullptr;
+    kernelParams_.kernelParams = nullptr;
+    kernelParams_.extra = nullptr;
+  }
+
+  //! Makes a private copy of the argument buffers before the node exposes them for a change
+  hipError_t unshareParams() {
+    if ((kernelArgs_ == nullptr) || (kernelArgs_->referenceCount() == 1)) {
+      return hipSuccess;
     }
+    GraphKernelArgs* sharedArgs = kernelArgs_;
+    hipKernelNodeParams params = kernelParams_;
+    kernelArgs_ = nullptr;
+    hipError_t status = copyParams(&params);
+    sharedArgs->release();
+    return status;
   }
 
   GraphKernelNode(const GraphKernelNode& rhs) : GraphNode(rhs) {
     kernelParams_ = rhs.kernelParams_;
     kernelEvents_ = rhs.kernelEvents_;
     coopKernel_ = rhs.coopKernel_;
-    hipError_t status = copyParams(&rhs.kernelParams_);
+    // The app can change the exposed buffers in place, so the clone needs own copy of them
+    hipError_t status = copyParams(&rhs.kernelParams_,
+        ((rhs.kernelArgs_ != nullptr) && !rhs.kernelArgs_->exposed_) ? rhs.kernelArgs_ : nullptr);
     if (status != hipSuccess) {
       ClPrint(amd::LOG_ERROR, amd::LOG_CODE, "[hipGraph] Failed to allocate memory to copy params");
     }
@@ -1194,7 +1452,95 @@ class GraphKernelNode : public GraphNode {
     return status;
   }
 
-  void GetParams(hipKernelNodeParams* params) { *params = kernelParams_; }
+  void GetParams(hipKernelNodeParams* params) {
+    // The app may change the returned buffers in place, hence they can't be shared anymore
+    if ((unshareParams() == hipSuccess) && (kernelArgs_ != nullptr)) {
+      kernelArgs_->exposed_ = true;
+    }
+    *params = kernelParams_;
+  }
+
+  uint64_t GetCostEstimate() const override {
+    uint64_t workItems = static_cast<uint64_t>(kernelParams_.gridDim.x) *
+        kernelParams_.gridDim.y * kernelParams_.gridDim.z * kernelParams_.blockDim.x *
+        kernelParams_.blockDim.y * kernelParams_.blockDim.z;
+    // Wavefront count is a good enough approximation without kernel profiling data
+    return kLaunchCost + workItems / 64;
+  }
+
+  size_t GetIdentityHash() const override { return std::hash<void*>()(kernelParams_.func); }
+
+  bool CanCaptureConcurrently() const override {
+    hipFunction_t func = getFunc(kernelParams_, ihipGetDevice());
+    if ((func == nullptr) || coopKernel_) {
+      return false;
+    }
+    // The buffers of the capture queue can't be referenced, the worker queues are temporary
+    const amd::KernelSignature& signature =
+        hip::DeviceFunc::asFunction(func)->kernel()->signature();
+    for (uint32_t i = signature.numParameters(); i < signature.numParametersAll(); ++i) {
+      switch (signature.at(i).info_.oclObject_) {
+        case amd::KernelParameterDescriptor::HiddenPrintfBuffer:
+        case amd::KernelParameterDescriptor::HiddenHostcallBuffer:
+        case amd::KernelParameterDescriptor::HiddenQueuePtr:
+        case amd::KernelParameterDescriptor::HiddenDefaultQueue:
+        case amd::KernelParameterDescriptor::HiddenCompletionAction:
+        case amd::KernelParameterDescriptor::HiddenMultiGridSync:
+        case amd::KernelParameterDescriptor::HiddenHeap:
+          return false;
+        default:
+          break;
+      }
+    }
+    return true;
+  }
+
+  bool RefreshState(const GraphNode* node) override {
+    bool changed = GraphNode::RefreshState(node);
+    const GraphKernelNode* kernelNode = static_cast<GraphKernelNode const*>(node);
+    if ((kernelAttrInUse_ != kernelNode->kernelAttrInUse_) ||
+        (::memcmp(&kernelAttr_, &kernelNode->kernelAttr_, sizeof(kernelAttr_)) != 0)) {
+      memset(&kernelAttr_, 0, sizeof(kernelAttr_));
+      kernelAttrInUse_ = 0;
+      CopyAttr(kernelNode);
+      changed = true;
+    }
+    return changed;
+  }
+
+  bool IsParamsEqual(const GraphNode* node) const override {
+    const GraphKernelNode* kernelNode = static_cast<GraphKernelNode const*>(node);
+    const hipKernelNodeParams& params = kernelNode->kernelParams_;
+    auto isDimEqual = [](const dim3& a, const dim3& b) {
+      return (a.x == b.x) && (a.y == b.y) && (a.z == b.z);
+    };
+    if ((params.func != kernelParams_.func) || !isDimEqual(params.gridDim, kernelParams_.gridDim) ||
+        !isDimEqual(params.blockDim, kernelParams_.blockDim) ||
+        (params.sharedMemBytes != kernelParams_.sharedMemBytes) ||
+        (kernelNode->numParams_ != numParams_)) {
+      return false;
+    }
+    if ((kernelParams_.kernelParams != nullptr) && (params.kernelParams != nullptr)) {
+      hipFunction_t func = getFunc(kernelParams_, ihipGetDevice());
+      if (func == nullptr) {
+        return false;
+      }
+      const amd::KernelSignature& signature =
+          hip::DeviceFunc::asFunction(func)->kernel()->signature();
+      for (uint32_t i = 0; i < numParams_; ++i) {
+        if (::memcmp(kernelParams_.kernelParams[i], params.kernelParams[i],
+                     signature.at(i).size_) != 0) {
+          return false;
+        }
+      }
+      return true;
+    } else if ((kernelParams_.extra != nullptr) && (params.extra != nullptr)) {
+      size_t size = *reinterpret_cast<size_t*>(kernelParams_.extra[3]);
+      return (size == *reinterpret_cast<size_t*>(params.extra[3])) &&
+          (::memcmp(kernelParams_.extra[1], params.extra[1], size) == 0);
+    }
+    return false;
+  }
 
   hipError_t SetParams(const hipKernelNodeParams* params) {
     hipFunction_t func = getFunc(kernelParams_, ihipGetDevice());
@@ -1313,7 +1659,24 @@ class GraphKernelNode : public GraphNode {
 
   hipError_t SetParams(GraphNode* node) override {
     const GraphKernelNode* kernelNode = static_cast<GraphKernelNode const*>(node);
-    return SetParams(&kernelNode->kernelParams_);
+    GraphKernelArgs* sharedArgs = kernelNode->kernelArgs_;
+    if ((sharedArgs == nullptr) || sharedArgs->exposed_) {
+      return SetParams(&kernelNode->kernelParams_);
+    }
+    hipFunction_t func = getFunc(kernelParams_, ihipGetDevice());
+    if (!func) {
+      return hipErrorInvalidDeviceFunction;
+    }
+    hipError_t status = validateKernelParams(&kernelNode->kernelParams_, func, ihipGetDevice());
+    if (hipSuccess != status) {
+      return status;
+    }
+    // Share the argument buffers of the source node instead of the copy
+    sharedArgs->retain();
+    freeParams();
+    status = copyParams(&kernelNode->kernelParams_, sharedArgs);
+    sharedArgs->release();
+    return status;
   }
 
   static hipError_t validateKernelParams(const hipKernelNodeParams* pNodeParams,
@@ -1399,6 +1762,8 @@ class GraphMemcpyNode : public GraphNode {
 
   virtual hipMemcpyKind GetMemcpyKind() const { return copyParams_.kind; };
 
+  size_t GetIdentityHash() const override { return static_cast<size_t>(GetMemcpyKind()); }
+
   hipError_t SetParams(const hipMemcpy3DParms* params) {
     hipError_t status = ValidateParams(params);
     if (status != hipSuccess) {
@@ -1534,7 +1899,12 @@ class GraphMemcpyNode1D : public GraphMemcpyNode {
     return new GraphMemcpyNode1D(static_cast<GraphMemcpyNode1D const&>(*this));
   }
 
+  uint64_t GetCostEstimate() const override { return kLaunchCost + count_ / 256; }
+
   virtual hipError_t CreateCommand(hip::Stream* stream) override {
+    if (batch_owner_ != nullptr) {
+      return CreateBatchCommand(stream);
+    }
     if ((kind_ == hipMemcpyHostToHost || kind_ == hipMemcpyDefault) && IsHtoHMemcpy(dst_, src_)) {
       return hipSuccess;
     }
@@ -1625,6 +1995,15 @@ class GraphMemcpyNode1D : public GraphMemcpyNode {
     return kind_;
   }
 
+  bool GetBatchEntry(amd::BatchCopyFillEntry* entry) const override {
+    if ((type_ != hipGraphNodeTypeMemcpy) || !isEnabled_ ||
+        (ihipGetMemcpyType(src_, dst_, kind_) != hipCopyBuffer)) {
+      return false;
+    }
+    *entry = {reinterpret_cast<uint64_t>(dst_), reinterpret_cast<uint64_t>(src_), count_, 0};
+    return true;
+  }
+
   hipError_t SetParams(void* dst, const void* src, size_t count, hipMemcpyKind kind) {
     hipError_t status = ValidateParams(dst, src, count, kind);
     if (status != hipSuccess) {
@@ -1936,6 +2315,32 @@ class GraphMemsetNode : public GraphNode {
     return new GraphMemsetNode(static_cast<GraphMemsetNode const&>(*this));
   }
 
+  uint64_t GetCostEstimate() const override {
+    size_t sizeBytes = memsetParams_.width * memsetParams_.height * depth_ *
+        memsetParams_.elementSize;
+    return kLaunchCost + sizeBytes / 256;
+  }
+
+  bool GetBatchEntry(amd::BatchCopyFillEntry* entry) const override {
+    size_t discardOffset = 0;
+    if ((memsetParams_.height != 1) || (depth_ != 1) || !isEnabled_ ||
+        (getMemoryObject(memsetParams_.dst, discardOffset) == nullptr)) {
+      return false;
+    }
+    *entry = {reinterpret_cast<uint64_t>(memsetParams_.dst), memsetParams_.value,
+              memsetParams_.width * memsetParams_.elementSize, memsetParams_.elementSize};
+    return true;
+  }
+
+  bool IsParamsEqual(const GraphNode* node) const override {
+    const GraphMemsetNode* memsetNode = static_cast<GraphMemsetNode const*>(node);
+    const hipMemsetParams& params = memsetNode->memsetParams_;
+    return (params.dst == memsetParams_.dst) && (params.value == memsetParams_.value) &&
+        (params.elementSize == memsetParams_.elementSize) &&
+        (params.width == memsetParams_.width) && (params.height == memsetParams_.height) &&
+        (params.pitch == memsetParams_.pitch) && (memsetNode->depth_ == depth_);
+  }
+
   virtual std::string GetLabel(hipGraphDebugDotFlags flag) override {
     std::string label;
     if (flag == hipGraphDebugDotFlagsMemsetNodeParams || flag == hipGraphDebugDotFlagsVerbose) {
@@ -1969,6 +2374,9 @@ class GraphMemsetNode : public GraphNode {
   }
 
   hipError_t CreateCommand(hip::Stream* stream) override {
+    if (batch_owner_ != nullptr) {
+      return CreateBatchCommand(stream);
+    }
     hipError_t status = GraphNode::CreateCommand(stream);
     if (status != hipSuccess) {
       return status;
@@ -2296,15 +2704,18 @@ class GraphEmptyNode : public GraphNode {
 class GraphMemAllocNode final : public GraphNode {
   hipMemAllocNodeParams node_params_;  // Node parameters for memory allocation
   amd::Memory* va_ = nullptr;         // Memory object, which holds a virtual address
+  amd::Memory* alias_backing_ = nullptr;  // Backing of the exec, shared with other allocations
+  size_t alias_offset_ = 0;           // Offset of the allocation in the backing
 
   // Derive the new class for VirtualMapCommand,
   // so runtime can allocate memory during the execution of command
   class VirtualMemAllocNode : public amd::VirtualMapCommand {
    public:
     VirtualMemAllocNode(amd::HostQueue& queue, const amd::Event::EventWaitList& eventWaitList,
-                        amd::Memory* va, size_t size, amd::Memory* memory, Graph* graph)
-        : VirtualMapCommand(queue, eventWaitList, va->getSvmPtr(), size, memory),
-          va_(va), graph_(graph) {}
+                        amd::Memory* va, size_t size, amd::Memory* memory, Graph* graph,
+                        amd::Memory* backing = nullptr, size_t offset = 0)
+        : VirtualMapCommand(queue, eventWaitList, va->getSvmPtr(), size, memory, offset),
+          va_(va), graph_(graph), backing_(backing) {}
 
     virtual void submit(device::VirtualDevice& device) final {
       // Remove VA reference from the global mapping. Runtime has to keep a dummy reference for
@@ -2318,23 +2729,30 @@ class GraphMemAllocNode final : public GraphNode {
       // Allocate real memory for mapping
       const auto& dev_info = queue()->device().info();
       auto aligned_size = amd::alignUp(size_, dev_info.virtualMemAllocGranularity_);
-      auto dptr = graph_->AllocateMemory(aligned_size, static_cast<hip::Stream*>(queue()), nullptr);
-      if (dptr == nullptr) {
-        setStatus(CL_INVALID_OPERATION);
-        if (!AMD_DIRECT_DISPATCH) {
-          WorkerThreadLock_.unlock();
+      if (backing_ != nullptr) {
+        // The offset in the backing was assigned at instantiation, no pool allocation
+        memory_ = backing_;
+        memory_->retain();
+      } else {
+        auto dptr = graph_->AllocateMemory(aligned_size, static_cast<hip::Stream*>(queue()),
+                                           nullptr);
+        if (dptr == nullptr) {
+          setStatus(CL_INVALID_OPERATION);
+          if (!AMD_DIRECT_DISPATCH) {
+            WorkerThreadLock_.unlock();
+          }
+          return;
         }
-        return;
+        size_t offset = 0;
+        // Get memory object associated with the real allocation
+        memory_ = getMemoryObject(dptr, offset);
+        // Retain memory object because command release will release it
+        memory_->retain();
+
+        // Remove because the entry is not needed in MemObjMap after the memory_ has been saved.
+        // The Phy mem obj will be saved in virtual memory object during VirtualMapCommand::submit
+        amd::MemObjMap::RemoveMemObj(dptr);
       }
-      size_t offset = 0;
-      // Get memory object associated with the real allocation
-      memory_ = getMemoryObject(dptr, offset);
-      // Retain memory object because command release will release it
-      memory_->retain();
-
-      // Remove because the entry is not needed in MemObjMap after the memory_ has been saved.
-      // The Phy mem obj will be saved in virtual memory object during VirtualMapCommand::submit.
-      amd::MemObjMap::RemoveMemObj(dptr);
       size_ = aligned_size;
       // Execute the original mapping command
       VirtualMapCommand::submit(device);
@@ -2355,6 +2773,7 @@ class GraphMemAllocNode final : public GraphNode {
    private:
     amd::Memory* va_;   // Memory object with the new virtual address for mapping
     Graph* graph_;  // Graph which allocates/maps memory
+    amd::Memory* backing_;  // Aliased backing of the exec, nullptr if memory comes from the pool
   };
 
  public:
@@ -2401,7 +2820,7 @@ class GraphMemAllocNode final : public GraphNode {
         stream->GetDevice()->GetGraphMemoryPool()->SetGraphInUse();
         // Create command for memory mapping
         auto cmd = new VirtualMemAllocNode(*stream, amd::Event::EventWaitList{},
-            va_, node_params_.bytesize, nullptr, graph);
+            va_, node_params_.bytesize, nullptr, graph, alias_backing_, alias_offset_);
         commands_.push_back(cmd);
         size_t offset = 0;
         // Check if memory was already added after first reserve
@@ -2455,6 +2874,12 @@ class GraphMemAllocNode final : public GraphNode {
   void GetParams(hipMemAllocNodeParams* params) const {
     std::memcpy(params, &node_params_, sizeof(hipMemAllocNodeParams));
   }
+
+  //! Maps the allocation into the provided offset of the exec backing on every launch
+  void SetAliasBacking(amd::Memory* backing, size_t offset) {
+    alias_backing_ = backing;
+    alias_offset_ = offset;
+  }
 };
 
 // ================================================================================================
@@ -2467,8 +2892,9 @@ class GraphMemFreeNode : public GraphNode {
    public:
     VirtualMemFreeNode(Graph* graph, int device_id, amd::HostQueue& queue,
         const amd::Event::EventWaitList& eventWaitList, void* ptr, size_t size,
-        amd::Memory* memory) : VirtualMapCommand(queue, eventWaitList, ptr, size, memory)
-        , graph_(graph), device_id_(device_id) {}
+        amd::Memory* memory, bool aliased = false)
+        : VirtualMapCommand(queue, eventWaitList, ptr, size, memory)
+        , graph_(graph), device_id_(device_id), aliased_(aliased) {}
 
     virtual void submit(device::VirtualDevice& device) final {
       // Find memory object before unmap logic
@@ -2486,9 +2912,10 @@ class GraphMemFreeNode : public GraphNode {
       // Free virtual address
       vaddr_sub_obj->release();
       vaddr_mem_obj->release();
-      // Release the allocation back to graph's pool
+      // Release the allocation back to graph's pool. The aliased backing belongs to the exec
       auto device_id = phys_mem_obj->getUserData().deviceId;
-      if (!g_devices[device_id]->FreeMemory(phys_mem_obj, static_cast<hip::Stream*>(queue()))) {
+      if (!aliased_ &&
+          !g_devices[device_id]->FreeMemory(phys_mem_obj, static_cast<hip::Stream*>(queue()))) {
         LogError("Memory didn't belong to any pool!");
       }
       amd::MemObjMap::AddMemObj(ptr(), vaddr_mem_obj);
@@ -2500,8 +2927,11 @@ class GraphMemFreeNode : public GraphNode {
    private:
     Graph* graph_;  // Graph, which has the execution of this command
     int device_id_;     // Device ID where this command is executed
+    bool aliased_;      // Memory is mapped from the aliased backing of the exec
   };
 
+  bool aliased_ = false;  // The freed allocation is mapped from the exec backing
+
  public:
   GraphMemFreeNode(void* dptr)
     : GraphNode(hipGraphNodeTypeMemFree, "solid", "rectangle", "MEM_FREE")
@@ -2526,7 +2956,8 @@ class GraphMemFreeNode : public GraphNode {
         // Unmap virtual address from memory
         amd::Command* cmd = new VirtualMemFreeNode(graph, stream->DeviceId(), *stream,
             amd::Command::EventWaitList{}, device_ptr_,
-            amd::alignUp(va->getSize(), dev_info.virtualMemAllocGranularity_), nullptr);
+            amd::alignUp(va->getSize(), dev_info.virtualMemAllocGranularity_), nullptr,
+            aliased_);
         commands_.push_back(cmd);
         ClPrint(amd::LOG_INFO, amd::LOG_MEM_POOL, "Graph FreeMem create: %p", device_ptr_);
       }
@@ -2544,6 +2975,9 @@ class GraphMemFreeNode : public GraphNode {
   void GetParams(void** params) const {
     *params = device_ptr_;
   }
+
+  //! Marks the freed allocation as mapped from the exec backing
+  void SetAliased(bool aliased) { aliased_ = aliased; }
 };
 
 class GraphDrvMemcpyNode : public GraphNode {
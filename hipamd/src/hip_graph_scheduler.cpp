@@ -0,0 +1,186 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include "hip_graph_scheduler.hpp"
+#include <algorithm>
+#include <queue>
+
+namespace hip {
+
+// ================================================================================================
+bool GraphListScheduler::Schedule(const std::vector<uint64_t>& cost,
+                                  const std::vector<std::vector<uint32_t>>& deps,
+                                  uint32_t max_streams, Result* result) {
+  const uint32_t num_nodes = static_cast<uint32_t>(cost.size());
+  max_streams = std::max(max_streams, 1u);
+
+  result->stream_id_.assign(num_nodes, -1);
+  result->launch_order_.clear();
+  result->launch_order_.reserve(num_nodes);
+  result->waits_.assign(num_nodes, {});
+  result->signal_is_required_.assign(num_nodes, false);
+  result->num_streams_ = 0;
+  result->num_waits_ = 0;
+  result->makespan_ = 0;
+
+  // Build the successor lists and find a topological order
+  std::vector<std::vector<uint32_t>> edges(num_nodes);
+  std::vector<uint32_t> in_degree(num_nodes, 0);
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    for (auto dep : deps[i]) {
+      edges[dep].push_back(i);
+    }
+    in_degree[i] = static_cast<uint32_t>(deps[i].size());
+  }
+  std::vector<uint32_t> topo_order;
+  topo_order.reserve(num_nodes);
+  std::vector<uint32_t> remaining = in_degree;
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    if (remaining[i] == 0) {
+      topo_order.push_back(i);
+    }
+  }
+  for (size_t i = 0; i < topo_order.size(); ++i) {
+    for (auto edge : edges[topo_order[i]]) {
+      if (--remaining[edge] == 0) {
+        topo_order.push_back(edge);
+      }
+    }
+  }
+  if (topo_order.size() != num_nodes) {
+    return false;
+  }
+
+  // Bottom level is the longest cost path from the node to any leaf, including the node itself.
+  // Nodes on the critical path have the highest bottom level and are scheduled first.
+  std::vector<uint64_t> bottom_level(num_nodes, 0);
+  for (auto it = topo_order.rbegin(); it != topo_order.rend(); ++it) {
+    uint64_t longest = 0;
+    for (auto edge : edges[*it]) {
+      longest = std::max(longest, bottom_level[edge]);
+    }
+    bottom_level[*it] = cost[*it] + longest;
+  }
+
+  // Ready list ordered by bottom level, the node index keeps the schedule deterministic
+  auto compare = [&bottom_level](uint32_t a, uint32_t b) {
+    return (bottom_level[a] != bottom_level[b]) ? (bottom_level[a] < bottom_level[b]) : (a > b);
+  };
+  std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(compare)> ready(compare);
+  remaining = in_degree;
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    if (remaining[i] == 0) {
+      ready.push(i);
+    }
+  }
+
+  std::vector<uint64_t> finish(num_nodes, 0);
+  std::vector<uint64_t> stream_avail(max_streams, 0);
+  while (!ready.empty()) {
+    uint32_t node = ready.top();
+    ready.pop();
+
+    uint64_t deps_ready = 0;
+    for (auto dep : deps[node]) {
+      deps_ready = std::max(deps_ready, finish[dep]);
+    }
+    // Pick the stream with the earliest start time. On a tie prefer the stream with
+    // fewer cross-stream dependencies, so a chain stays on the stream of its parent.
+    int32_t best_stream = -1;
+    uint64_t best_start = 0;
+    uint32_t best_waits = 0;
+    for (uint32_t s = 0; s < max_streams; ++s) {
+      uint64_t start = std::max(stream_avail[s], deps_ready);
+      uint32_t waits = 0;
+      for (auto dep : deps[node]) {
+        waits += (result->stream_id_[dep] != static_cast<int32_t>(s)) ? 1 : 0;
+      }
+      if ((best_stream == -1) || (start < best_start) ||
+          ((start == best_start) && (waits < best_waits))) {
+        best_stream = s;
+        best_start = start;
+        best_waits = waits;
+      }
+      // Unused streams are identical, hence don't check more than one of them
+      if (stream_avail[s] == 0 && s >= result->num_streams_) {
+        break;
+      }
+    }
+    result->stream_id_[node] = best_stream;
+    result->num_streams_ = std::max(result->num_streams_, static_cast<uint32_t>(best_stream + 1));
+    finish[node] = best_start + std::max(cost[node], static_cast<uint64_t>(1));
+    stream_avail[best_stream] = finish[node];
+    result->makespan_ = std::max(result->makespan_, finish[node]);
+    result->launch_order_.push_back(node);
+
+    for (auto edge : edges[node]) {
+      if (--remaining[edge] == 0) {
+        ready.push(edge);
+      }
+    }
+  }
+
+  // Find the minimal set of cross-stream waits. Every node keeps a vector clock with
+  // the last position on each stream, which is known to be complete before the node starts.
+  // A dependency doesn't need a wait if the clock already covers it transitively.
+  const uint32_t num_streams = result->num_streams_;
+  std::vector<uint32_t> launch_index(num_nodes, 0);
+  std::vector<uint32_t> position(num_nodes, 0);
+  std::vector<uint32_t> stream_count(num_streams, 0);
+  std::vector<std::vector<uint32_t>> node_clock(num_nodes);
+  std::vector<std::vector<uint32_t>> stream_clock(num_streams,
+                                                  std::vector<uint32_t>(num_streams, 0));
+  for (uint32_t i = 0; i < num_nodes; ++i) {
+    launch_index[result->launch_order_[i]] = i;
+  }
+  std::vector<uint32_t> cross_deps;
+  for (auto node : result->launch_order_) {
+    const int32_t stream = result->stream_id_[node];
+    std::vector<uint32_t> clock = stream_clock[stream];
+
+    cross_deps.clear();
+    for (auto dep : deps[node]) {
+      if (result->stream_id_[dep] != stream) {
+        cross_deps.push_back(dep);
+      }
+    }
+    // The latest launches cover the most work, hence process them first
+    std::sort(cross_deps.begin(), cross_deps.end(), [&launch_index](uint32_t a, uint32_t b) {
+      return launch_index[a] > launch_index[b];
+    });
+    for (auto dep : cross_deps) {
+      if (clock[result->stream_id_[dep]] < position[dep]) {
+        result->waits_[node].push_back(dep);
+        result->signal_is_required_[dep] = true;
+        result->num_waits_++;
+        for (uint32_t s = 0; s < num_streams; ++s) {
+          clock[s] = std::max(clock[s], node_clock[dep][s]);
+        }
+      }
+    }
+    position[node] = ++stream_count[stream];
+    clock[stream] = position[node];
+    stream_clock[stream] = clock;
+    node_clock[node] = std::move(clock);
+  }
+  return true;
+}
+
+}  // namespace hip
@@ -0,0 +1,51 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace hip {
+
+//! Critical-path list scheduler for the graph stream assignment.
+//! The scheduler works on an abstract DAG (node index, cost, dependency list), so it doesn't
+//! require any device objects and can be validated on synthetic graphs.
+class GraphListScheduler {
+ public:
+  struct Result {
+    std::vector<int32_t> stream_id_;            //!< Assigned stream for every node
+    std::vector<uint32_t> launch_order_;        //!< Node launch sequence, valid topological order
+    std::vector<std::vector<uint32_t>> waits_;  //!< Cross-stream nodes each node has to wait for
+    std::vector<bool> signal_is_required_;      //!< Node is a wait target of another stream
+    uint32_t num_streams_ = 0;                  //!< Number of streams used by the schedule
+    uint32_t num_waits_ = 0;                    //!< Total number of cross-stream waits
+    uint64_t makespan_ = 0;                     //!< Estimated finish time of the whole graph
+  };
+
+  //! Schedules the DAG on up to max_streams streams. Returns false if the graph has a cycle
+  static bool Schedule(
+      const std::vector<uint64_t>& cost,                 //!< Estimated cost of every node
+      const std::vector<std::vector<uint32_t>>& deps,    //!< Dependencies of every node
+      uint32_t max_streams,                              //!< Maximum number of streams
+      Result* result                                     //!< Schedule output
+  );
+};
+
+}  // namespace hip
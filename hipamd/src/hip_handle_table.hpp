@@ -0,0 +1,269 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+namespace hip {
+
+//! Table of the live object handles for the API validation.
+//! The table is an open addressing hash of atomic slots. Validation doesn't take any lock
+//! and finishes after a bounded number of atomic loads and compares, since the load factor,
+//! including the erased slots, never exceeds 1/2. Insert and erase claim the slots with CAS,
+//! so the concurrent writers don't serialize. Only the rebuild of the table is exclusive.
+//! When the handles and the erased markers fill up the table, the live handles are copied into
+//! a new table generation, which is published with a single atomic store. Hence a reader sees
+//! either the old or the new generation, but never a table under modification.
+//! The readers tag themselves with the generation they probe and a retired generation is
+//! released once no reader is tagged with it.
+template <typename T> class HandleTable {
+ public:
+  HandleTable() : table_(new Table(kInitialCapacity)) {}
+  ~HandleTable() {
+    for (auto table : retired_) {
+      delete table;
+    }
+    delete table_.load(std::memory_order_relaxed);
+  }
+
+  //! Adds a live handle
+  void Insert(const T* handle) {
+    bool grow = false;
+    {
+      std::shared_lock<std::shared_mutex> lock(resize_lock_);
+      Table* table = table_.load(std::memory_order_acquire);
+      const uintptr_t value = reinterpret_cast<uintptr_t>(handle);
+      for (size_t i = Hash(value);; ++i) {
+        std::atomic<uintptr_t>& slot = table->slots_[i & table->mask_];
+        uintptr_t current = slot.load(std::memory_order_relaxed);
+        if (((current == kEmpty) || (current == kErased)) &&
+            slot.compare_exchange_strong(current, value, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+          if (current == kEmpty) {
+            grow = (table->used_.fetch_add(1, std::memory_order_relaxed) + 1) * 2 >
+                table->capacity_;
+          }
+          break;
+        }
+      }
+    }
+    if (grow) {
+      Rebuild();
+    }
+  }
+
+  //! Removes the handle, the later validation of the handle fails
+  void Erase(const T* handle) {
+    std::shared_lock<std::shared_mutex> lock(resize_lock_);
+    Table* table = table_.load(std::memory_order_acquire);
+    const uintptr_t value = reinterpret_cast<uintptr_t>(handle);
+    for (size_t i = Hash(value);; ++i) {
+      std::atomic<uintptr_t>& slot = table->slots_[i & table->mask_];
+      uintptr_t current = slot.load(std::memory_order_relaxed);
+      if (current == kEmpty) {
+        return;
+      }
+      if ((current == value) &&
+          slot.compare_exchange_strong(current, kErased, std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+        return;
+      }
+    }
+  }
+
+  //! Returns true if the handle is live. Lock-free, the probe restarts only if a new
+  //! generation was published in the meantime
+  bool Contains(const T* handle) const {
+    const uintptr_t value = reinterpret_cast<uintptr_t>(handle);
+    if (value <= kErased) {
+      return false;
+    }
+    Reader* reader = LocalReader();
+    const Table* table = table_.load(std::memory_order_seq_cst);
+    for (;;) {
+      // The tag must be visible before the generation is validated, so the rebuild either
+      // sees the tag or the reader sees the new generation
+      reader->table_.store(table, std::memory_order_seq_cst);
+      const Table* current = table_.load(std::memory_order_seq_cst);
+      if (current == table) {
+        break;
+      }
+      table = current;
+    }
+    bool found = false;
+    for (size_t i = Hash(value);; ++i) {
+      uintptr_t current = table->slots_[i & table->mask_].load(std::memory_order_acquire);
+      if ((current == value) || (current == kEmpty)) {
+        found = (current == value);
+        break;
+      }
+    }
+    reader->table_.store(nullptr, std::memory_order_release);
+    return found;
+  }
+
+  //! Calls the functor for every live handle. The concurrent inserts may be skipped
+  template <typename F> void ForEach(F func) const {
+    std::shared_lock<std::shared_mutex> lock(resize_lock_);
+    const Table* table = table_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < table->capacity_; ++i) {
+      uintptr_t current = table->slots_[i].load(std::memory_order_acquire);
+      if (current > kErased) {
+        func(reinterpret_cast<T*>(current));
+      }
+    }
+  }
+
+ private:
+  static constexpr uintptr_t kEmpty = 0;     //!< The slot was never used
+  static constexpr uintptr_t kErased = 1;    //!< The handle was erased, probing must continue
+  static constexpr size_t kInitialCapacity = 1024;
+
+  struct Table {
+    explicit Table(size_t capacity)
+        : capacity_(capacity),
+          mask_(capacity - 1),
+          slots_(new std::atomic<uintptr_t>[capacity]) {
+      for (size_t i = 0; i < capacity; ++i) {
+        slots_[i].store(kEmpty, std::memory_order_relaxed);
+      }
+    }
+    const size_t capacity_;                          //!< Number of slots, power of 2
+    const size_t mask_;                              //!< Slot index mask
+    std::unique_ptr<std::atomic<uintptr_t>[]> slots_;  //!< Handles, empty or erased markers
+    std::atomic<size_t> used_{0};                    //!< Slots with a handle or an erased marker
+  };
+
+  //! Generation tag of a validating thread. The records are shared by all tables of
+  //! the same type, since a thread validates only one handle at a time
+  struct Reader {
+    std::atomic<const Table*> table_{nullptr};  //!< Generation under the probe or null
+    std::atomic<bool> in_use_{true};            //!< The record belongs to a live thread
+    Reader* next_ = nullptr;                    //!< Next record in the list
+  };
+
+  //! Claims a reader record for the calling thread and returns it on the thread exit
+  struct ReaderHolder {
+    ReaderHolder() {
+      for (reader_ = readers_.load(std::memory_order_acquire); reader_ != nullptr;
+           reader_ = reader_->next_) {
+        bool in_use = false;
+        if (!reader_->in_use_.load(std::memory_order_relaxed) &&
+            reader_->in_use_.compare_exchange_strong(in_use, true, std::memory_order_acquire)) {
+          return;
+        }
+      }
+      // The records are never released, their number is bounded by the peak thread count
+      reader_ = new Reader();
+      reader_->next_ = readers_.load(std::memory_order_relaxed);
+      while (!readers_.compare_exchange_weak(reader_->next_, reader_, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+      }
+    }
+    ~ReaderHolder() {
+      reader_->table_.store(nullptr, std::memory_order_relaxed);
+      reader_->in_use_.store(false, std::memory_order_release);
+    }
+    Reader* reader_;
+  };
+
+  static Reader* LocalReader() {
+    static thread_local ReaderHolder holder;
+    return holder.reader_;
+  }
+
+  static size_t Hash(uintptr_t value) {
+    // Objects are at least 8 bytes aligned, hence mix the high bits into the low ones
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return static_cast<size_t>(value);
+  }
+
+  //! Copies the live handles into a new generation without the erased slots. The capacity
+  //! is doubled if the live handles still fill more than 1/4 of the table
+  void Rebuild() {
+    std::unique_lock<std::shared_mutex> lock(resize_lock_);
+    Table* table = table_.load(std::memory_order_relaxed);
+    if (table->used_.load(std::memory_order_relaxed) * 2 <= table->capacity_) {
+      // Another thread has already rebuilt the table
+      return;
+    }
+    size_t live = 0;
+    for (size_t i = 0; i < table->capacity_; ++i) {
+      live += (table->slots_[i].load(std::memory_order_relaxed) > kErased) ? 1 : 0;
+    }
+    const size_t capacity = (live * 4 <= table->capacity_) ? table->capacity_
+                                                           : table->capacity_ * 2;
+    Table* new_table = new Table(capacity);
+    for (size_t i = 0; i < table->capacity_; ++i) {
+      uintptr_t value = table->slots_[i].load(std::memory_order_relaxed);
+      if (value > kErased) {
+        for (size_t j = Hash(value);; ++j) {
+          std::atomic<uintptr_t>& slot = new_table->slots_[j & new_table->mask_];
+          if (slot.load(std::memory_order_relaxed) == kEmpty) {
+            slot.store(value, std::memory_order_relaxed);
+            break;
+          }
+        }
+      }
+    }
+    new_table->used_.store(live, std::memory_order_relaxed);
+    table_.store(new_table, std::memory_order_seq_cst);
+    retired_.push_back(table);
+    Reclaim();
+  }
+
+  //! Releases the retired generations, which aren't tagged by any reader
+  void Reclaim() {
+    std::vector<const Table*> tags;
+    for (Reader* reader = readers_.load(std::memory_order_acquire); reader != nullptr;
+         reader = reader->next_) {
+      const Table* table = reader->table_.load(std::memory_order_seq_cst);
+      if (table != nullptr) {
+        tags.push_back(table);
+      }
+    }
+    auto last = std::remove_if(retired_.begin(), retired_.end(), [&tags](Table* retired) {
+      if (std::find(tags.begin(), tags.end(), retired) != tags.end()) {
+        return false;
+      }
+      delete retired;
+      return true;
+    });
+    retired_.erase(last, retired_.end());
+  }
+
+  std::atomic<Table*> table_;               //!< Current generation of the table
+  std::vector<Table*> retired_;             //!< Replaced generations, which may have readers
+  mutable std::shared_mutex resize_lock_;   //!< Exclusive for the rebuild, shared for the writers
+  static std::atomic<Reader*> readers_;     //!< Generation tags of the validating threads
+};
+
+template <typename T>
+std::atomic<typename HandleTable<T>::Reader*> HandleTable<T>::readers_{nullptr};
+
+}  // namespace hip
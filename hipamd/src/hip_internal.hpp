@@ -27,6 +27,8 @@
 #include "rocclr/utils/debug.hpp"
 #include "hip_formatting.hpp"
 #include "hip_graph_capture.hpp"
+#include "hip_handle_table.hpp"
+#include "hip_capture_streams.hpp"
 
 #include <unordered_set>
 #include <thread>
@@ -230,20 +232,14 @@ const char* ihipGetErrorName(hipError_t hip_error);
       }                                                                                            \
       HIP_RETURN(hipErrorStreamCaptureUnsupported);                                                \
     }                                                                                              \
-    if (g_captureStreams.size() != 0) {                                                            \
-      for (auto stream : g_captureStreams) {                                                       \
-        stream->SetCaptureStatus(hipStreamCaptureStatusInvalidated);                               \
-      }                                                                                            \
+    if (hip::InvalidateGlobalCaptureStreams()) {                                                   \
       HIP_RETURN(hipErrorStreamCaptureUnsupported);                                                \
     }                                                                                              \
   }
 
 // Device sync is not supported during capture
 #define CHECK_SUPPORTED_DURING_CAPTURE()                                                           \
-  if (!g_allCapturingStreams.empty()) {                                                            \
-    for (auto stream : g_allCapturingStreams) {                                                    \
-      stream->SetCaptureStatus(hipStreamCaptureStatusInvalidated);                                 \
-    }                                                                                              \
+  if (hip::InvalidateAllCapturingStreams()) {                                                      \
     return hipErrorStreamCaptureUnsupported;                                                       \
   }
 
@@ -251,10 +247,7 @@ const char* ihipGetErrorName(hipError_t hip_error);
 // for all capture modes hipStreamCaptureModeGlobal, hipStreamCaptureModeThreadLocal and
 // hipStreamCaptureModeRelaxed
 #define CHECK_STREAM_CAPTURING()                                                                   \
-  if (!g_allCapturingStreams.empty()) {                                                            \
-    for (auto stream : g_allCapturingStreams) {                                                    \
-      stream->SetCaptureStatus(hipStreamCaptureStatusInvalidated);                                 \
-    }                                                                                              \
+  if (hip::InvalidateAllCapturingStreams()) {                                                      \
     return hipErrorStreamCaptureImplicit;                                                          \
   }
 
@@ -339,6 +332,8 @@ public:
     /// Capture events
     std::unordered_set<hipEvent_t> captureEvents_;
     unsigned long long captureID_;
+    /// Live streams for the lock-free handle validation
+    static HandleTable<Stream> streamHandles_;
 
     static inline CommandQueue::Priority convertToQueuePriority(Priority p) {
       return p == Priority::High ? amd::CommandQueue::Priority::High : p == Priority::Low ?
@@ -371,6 +366,8 @@ public:
 
     /// Check whether any blocking stream running
     static bool StreamCaptureBlocking();
+    /// Returns true if the stream wasn't destroyed. Lock-free
+    static bool StreamExists(Stream* stream) { return streamHandles_.Contains(stream); }
 
     static void Destroy(hip::Stream* stream, bool forceDestroy = false);
 
@@ -686,6 +683,7 @@ public:
   extern hipError_t ihipGetDeviceProperties(hipDeviceProp_t* props, hipDevice_t device);
 
   extern hipError_t ihipDeviceGet(hipDevice_t* device, int deviceId);
+  extern void ihipReleaseGraphExecCache();
   extern hipError_t ihipStreamOperation(hipStream_t stream, cl_command_type cmdType, void* ptr,
                                         uint64_t value, uint64_t mask, unsigned int flags,
                                         size_t sizeBytes);
@@ -696,9 +694,16 @@ public:
 
   constexpr bool kMarkerDisableFlush = true;  //!< Avoids command batch flush in ROCclr
 
-  extern std::vector<hip::Stream*> g_captureStreams;
-  extern amd::Monitor g_captureStreamsLock;
-  extern amd::Monitor g_streamSetLock;
-  extern std::unordered_set<hip::Stream*> g_allCapturingStreams;
+  //! Streams in the capture mode
+  extern CaptureStreams<hip::Stream, amd::Monitor> g_captureStreams;
+
+  //! Registers the stream, which begins the capture in the provided mode
+  void AddCapturingStream(hip::Stream* stream, hipStreamCaptureMode mode);
+  //! Unregisters the stream, which ends the capture or is destroyed
+  void RemoveCapturingStream(hip::Stream* stream, hip::Graph* graph);
+  //! Invalidates the global mode captures. Returns true if any stream was capturing
+  bool InvalidateGlobalCaptureStreams();
+  //! Invalidates all captures. Returns true if any stream was capturing
+  bool InvalidateAllCapturingStreams();
 } // namespace hip
 #endif  // HIP_SRC_HIP_INTERNAL_H
@@ -60,7 +60,7 @@ hipError_t hipDeviceSetMemPool(int device, hipMemPool_t mem_pool) {
     HIP_RETURN(hipErrorInvalidValue);
   }
   if (DEBUG_HIP_7_PREVIEW & amd::CHANGE_HIP_STREAM_CAPTURE_API) {
-    if (!hip::tls.capture_streams_.empty() || !g_captureStreams.empty()) {
+    if (!hip::tls.capture_streams_.empty() || g_captureStreams.HasGlobal()) {
       HIP_RETURN(hipErrorStreamCaptureUnsupported);
     }
   }
@@ -188,6 +188,11 @@ hipError_t hipFreeAsync(void* dev_ptr, hipStream_t stream) {
     size_t offset = 0;
     auto memory = getMemoryObject(dev_ptr, offset);
     if (memory != nullptr) {
+      // The same stream can reuse the allocation without the pool lock
+      auto mem_pool = reinterpret_cast<hip::MemoryPool*>(memory->getUserData().mem_pool);
+      if ((mem_pool != nullptr) && mem_pool->CacheFree(memory, hip_stream)) {
+        HIP_RETURN(hipSuccess);
+      }
       auto id = memory->getUserData().deviceId;
       if (!g_devices[id]->FreeMemory(memory, hip_stream, event)) {
         // @note It's not the most optimal logic.
@@ -333,7 +338,7 @@ hipError_t hipMemPoolCreate(hipMemPool_t* mem_pool, const hipMemPoolProps* pool_
     HIP_RETURN(hipErrorInvalidValue);
   }
   if (DEBUG_HIP_7_PREVIEW & amd::CHANGE_HIP_STREAM_CAPTURE_API) {
-    if (!hip::tls.capture_streams_.empty() || !g_captureStreams.empty()) {
+    if (!hip::tls.capture_streams_.empty() || g_captureStreams.HasGlobal()) {
       HIP_RETURN(hipErrorStreamCaptureUnsupported);
     }
   }
@@ -353,7 +358,7 @@ hipError_t hipMemPoolDestroy(hipMemPool_t mem_pool) {
     HIP_RETURN(hipErrorInvalidValue);
   }
   if (DEBUG_HIP_7_PREVIEW & amd::CHANGE_HIP_STREAM_CAPTURE_API) {
-    if (!hip::tls.capture_streams_.empty() || !g_captureStreams.empty()) {
+    if (!hip::tls.capture_streams_.empty() || g_captureStreams.HasGlobal()) {
       HIP_RETURN(hipErrorStreamCaptureUnsupported);
     }
   }
@@ -0,0 +1,151 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace hip {
+
+/// Segregated size class index of the pool allocations. Every power of 2 is split into 8
+/// classes, hence a class is at most 12.5% wide and a search for the reuse threshold visits
+/// only a few bins. Each bin has a ready list of allocations without outstanding GPU work and
+/// a pending list of allocations with a HIP event. The index doesn't own the allocations,
+/// the values are references into the owner's storage.
+template <typename Key, typename Value>
+class SizeClassBins {
+public:
+  /// The maximum number of entries, checked in a bin before the search falls back to
+  /// the exhaustive scan
+  static constexpr uint32_t kMaxBinScan = 16;
+
+  /// Returns the size class of the allocation size
+  static uint32_t SizeClass(size_t size) {
+    // The sizes below 16 bytes have the exact classes
+    constexpr size_t kExactClasses = 16;
+    if (size < kExactClasses) {
+      return static_cast<uint32_t>(size);
+    }
+    uint32_t msb = 0;
+    for (uint32_t shift = 32; shift != 0; shift >>= 1) {
+      if ((size >> (msb + shift)) != 0) {
+        msb += shift;
+      }
+    }
+    // Split every power of 2 into 8 classes with the next 3 bits after the most significant bit
+    const uint32_t sub_class = static_cast<uint32_t>(size >> (msb - 3)) & 0x7;
+    return ((msb - 2) << 3) + sub_class;
+  }
+
+  /// Adds a new allocation into its size class bin
+  void Insert(Key key, size_t size, Value value, bool ready) {
+    const uint32_t bin = SizeClass(size);
+    if (bins_.size() <= bin) {
+      bins_.resize(bin + 1);
+    }
+    BinList& list = ready ? bins_[bin].ready_ : bins_[bin].pending_;
+    slots_[key] = {bin, ready, list.insert(list.end(), value)};
+  }
+
+  /// Removes the allocation from its size class bin
+  void Erase(Key key) {
+    auto slot = slots_.find(key);
+    if (slot != slots_.end()) {
+      Bin& bin = bins_[slot->second.bin_];
+      (slot->second.ready_ ? bin.ready_ : bin.pending_).erase(slot->second.it_);
+      slots_.erase(slot);
+    }
+  }
+
+  /// Moves the pending allocation into the ready list of its bin
+  void MarkReady(Key key) {
+    auto slot = slots_.find(key);
+    if ((slot != slots_.end()) && !slot->second.ready_) {
+      Bin& bin = bins_[slot->second.bin_];
+      // Splice keeps the list iterator valid
+      bin.ready_.splice(bin.ready_.end(), bin.pending_, slot->second.it_);
+      slot->second.ready_ = true;
+    }
+  }
+
+  /// Searches the bins of the sizes from size to max_size. Pass 0 visits the ready lists, the
+  /// following passes visit the pending lists. The visitor is called as visit(pass, value) and
+  /// returns true if the allocation is accepted. The visitor may mark the visited allocation
+  /// as ready, but must not erase it.
+  template <typename Visit>
+  bool Find(size_t size, size_t max_size, uint32_t passes, Visit visit, Value* result) {
+    const uint32_t first = SizeClass(size);
+    if (bins_.size() <= first) {
+      return false;
+    }
+    const uint32_t last = std::min<uint32_t>(SizeClass(max_size),
+                                             static_cast<uint32_t>(bins_.size() - 1));
+    // Only the first and the last bins may have the sizes outside of the threshold, hence
+    // the bounded scan usually finds an allocation in constant time. If the bounded scan
+    // skipped some entries, then it's repeated without the bound, so the search never misses
+    // an allocation, which fits
+    for (uint32_t max_scan : {kMaxBinScan, std::numeric_limits<uint32_t>::max()}) {
+      bool truncated = false;
+      for (uint32_t pass = 0; pass < passes; ++pass) {
+        for (uint32_t bin = first; bin <= last; ++bin) {
+          BinList& list = (pass == 0) ? bins_[bin].ready_ : bins_[bin].pending_;
+          uint32_t scan = 0;
+          auto pos = list.begin();
+          for (; (pos != list.end()) && (scan < max_scan); ++scan) {
+            // Advance the position before the allocation can move to the ready list
+            Value value = *pos++;
+            if (visit(pass, value)) {
+              *result = value;
+              return true;
+            }
+          }
+          truncated |= (pos != list.end());
+        }
+      }
+      if (!truncated) {
+        break;
+      }
+    }
+    return false;
+  }
+
+private:
+  typedef std::list<Value> BinList;
+
+  struct Bin {
+    BinList ready_;    //!< Allocations without outstanding GPU work
+    BinList pending_;  //!< Allocations with a HIP event, which wasn't observed as retired
+  };
+
+  struct Slot {
+    uint32_t bin_;                   //!< Size class of the allocation
+    bool ready_;                     //!< The allocation is in the ready list
+    typename BinList::iterator it_;  //!< Position in the bin list
+  };
+
+  std::vector<Bin> bins_;                //!< Size class bins of the allocations
+  std::unordered_map<Key, Slot> slots_;  //!< Bin positions of the allocations
+};
+
+}  // namespace hip
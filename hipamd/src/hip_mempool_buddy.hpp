@@ -0,0 +1,151 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace hip {
+
+/// Buddy block lists of the pool suballocator. A chunk of a power of 2 size is split into
+/// the blocks of power of 2 sizes, starting from kMinBlockSize. The chunk is an opaque handle
+/// of the backing allocation and a block is the chunk plus the offset, hence the lists
+/// don't depend on the device memory objects.
+template <typename Chunk>
+class BuddyBlocks {
+public:
+  /// The minimum block size matches the device allocation alignment guarantee
+  static constexpr size_t kMinBlockSize = 256;
+
+  /// Sets the chunk size, rounded up to a power of 2. Returns false if the chunk is too small
+  /// for the suballocation
+  bool Init(size_t chunk_size) {
+    // A chunk must fit a few of the largest suballocations to keep the fragmentation low
+    constexpr size_t kBlocksPerChunk = 8;
+    if (chunk_size < kMinBlockSize * kBlocksPerChunk) {
+      return false;
+    }
+    chunk_size_ = kMinBlockSize;
+    max_order_ = 0;
+    while (chunk_size_ < chunk_size) {
+      chunk_size_ <<= 1;
+      ++max_order_;
+    }
+    max_size_ = chunk_size_ / kBlocksPerChunk;
+    free_blocks_.clear();
+    free_blocks_.resize(max_order_ + 1);
+    return true;
+  }
+
+  /// Returns true if the allocation size can be carved out of a chunk
+  bool IsSmall(size_t size) const { return (size != 0) && (size <= max_size_); }
+
+  /// Returns the size of backing chunks
+  size_t ChunkSize() const { return chunk_size_; }
+
+  /// Returns the buddy order of the allocation size
+  static uint32_t Order(size_t size) {
+    uint32_t order = 0;
+    while ((kMinBlockSize << order) < size) {
+      ++order;
+    }
+    return order;
+  }
+
+  /// Returns the block size of the allocation size
+  static size_t BlockSize(size_t size) { return kMinBlockSize << Order(size); }
+
+  /// Takes the lowest free block of the allocation size and splits the larger blocks if
+  /// necessary. Returns false if a new chunk is required
+  bool Allocate(size_t size, Chunk* chunk, size_t* offset) {
+    const uint32_t order = Order(size);
+    uint32_t level = order;
+    while ((level <= max_order_) && free_blocks_[level].empty()) {
+      ++level;
+    }
+    if (level > max_order_) {
+      return false;
+    }
+    auto block = *free_blocks_[level].begin();
+    free_blocks_[level].erase(free_blocks_[level].begin());
+    // The upper halves stay free
+    while (level > order) {
+      --level;
+      free_blocks_[level].insert({block.first, block.second + (kMinBlockSize << level)});
+    }
+    *chunk = block.first;
+    *offset = block.second;
+    return true;
+  }
+
+  /// Adds a new backing chunk with all blocks free
+  void AddChunk(Chunk chunk) {
+    chunks_.insert(chunk);
+    free_blocks_[max_order_].insert({chunk, 0});
+  }
+
+  /// Returns the block into the lists and merges it with the free buddies.
+  /// Returns true if the chunk became entirely free, hence it's removed from the lists
+  bool Free(Chunk chunk, size_t offset, size_t size) {
+    uint32_t order = Order(size);
+    while (order < max_order_) {
+      const size_t buddy = offset ^ (kMinBlockSize << order);
+      auto it = free_blocks_[order].find({chunk, buddy});
+      if (it == free_blocks_[order].end()) {
+        break;
+      }
+      free_blocks_[order].erase(it);
+      offset = std::min(offset, buddy);
+      ++order;
+    }
+    if (order < max_order_) {
+      free_blocks_[order].insert({chunk, offset});
+      return false;
+    }
+    chunks_.erase(chunk);
+    return true;
+  }
+
+  /// Checks if the chunk backs the blocks
+  bool IsChunk(Chunk chunk) const { return chunks_.find(chunk) != chunks_.end(); }
+
+  /// Returns the backing chunks
+  const std::unordered_set<Chunk>& Chunks() const { return chunks_; }
+
+  /// Returns the number of the free blocks of the order
+  size_t FreeBlocks(uint32_t order) const {
+    return (order < free_blocks_.size()) ? free_blocks_[order].size() : 0;
+  }
+
+private:
+  typedef std::set<std::pair<Chunk, size_t>> BlockSet;
+
+  size_t chunk_size_ = 0;                  //!< Size of backing chunks, power of 2
+  size_t max_size_ = 0;                    //!< The maximum size of a suballocation
+  uint32_t max_order_ = 0;                 //!< Buddy order of the entire chunk
+  std::vector<BlockSet> free_blocks_;      //!< Free blocks as chunk and offset for every order
+  std::unordered_set<Chunk> chunks_;       //!< Backing chunks
+};
+
+}  // namespace hip
@@ -0,0 +1,161 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace hip {
+
+//! Caches of the allocations, freed on the streams. A cache is claimed by a stream with a CAS
+//! and the same stream reuses the cached allocations without the pool lock, since the stream
+//! order guarantees that GPU is done with the memory. The class doesn't depend on the memory
+//! object type, so the lock-free paths can be measured on the host with stand-in allocations.
+template <typename Stream, typename Memory> class StreamCaches {
+ public:
+  static constexpr uint32_t kCaches = 16;  //!< The number of per-stream caches
+  static constexpr uint32_t kSlots = 8;    //!< The number of allocations in a cache
+
+  //! Finds a cached allocation of the stream in [size, max_size] without locks. An allocation
+  //! with a stale size hint goes back into the cache, or to the migrate functor if it's full
+  template <typename F> Memory* Allocate(size_t size, double max_size, Stream* stream,
+                                         F migrate) {
+    Cache& cache = Get(stream);
+    if (cache.stream_.load(std::memory_order_acquire) != stream) {
+      return nullptr;
+    }
+    for (uint32_t i = 0; i < kSlots; ++i) {
+      const size_t hint = cache.size_[i].load(std::memory_order_relaxed);
+      if ((hint < size) || (hint > max_size)) {
+        continue;
+      }
+      Memory* memory = cache.memory_[i].exchange(nullptr, std::memory_order_acquire);
+      if (memory == nullptr) {
+        continue;
+      }
+      cached_size_.fetch_sub(memory->getSize(), std::memory_order_relaxed);
+      // The size hint can be stale, hence validate the allocation after it was taken
+      if ((memory->getSize() >= size) && (memory->getSize() <= max_size)) {
+        return memory;
+      }
+      if (!Insert(&cache, memory)) {
+        migrate(memory, stream);
+      }
+    }
+    return nullptr;
+  }
+
+  //! Claims a free cache for the stream. Returns false if the cache belongs to another stream
+  bool Claim(Stream* stream) {
+    Cache& cache = Get(stream);
+    Stream* owner = cache.stream_.load(std::memory_order_acquire);
+    if ((owner == nullptr) &&
+        cache.stream_.compare_exchange_strong(owner, stream, std::memory_order_acq_rel)) {
+      owner = stream;
+    }
+    return owner == stream;
+  }
+
+  //! Places the allocation into the claimed cache of the stream. Returns false if it's full
+  bool Insert(Memory* memory, Stream* stream) { return Insert(&Get(stream), memory); }
+
+  //! Passes all cached allocations of the stream to the migrate functor
+  template <typename F> void Flush(Stream* stream, F migrate) {
+    Cache& cache = Get(stream);
+    if (cache.stream_.load(std::memory_order_relaxed) == stream) {
+      Flush(&cache, migrate);
+    }
+  }
+
+  //! Passes the cached allocations of all streams to the migrate functor
+  template <typename F> void FlushAll(F migrate) {
+    if (cached_size_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+    for (auto& cache : caches_) {
+      Flush(&cache, migrate);
+    }
+  }
+
+  //! Flushes the cache of the destroyed stream and makes it available to other streams
+  template <typename F> void Remove(Stream* stream, F migrate) {
+    Cache& cache = Get(stream);
+    if (cache.stream_.load(std::memory_order_relaxed) == stream) {
+      Flush(&cache, migrate);
+      cache.stream_.store(nullptr, std::memory_order_release);
+    }
+  }
+
+  //! Returns the size of all cached allocations
+  uint64_t CachedSize() const { return cached_size_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Cache {
+    Cache() {
+      for (uint32_t i = 0; i < kSlots; ++i) {
+        memory_[i].store(nullptr, std::memory_order_relaxed);
+        size_[i].store(0, std::memory_order_relaxed);
+      }
+    }
+    std::atomic<Stream*> stream_{nullptr};     //!< Stream, which owns the cache
+    std::atomic<Memory*> memory_[kSlots];      //!< Cached allocations
+    std::atomic<size_t> size_[kSlots];         //!< Size hints for the allocation search
+  };
+
+  //! Returns the cache slot set of the stream
+  Cache& Get(Stream* stream) {
+    return caches_[(reinterpret_cast<uintptr_t>(stream) >> 6) % kCaches];
+  }
+
+  bool Insert(Cache* cache, Memory* memory) {
+    for (uint32_t i = 0; i < kSlots; ++i) {
+      Memory* expected = nullptr;
+      if (cache->memory_[i].load(std::memory_order_relaxed) == nullptr) {
+        // A concurrent insert can overwrite the hint, but the allocation search validates it
+        cache->size_[i].store(memory->getSize(), std::memory_order_relaxed);
+        // Account the size first, so the concurrent search never makes the counter negative
+        cached_size_.fetch_add(memory->getSize(), std::memory_order_relaxed);
+        if (cache->memory_[i].compare_exchange_strong(expected, memory, std::memory_order_release,
+                                                      std::memory_order_relaxed)) {
+          return true;
+        }
+        cached_size_.fetch_sub(memory->getSize(), std::memory_order_relaxed);
+      }
+    }
+    return false;
+  }
+
+  template <typename F> void Flush(Cache* cache, F migrate) {
+    Stream* stream = cache->stream_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < kSlots; ++i) {
+      Memory* memory = cache->memory_[i].exchange(nullptr, std::memory_order_acquire);
+      if (memory != nullptr) {
+        cached_size_.fetch_sub(memory->getSize(), std::memory_order_relaxed);
+        migrate(memory, stream);
+      }
+    }
+  }
+
+  Cache caches_[kCaches];                  //!< Per-stream caches of freed allocations
+  std::atomic<uint64_t> cached_size_{0};   //!< Size of all cached allocations
+};
+
+}  // namespace hip
@@ -24,10 +24,93 @@
 
 namespace hip {
 
+namespace {
+// Enables or disables P2P access to the memory object for the provided device
+void SetPeerAccess(amd::Memory* memory, hip::Device* device, bool enable) {
+  auto peer_device = device->asContext()->devices()[0];
+  device::Memory* mem = memory->getDeviceMemory(*peer_device);
+  if (mem != nullptr) {
+    if (!mem->getAllowedPeerAccess() && enable) {
+      // Enable p2p access for the specified device
+      peer_device->allowPeerAccess(mem);
+      mem->setAllowedPeerAccess(true);
+    } else if (mem->getAllowedPeerAccess() && !enable) {
+      mem->setAllowedPeerAccess(false);
+    }
+  } else {
+    LogError("Couldn't find device memory for P2P access");
+  }
+}
+}  // namespace
+
+// ================================================================================================
+amd::Memory* SubAllocator::Allocate(size_t size) {
+  amd::Memory* chunk = nullptr;
+  size_t offset = 0;
+  if (!blocks_.Allocate(size, &chunk, &offset)) {
+    return nullptr;
+  }
+  amd::Memory* memory = new (chunk->getContext())
+      amd::Buffer(*chunk, chunk->getMemFlags(), offset, size);
+  if ((memory == nullptr) || !memory->create(nullptr)) {
+    if (memory != nullptr) {
+      memory->release();
+    }
+    FreeBlock(chunk, offset, size);
+    return nullptr;
+  }
+  // Saves the device id so that the free path finds the pool
+  memory->getUserData().deviceId = chunk->getUserData().deviceId;
+  amd::MemObjMap::AddMemObj(memory->getSvmPtr(), memory);
+  allocated_size_ += size;
+  return memory;
+}
+
+// ================================================================================================
+void SubAllocator::AddChunk(amd::Memory* chunk) {
+  // The suballocations own the chunk addresses in the memory object map
+  amd::MemObjMap::RemoveMemObj(chunk->getSvmPtr());
+  blocks_.AddChunk(chunk);
+}
+
+// ================================================================================================
+void SubAllocator::Free(amd::Memory* memory) {
+  amd::Memory* chunk = memory->parent();
+  const size_t offset = memory->getOrigin();
+  const size_t size = memory->getSize();
+  allocated_size_ -= size;
+  amd::MemObjMap::RemoveMemObj(memory->getSvmPtr());
+  // The chunk stays alive, since it's still referenced by the suballocator
+  memory->release();
+  FreeBlock(chunk, offset, size);
+}
+
+// ================================================================================================
+void SubAllocator::FreeBlock(amd::Memory* chunk, size_t offset, size_t size) {
+  if (!blocks_.Free(chunk, offset, size)) {
+    return;
+  }
+  // The chunk is entirely free, hence return it to OS
+  void* dev_ptr = chunk->getSvmPtr();
+  amd::MemObjMap::AddMemObj(dev_ptr, chunk);
+  amd::SvmBuffer::free(chunk->getContext(), dev_ptr);
+}
+
+// ================================================================================================
+void SubAllocator::SetAccess(hip::Device* device, bool enable) {
+  for (auto chunk : blocks_.Chunks()) {
+    SetPeerAccess(chunk, device, enable);
+  }
+}
+
 // ================================================================================================
 void Heap::AddMemory(amd::Memory* memory, Stream* stream) {
   auto mem_size = memory->getSize();
-  allocations_.insert({{mem_size, memory}, {stream}});
+  auto result = allocations_.insert({{mem_size, memory}, {stream}});
+  if (result.second) {
+    // An allocation without HIP event doesn't have outstanding GPU work
+    bins_.Insert(memory, mem_size, result.first, result.first->second.event_ == nullptr);
+  }
   total_size_ += mem_size;
   max_total_size_ = std::max(max_total_size_, total_size_);
 }
@@ -35,41 +118,80 @@ void Heap::AddMemory(amd::Memory* memory, Stream* stream) {
 // ================================================================================================
 void Heap::AddMemory(amd::Memory* memory, const MemoryTimestamp& ts) {
   auto mem_size = memory->getSize();
-  allocations_.insert({{mem_size, memory}, ts});
+  auto result = allocations_.insert({{mem_size, memory}, ts});
+  if (result.second) {
+    bins_.Insert(memory, mem_size, result.first, result.first->second.event_ == nullptr);
+  }
   total_size_ += mem_size;
   max_total_size_ = std::max(max_total_size_, total_size_);
 }
 
 // ================================================================================================
-amd::Memory* Heap::FindMemory(size_t size, Stream* stream, bool opportunistic,
+amd::Memory* Heap::TakeMemory(SortedMap::iterator it, MemoryTimestamp* ts) {
+  amd::Memory* memory = it->first.second;
+  total_size_ -= memory->getSize();
+  // Preserve event, since the logic could skip GPU wait on reuse
+  ts->event_ = it->second.event_;
+  // Remove found allocation from the bin and the map
+  bins_.Erase(memory);
+  allocations_.erase(it);
+  return memory;
+}
+
+// ================================================================================================
+amd::Memory* Heap::FindMemoryAtAddress(size_t size, Stream* stream, bool opportunistic,
     void* dptr, MemoryTimestamp* ts) {
-  amd::Memory* memory = nullptr;
   auto start = allocations_.lower_bound({size, nullptr});
-  for (auto it = start; it != allocations_.end();) {
-    bool check_address = (dptr == nullptr);
+  for (auto it = start; it != allocations_.end(); ++it) {
+    // Runtime can accept an allocation with 12.5% on the size threshold
+    if (it->first.first > (size / 8.0) * 9) {
+      return nullptr;
+    }
     if (it->first.second->getSvmPtr() == dptr) {
       // If the search is done for the specified address then runtime must wait
       it->second.Wait();
-      check_address = true;
+      if (it->second.IsSafeFind(stream, opportunistic)) {
+        return TakeMemory(it, ts);
+      }
     }
-    // Runtime can accept an allocation with 12.5% on the size threshold
-    if (it->first.first > (size / 8.0) * 9) {
-      return nullptr;
+  }
+  return nullptr;
+}
+
+// ================================================================================================
+amd::Memory* Heap::FindMemory(size_t size, Stream* stream, bool opportunistic,
+    void* dptr, MemoryTimestamp* ts) {
+  if (dptr != nullptr) {
+    return FindMemoryAtAddress(size, stream, opportunistic, dptr, ts);
+  }
+  // Runtime can accept an allocation with 12.5% on the size threshold
+  const double max_size = (size / 8.0) * 9;
+  // The search passes:
+  // 0 - the ready lists, no validation is required
+  // 1 - the pending lists for the safe streams, no HIP event query is required
+  // 2 - the pending lists with HIP event queries, the retired allocations become ready
+  constexpr uint32_t kSafeStream = 1;
+  constexpr uint32_t kEventQuery = 2;
+  const uint32_t passes = opportunistic ? (kEventQuery + 1) : kEventQuery;
+  auto visit = [&](uint32_t pass, SortedMap::iterator it) {
+    if (pass == kEventQuery) {
+      if (!it->second.IsSafeRelease()) {
+        return false;
+      }
+      // The retired allocation doesn't require the query on the next search
+      bins_.MarkReady(it->first.second);
     }
-    // Check if size can match and it's safe to use this resource.
-    if (check_address && (it->second.IsSafeFind(stream, opportunistic))) {
-      memory = it->first.second;
-      total_size_ -= memory->getSize();
-      // Preserve event, since the logic could skip GPU wait on reuse
-      ts->event_ = it->second.event_;
-      // Remove found allocation from the map
-      it = allocations_.erase(it);
-      break;
-    } else {
-      ++it;
+    if ((it->first.first < size) || (it->first.first > max_size)) {
+      return false;
     }
+    return (pass != kSafeStream) ||
+        (it->second.safe_streams_.find(stream) != it->second.safe_streams_.end());
+  };
+  SortedMap::iterator it;
+  if (bins_.Find(size, static_cast<size_t>(max_size), passes, visit, &it)) {
+    return TakeMemory(it, ts);
   }
-  return memory;
+  return nullptr;
 }
 
 // ================================================================================================
@@ -83,6 +205,7 @@ bool Heap::RemoveMemory(amd::Memory* memory, MemoryTimestamp* ts) {
       it->second.SetEvent(nullptr);
     }
     total_size_ -= mem_size;
+    bins_.Erase(memory);
     allocations_.erase(it);
     return true;
   }
@@ -92,18 +215,24 @@ bool Heap::RemoveMemory(amd::Memory* memory, MemoryTimestamp* ts) {
 // ================================================================================================
 Heap::SortedMap::iterator Heap::EraseAllocaton(Heap::SortedMap::iterator& it) {
   auto memory = it->first.second;
-  const device::Memory* dev_mem = memory->getDeviceMemory(*device_->devices()[0]);
-  void* dev_mem_vaddr = reinterpret_cast<void*>(dev_mem->virtualAddress());
   total_size_ -= it->first.first;
 
-  if (dev_mem_vaddr != nullptr) {
-    amd::SvmBuffer::free(memory->getContext(), dev_mem_vaddr);
+  if (sub_allocator_->IsSubAllocation(memory)) {
+    // Return the block into its chunk
+    sub_allocator_->Free(memory);
   } else {
-    amd::SvmBuffer::free(memory->getContext(), memory->getSvmPtr());
+    const device::Memory* dev_mem = memory->getDeviceMemory(*device_->devices()[0]);
+    void* dev_mem_vaddr = reinterpret_cast<void*>(dev_mem->virtualAddress());
+    if (dev_mem_vaddr != nullptr) {
+      amd::SvmBuffer::free(memory->getContext(), dev_mem_vaddr);
+    } else {
+      amd::SvmBuffer::free(memory->getContext(), memory->getSvmPtr());
+    }
   }
   // Clear HIP event
   it->second.SetEvent(nullptr);
-  // Remove the allocation from the map
+  // Remove the allocation from the bin and the map
+  bins_.Erase(memory);
   return allocations_.erase(it);
 }
 
@@ -153,63 +282,148 @@ void Heap::RemoveStream(Stream* stream) {
 // ================================================================================================
 void Heap::SetAccess(hip::Device* device, bool enable) {
   for (const auto& it : allocations_) {
-    auto peer_device = device->asContext()->devices()[0];
-    device::Memory* mem = it.first.second->getDeviceMemory(*peer_device);
-    if (mem != nullptr) {
-      if (!mem->getAllowedPeerAccess() && enable) {
-        // Enable p2p access for the specified device
-        peer_device->allowPeerAccess(mem);
-        mem->setAllowedPeerAccess(true);
-      } else if (mem->getAllowedPeerAccess() && !enable) {
-        mem->setAllowedPeerAccess(false);
-      }
-    } else {
-      LogError("Couldn't find device memory for P2P access");
+    // The access to suballocations is controlled with the backing chunks
+    if (!sub_allocator_->IsSubAllocation(it.first.second)) {
+      SetPeerAccess(it.first.second, device, enable);
+    }
+  }
+}
+
+// ================================================================================================
+void* MemoryPool::AllocateDeviceMemory(size_t size, amd::Memory** memory) {
+  amd::Context* context = device_->asContext();
+  const auto& dev_info = context->devices()[0]->info();
+  if (dev_info.maxMemAllocSize_ < size) {
+    return nullptr;
+  }
+  cl_svm_mem_flags flags = (state_.interprocess_) ? ROCCLR_MEM_INTERPROCESS : 0;
+  flags |= (state_.phys_mem_) ? ROCCLR_MEM_PHYMEM : 0;
+  void* dev_ptr = amd::SvmBuffer::malloc(*context, flags, size, dev_info.memBaseAddrAlign_,
+                                         nullptr);
+  if (dev_ptr == nullptr) {
+    size_t free = 0, total =0;
+    hipError_t err = hipMemGetInfo(&free, &total);
+    if (err == hipSuccess) {
+      LogPrintfError("Allocation failed : Device memory : required :%zu | free :%zu | total :%zu",
+        size, free, total);
+    }
+    return nullptr;
+  }
+
+  size_t offset = 0;
+  *memory = getMemoryObject(dev_ptr, offset);
+  // Saves the current device id so that it can be accessed later
+  (*memory)->getUserData().deviceId = device_->deviceId();
+
+  // Update access for the new allocation from other devices
+  for (const auto& it : access_map_) {
+    auto vdi_device = it.first->asContext()->devices()[0];
+    device::Memory* mem = (*memory)->getDeviceMemory(*vdi_device);
+    if ((mem != nullptr) && (it.second != hipMemAccessFlagsProtNone)) {
+      vdi_device->allowPeerAccess(mem);
+      mem->setAllowedPeerAccess(true);
     }
   }
+  return dev_ptr;
+}
+
+// ================================================================================================
+amd::Memory* MemoryPool::CacheAllocate(size_t size, Stream* stream) {
+  // Runtime can accept an allocation with 12.5% on the size threshold
+  const double max_size = (size / 8.0) * 9;
+  return caches_.Allocate(size, max_size, stream, [this](amd::Memory* cached, Stream* owner) {
+    amd::ScopedLock lock(lock_pool_ops_);
+    CacheMigrate(cached, owner);
+  });
+}
+
+// ================================================================================================
+bool MemoryPool::CacheFree(amd::Memory* memory, Stream* stream) {
+  if (!state_.stream_cache_ || (stream == nullptr)) {
+    return false;
+  }
+  // Only the streams of the pool device are removed from the pool on destruction,
+  // hence a cache can't hold a stream of another device
+  if ((stream->GetDevice() != device_) || (memory->getSize() > kMaxStreamCacheSize)) {
+    return false;
+  }
+  // Claim a free cache for the stream. The cache of another stream can't be used
+  if (!caches_.Claim(stream)) {
+    return false;
+  }
+  if (!caches_.Insert(memory, stream)) {
+    // The cache is full, hence migrate all cached allocations into the free heap at once
+    amd::ScopedLock lock(lock_pool_ops_);
+    caches_.Flush(stream, [this](amd::Memory* cached, Stream* owner) {
+      CacheMigrate(cached, owner);
+    });
+    if (!caches_.Insert(memory, stream)) {
+      return false;
+    }
+  }
+  ClPrint(amd::LOG_INFO, amd::LOG_MEM_POOL, "Pool CacheFreeMem: %p, %p", memory->getSvmPtr(),
+          memory);
+
+  // Decrement the reference counter on the pool
+  release();
+  return true;
+}
+
+// ================================================================================================
+void MemoryPool::CacheMigrate(amd::Memory* memory, Stream* stream) {
+  MemoryTimestamp ts;
+  if (busy_heap_.RemoveMemory(memory, &ts)) {
+    AddFreeMemory(memory, &ts, stream, nullptr);
+  }
+}
+
+// ================================================================================================
+void MemoryPool::FlushCaches() {
+  caches_.FlushAll([this](amd::Memory* memory, Stream* stream) { CacheMigrate(memory, stream); });
 }
 
 // ================================================================================================
 void* MemoryPool::AllocateMemory(size_t size, Stream* stream, void* dptr) {
+  // The same stream reuses the cached allocations without the pool lock
+  if ((dptr == nullptr) && state_.stream_cache_) {
+    amd::Memory* memory = CacheAllocate(size, stream);
+    if (memory != nullptr) {
+      // Increment the reference counter on the pool
+      retain();
+      ClPrint(amd::LOG_INFO, amd::LOG_MEM_POOL, "Pool CacheAllocMem: %p, %p",
+              memory->getSvmPtr(), memory);
+      return memory->getSvmPtr();
+    }
+  }
   amd::ScopedLock lock(lock_pool_ops_);
 
   void* dev_ptr = nullptr;
   MemoryTimestamp ts;
   amd::Memory* memory = free_heap_.FindMemory(size, stream, Opportunistic(), dptr, &ts);
   if (memory == nullptr) {
-    if (Properties().maxSize != 0 && (max_total_size_ + size) > Properties().maxSize) {
-      return nullptr;
-    }
-    amd::Context* context = device_->asContext();
-    const auto& dev_info = context->devices()[0]->info();
-    if (dev_info.maxMemAllocSize_ < size) {
-      return nullptr;
-    }
-    cl_svm_mem_flags flags = (state_.interprocess_) ? ROCCLR_MEM_INTERPROCESS : 0;
-    flags |= (state_.phys_mem_) ? ROCCLR_MEM_PHYMEM : 0;
-    dev_ptr = amd::SvmBuffer::malloc(*context, flags, size, dev_info.memBaseAddrAlign_, nullptr);
-    if (dev_ptr == nullptr) {
-      size_t free = 0, total =0;
-      hipError_t err = hipMemGetInfo(&free, &total);
-      if (err == hipSuccess) {
-        LogPrintfError("Allocation failed : Device memory : required :%zu | free :%zu | total :%zu",
-          size, free, total);
+    const size_t max_size = Properties().maxSize;
+    // Carve the small allocations out of the backing chunks, so they don't require
+    // a device allocation each. A carve from an existing chunk doesn't reserve more memory
+    if ((dptr == nullptr) && sub_allocator_.IsSmall(size)) {
+      memory = sub_allocator_.Allocate(size);
+      amd::Memory* chunk = nullptr;
+      // A new chunk reserves the whole chunk size, otherwise fall back to a direct allocation
+      if ((memory == nullptr) &&
+          ((max_size == 0) || ((ReservedSize() + sub_allocator_.ChunkSize()) <= max_size)) &&
+          (AllocateDeviceMemory(sub_allocator_.ChunkSize(), &chunk) != nullptr)) {
+        sub_allocator_.AddChunk(chunk);
+        memory = sub_allocator_.Allocate(size);
       }
-      return nullptr;
     }
-
-    size_t offset = 0;
-    memory = getMemoryObject(dev_ptr, offset);
-    // Saves the current device id so that it can be accessed later
-    memory->getUserData().deviceId = device_->deviceId();
-
-    // Update access for the new allocation from other devices
-    for (const auto& it : access_map_) {
-      auto vdi_device = it.first->asContext()->devices()[0];
-      device::Memory* mem = memory->getDeviceMemory(*vdi_device);
-      if ((mem != nullptr) && (it.second != hipMemAccessFlagsProtNone)) {
-        vdi_device->allowPeerAccess(mem);
-        mem->setAllowedPeerAccess(true);
+    if (memory != nullptr) {
+      dev_ptr = memory->getSvmPtr();
+    } else {
+      if (max_size != 0 && (max_total_size_ + size) > max_size) {
+        return nullptr;
+      }
+      dev_ptr = AllocateDeviceMemory(size, &memory);
+      if (dev_ptr == nullptr) {
+        return nullptr;
       }
     }
   } else {
@@ -220,9 +434,9 @@ void* MemoryPool::AllocateMemory(size_t size, Stream* stream, void* dptr) {
   // Place the allocated memory into the busy heap
   ts.AddSafeStream(stream);
   busy_heap_.AddMemory(memory, ts);
+  memory->getUserData().mem_pool = this;
 
-  max_total_size_ = std::max(max_total_size_, busy_heap_.GetTotalSize() +
-                                                  free_heap_.GetTotalSize());
+  max_total_size_ = std::max(max_total_size_, ReservedSize());
   // Increment the reference counter on the pool
   retain();
 
@@ -276,28 +490,7 @@ bool MemoryPool::FreeMemory(amd::Memory* memory, Stream* stream, Event* event) {
       cmd->release();
     }
 
-    if (stream != nullptr) {
-      // The stream of destruction is a safe stream, because the app must handle sync
-      ts.AddSafeStream(stream);
-
-      if (event == nullptr) {
-        // Add a marker to the stream to trace availability of this memory
-        Event* e = new hip::Event(0);
-        if (e != nullptr) {
-          if (hipSuccess == e->addMarker(reinterpret_cast<hipStream_t>(stream), nullptr, true)) {
-            ts.SetEvent(e);
-            // Make sure runtime sends a notification
-            auto result = e->ready();
-          }
-        }
-      } else {
-        ts.SetEvent(event);
-      }
-    } else {
-      // Assume a safe release from hipFree() if stream is nullptr
-      ts.SetEvent(nullptr);
-    }
-    free_heap_.AddMemory(memory, ts);
+    AddFreeMemory(memory, &ts, stream, event);
   }
 
   // Decrement the reference counter on the pool.
@@ -308,6 +501,33 @@ bool MemoryPool::FreeMemory(amd::Memory* memory, Stream* stream, Event* event) {
   return true;
 }
 
+// ================================================================================================
+void MemoryPool::AddFreeMemory(amd::Memory* memory, MemoryTimestamp* ts, Stream* stream,
+                               Event* event) {
+  if (stream != nullptr) {
+    // The stream of destruction is a safe stream, because the app must handle sync
+    ts->AddSafeStream(stream);
+
+    if (event == nullptr) {
+      // Add a marker to the stream to trace availability of this memory
+      Event* e = new hip::Event(0);
+      if (e != nullptr) {
+        if (hipSuccess == e->addMarker(reinterpret_cast<hipStream_t>(stream), nullptr, true)) {
+          ts->SetEvent(e);
+          // Make sure runtime sends a notification
+          auto result = e->ready();
+        }
+      }
+    } else {
+      ts->SetEvent(event);
+    }
+  } else {
+    // Assume a safe release from hipFree() if stream is nullptr
+    ts->SetEvent(nullptr);
+  }
+  free_heap_.AddMemory(memory, *ts);
+}
+
 // ================================================================================================
 void MemoryPool::ReleaseAllMemory() {
   constexpr bool kSafeRelease = true;
@@ -319,6 +539,10 @@ void MemoryPool::ReleaseAllMemory() {
 void MemoryPool::ReleaseFreedMemory() {
   amd::ScopedLock lock(lock_pool_ops_);
 
+  // The cached allocations stay in the busy heap, hence migrate them into the free heap,
+  // so the release threshold applies to them
+  FlushCaches();
+
   free_heap_.ReleaseAllMemory();
 }
 
@@ -326,6 +550,11 @@ void MemoryPool::ReleaseFreedMemory() {
 void MemoryPool::RemoveStream(Stream* stream) {
   amd::ScopedLock lock(lock_pool_ops_);
 
+  // Release the cache of the destroyed stream
+  caches_.Remove(stream, [this](amd::Memory* cached, Stream* owner) {
+    CacheMigrate(cached, owner);
+  });
+
   free_heap_.RemoveStream(stream);
 }
 
@@ -333,6 +562,8 @@ void MemoryPool::RemoveStream(Stream* stream) {
 void MemoryPool::TrimTo(size_t min_bytes_to_hold) {
   amd::ScopedLock lock(lock_pool_ops_);
 
+  FlushCaches();
+
   free_heap_.ReleaseAllMemory(min_bytes_to_hold);
 }
 
@@ -409,15 +640,15 @@ hipError_t MemoryPool::GetAttribute(hipMemPoolAttr attr, void* value) {
       break;
     case hipMemPoolAttrReservedMemCurrent:
       // All allocate memory by the pool in OS
-      *reinterpret_cast<uint64_t*>(value) = busy_heap_.GetTotalSize() + free_heap_.GetTotalSize();
+      *reinterpret_cast<uint64_t*>(value) = ReservedSize();
       break;
     case hipMemPoolAttrReservedMemHigh:
       // High watermark of all allocated memory in OS, since the last reset
       *reinterpret_cast<uint64_t*>(value) = max_total_size_;
       break;
     case hipMemPoolAttrUsedMemCurrent:
-      // Total currently used memory by the pool
-      *reinterpret_cast<uint64_t*>(value) = busy_heap_.GetTotalSize();
+      // Total currently used memory by the pool. The cached allocations are freed by the app
+      *reinterpret_cast<uint64_t*>(value) = busy_heap_.GetTotalSize() - caches_.CachedSize();
       break;
     case hipMemPoolAttrUsedMemHigh:
       // High watermark of all used memoryS, since the last reset
@@ -456,6 +687,7 @@ void MemoryPool::SetAccess(hip::Device* device, hipMemAccessFlags flags) {
     // Update device access on the both pools
     busy_heap_.SetAccess(device, enable_access);
     free_heap_.SetAccess(device, enable_access);
+    sub_allocator_.SetAccess(device, enable_access);
   }
 }
 
@@ -474,6 +706,10 @@ void MemoryPool::GetAccess(hip::Device* device, hipMemAccessFlags* flags) {
 
 // ================================================================================================
 void MemoryPool::FreeAllMemory(Stream* stream) {
+  {
+    amd::ScopedLock lock(lock_pool_ops_);
+    FlushCaches();
+  }
   while (!busy_heap_.Allocations().empty()) {
     FreeMemory(busy_heap_.Allocations().begin()->first.second, stream);
   }
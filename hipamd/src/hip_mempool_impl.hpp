@@ -23,8 +23,14 @@
 #include <hip/hip_runtime.h>
 #include "hip_event.hpp"
 #include "hip_internal.hpp"
+#include "hip_mempool_bins.hpp"
+#include "hip_mempool_buddy.hpp"
+#include "hip_mempool_cache.hpp"
+#include <map>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace hip {
 
@@ -97,12 +103,67 @@ struct MemoryTimestamp {
   hip::Event*   event_ = nullptr;   //!< Last known HIP event, associated with the memory object
 };
 
+/// Buddy suballocator, which carves the small pool allocations out of large backing chunks.
+/// Every suballocation is a sub-buffer of its chunk with own entry in the memory object map,
+/// hence the heaps track and reuse it as a regular allocation. The block returns into
+/// the buddy lists only when a heap releases the allocation and a chunk is freed as soon as
+/// all its blocks are merged back.
+class SubAllocator {
+ public:
+  SubAllocator() : allocated_size_(0) {}
+
+  /// Sets the chunk size, 0 disables the suballocation
+  void Init(size_t chunk_size) { blocks_.Init(chunk_size); }
+
+  /// Returns true if the allocation size can be carved out of a chunk
+  bool IsSmall(size_t size) const { return blocks_.IsSmall(size); }
+
+  /// Returns the size of backing chunks
+  size_t ChunkSize() const { return blocks_.ChunkSize(); }
+
+  /// Carves the allocation out of the chunks. Returns nullptr if a new chunk is required
+  amd::Memory* Allocate(size_t size);
+
+  /// Adds a new backing chunk with all blocks free
+  void AddChunk(amd::Memory* chunk);
+
+  /// Releases the suballocation and frees the chunk if it becomes empty
+  void Free(amd::Memory* memory);
+
+  /// Checks if memory was carved out of a chunk
+  bool IsSubAllocation(amd::Memory* memory) const {
+    return (memory->parent() != nullptr) && blocks_.IsChunk(memory->parent());
+  }
+
+  /// Enables P2P access to the chunks for the provided device
+  void SetAccess(hip::Device* device, bool enable);
+
+  /// Returns the size of all suballocations
+  uint64_t AllocatedSize() const { return allocated_size_; }
+
+  /// Returns the size of all backing chunks
+  uint64_t ReservedSize() const { return blocks_.Chunks().size() * blocks_.ChunkSize(); }
+
+ private:
+  SubAllocator(const SubAllocator&) = delete;
+  SubAllocator& operator=(const SubAllocator&) = delete;
+
+  /// Returns the block into the buddy lists and frees the chunk if it becomes empty
+  void FreeBlock(amd::Memory* chunk, size_t offset, size_t size);
+
+  BuddyBlocks<amd::Memory*> blocks_;  //!< Buddy lists of the backing chunks
+  uint64_t allocated_size_;           //!< Size of all suballocations
+};
+
+/// The heap keeps the allocations in a sorted map and indexes them in segregated size classes,
+/// so the search finds a reusable allocation without HIP event queries on the fast path.
 class Heap : public amd::EmbeddedObject {
 public:
   typedef std::map<std::pair<size_t, amd::Memory*>, MemoryTimestamp> SortedMap;
 
-  Heap(hip::Device* device):
-    total_size_(0), max_total_size_(0), release_threshold_(0), device_(device) {}
+  Heap(hip::Device* device, SubAllocator* sub_allocator):
+    total_size_(0), max_total_size_(0), release_threshold_(0), device_(device),
+    sub_allocator_(sub_allocator) {}
   ~Heap() {}
 
   /// Adds allocation into the heap on a specific stream
@@ -169,12 +230,21 @@ private:
   Heap(const Heap&) = delete;
   Heap& operator=(const Heap&) = delete;
 
+  /// Removes the allocation, found for reuse, from the heap
+  amd::Memory* TakeMemory(SortedMap::iterator it, MemoryTimestamp* ts);
+
+  /// Finds memory object for the specified address. The search waits for the address
+  amd::Memory* FindMemoryAtAddress(size_t size, Stream* stream, bool opportunistic,
+    void* dptr, MemoryTimestamp* ts);
+
   SortedMap allocations_;       //!< Map of allocations on a specific stream
+  SizeClassBins<amd::Memory*, SortedMap::iterator> bins_;  //!< Size class index
   uint64_t total_size_;         //!< Size of all allocations in the heap
   uint64_t max_total_size_;     //!< Maximum heap allocation size
   uint64_t release_threshold_;  //!< Threshold size in bytes for memory release from heap, default 0
 
   hip::Device*  device_;    //!< Hip device the allocations will reside
+  SubAllocator* sub_allocator_;  //!< Suballocator of the pool for the small allocations
 };
 
 /// Allocates memory in the pool on the specified stream and places the allocation into busy_heap_
@@ -189,6 +259,9 @@ class MemoryPool : public amd::ReferenceCountedObject {
   };
 
   static constexpr uint32_t kMaxMgpuAccess = 32;
+  //! The largest allocation the stream caches hold. The cached allocations stay in the busy
+  //! heap, hence the memory pressure release in FreeMemory() doesn't see them
+  static constexpr size_t kMaxStreamCacheSize = 1024 * 1024;
   struct SharedMemPool {
     amd::Os::FileDesc handle_;            //!< File descriptor for shared memory
     uint32_t state_;                      //!< Memory pool state
@@ -197,8 +270,8 @@ class MemoryPool : public amd::ReferenceCountedObject {
   };
 
   MemoryPool(hip::Device* device, const hipMemPoolProps* props = nullptr, bool phys_mem = false)
-      : busy_heap_(device),
-        free_heap_(device),
+      : busy_heap_(device, &sub_allocator_),
+        free_heap_(device, &sub_allocator_),
         lock_pool_ops_(true), /* Pool operations */
         device_(device),
         shared_(nullptr),
@@ -209,6 +282,7 @@ class MemoryPool : public amd::ReferenceCountedObject {
     state_.opportunistic_ = 1;
     state_.internal_dependencies_ = 1;
     state_.phys_mem_ = HIP_MEM_POOL_USE_VM && phys_mem;
+    state_.stream_cache_ = HIP_MEM_POOL_STREAM_CACHE && !phys_mem;
     if (props != nullptr) {
       properties_ = *props;
     } else {
@@ -220,9 +294,17 @@ class MemoryPool : public amd::ReferenceCountedObject {
                      .reserved = {}};
     }
     state_.interprocess_ = properties_.handleTypes != hipMemHandleTypeNone;
+    // IPC export and physical memory mapping work on entire allocations only
+    if (!state_.interprocess_ && !state_.phys_mem_) {
+      sub_allocator_.Init(static_cast<size_t>(HIP_MEM_POOL_CHUNK_SIZE) * Mi);
+    }
   }
 
   virtual ~MemoryPool() {
+    {
+      amd::ScopedLock lock(lock_pool_ops_);
+      FlushCaches();
+    }
     if (!busy_heap_.IsEmpty()) {
       LogError("Shouldn't destroy pool with busy allocations!");
     }
@@ -241,6 +323,11 @@ class MemoryPool : public amd::ReferenceCountedObject {
   /// Frees memory by placing memory object with HIP event into free_heap_
   bool FreeMemory(amd::Memory* memory, Stream* stream, Event* event = nullptr);
 
+  /// Frees memory into the cache of the stream without the pool lock. Only the small
+  /// allocations on the streams of the pool device are cached.
+  /// Returns false if the allocation must be freed with FreeMemory()
+  bool CacheFree(amd::Memory* memory, Stream* stream);
+
   /// Check if memory is active and belongs to the busy heap
   bool IsBusyMemory(amd::Memory* memory) const { return busy_heap_.IsActiveMemory(memory); }
 
@@ -309,6 +396,30 @@ class MemoryPool : public amd::ReferenceCountedObject {
   MemoryPool(const MemoryPool&) = delete;
   MemoryPool& operator=(const MemoryPool&) = delete;
 
+  /// Finds a cached allocation for the stream without the pool lock
+  amd::Memory* CacheAllocate(size_t size, Stream* stream);
+
+  /// Moves the cached allocation from the busy heap into the free heap.
+  /// @note The caller must hold the pool lock
+  void CacheMigrate(amd::Memory* memory, Stream* stream);
+
+  /// Migrates the allocations from all stream caches into the free heap.
+  /// @note The caller must hold the pool lock
+  void FlushCaches();
+
+  /// Places the allocation, removed from the busy heap, into the free heap
+  void AddFreeMemory(amd::Memory* memory, MemoryTimestamp* ts, Stream* stream, Event* event);
+
+  /// Allocates device memory for a new allocation or a backing chunk
+  void* AllocateDeviceMemory(size_t size, amd::Memory** memory);
+
+  /// Returns the size of all memory, allocated by the pool in OS
+  uint64_t ReservedSize() const {
+    return busy_heap_.GetTotalSize() + free_heap_.GetTotalSize() -
+        sub_allocator_.AllocatedSize() + sub_allocator_.ReservedSize();
+  }
+
+  SubAllocator sub_allocator_;  //!< Suballocator for the small allocations
   Heap busy_heap_;    //!< Heap of busy allocations
   Heap free_heap_;    //!< Heap of freed allocations
   union {
@@ -320,6 +431,7 @@ class MemoryPool : public amd::ReferenceCountedObject {
       uint32_t interprocess_ : 1;   //!< Memory pool can be used in interprocess communications
       uint32_t graph_in_use_ : 1;   //!< Memory pool was used in a graph execution
       uint32_t phys_mem_ : 1;       //!< Mempool is used for graphs and will have physical allocations
+      uint32_t stream_cache_ : 1;   //!< Freed allocations are cached for the same stream reuse
     };
     uint32_t value_;
   } state_;
@@ -330,6 +442,7 @@ class MemoryPool : public amd::ReferenceCountedObject {
   hip::Device*  device_;    //!< Hip device the heap will reside
   SharedMemPool* shared_;   //!< Pointer to shared memory for IPC
   uint64_t max_total_size_; //!< Max of total reserved memory in the pool since last reset
+  StreamCaches<Stream, amd::Memory> caches_;  //!< Per-stream caches of freed allocations
 };
 
 
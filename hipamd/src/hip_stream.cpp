@@ -27,6 +27,8 @@
 
 namespace hip {
 
+HandleTable<Stream> Stream::streamHandles_;
+
 // ================================================================================================
 Stream::Stream(hip::Device* dev, Priority p, unsigned int f, bool null_stream,
                const std::vector<uint32_t>& cuMask, hipStreamCaptureStatus captureStatus)
@@ -42,6 +44,7 @@ Stream::Stream(hip::Device* dev, Priority p, unsigned int f, bool null_stream,
       originStream_(false),
       captureID_(0) {
   device_->AddStream(this);
+  streamHandles_.Insert(this);
 }
 
 // ================================================================================================
@@ -73,6 +76,7 @@ bool Stream::Create() {
 
 // ================================================================================================
 void Stream::Destroy(hip::Stream* stream, bool forceDestroy) {
+  streamHandles_.Erase(stream);
   stream->device_->RemoveStream(stream);
   stream->SetForceDestroy(forceDestroy);
   stream->release();
@@ -95,13 +99,7 @@ bool isValid(hipStream_t& stream) {
     getStreamPerThread(stream);
   }
 
-  hip::Stream* s = reinterpret_cast<hip::Stream*>(stream);
-  for (auto& device : g_devices) {
-    if (device->StreamExists(s)) {
-      return true;
-    }
-  }
-  return false;
+  return Stream::StreamExists(reinterpret_cast<hip::Stream*>(stream));
 }
 
 // ================================================================================================
@@ -148,11 +146,7 @@ bool Stream::StreamCaptureOngoing(hipStream_t hStream) {
       return false;
     }
     // If any stream in current/concurrent thread is capturing in global mode
-    amd::ScopedLock lock(g_captureStreamsLock);
-    if (!g_captureStreams.empty()) {
-      for (auto stream : hip::g_captureStreams) {
-        stream->SetCaptureStatus(hipStreamCaptureStatusInvalidated);
-      }
+    if (InvalidateGlobalCaptureStreams()) {
       return true;
     }
     // If any stream in current thread is capturing in ThreadLocal mode
@@ -405,24 +399,12 @@ hipError_t hipStreamDestroy(hipStream_t stream) {
     if (s->GetParentStream() != nullptr) {
       reinterpret_cast<hip::Stream*>(s->GetParentStream())->EraseParallelCaptureStream(stream);
     }
+    // EndCapture() resets the capture graph, hence unregister the stream first
+    RemoveCapturingStream(s, s->GetCaptureGraph());
     auto error = s->EndCapture();
   }
   s->GetDevice()->RemoveStreamFromPools(s);
 
-  {
-    amd::ScopedLock lock(g_captureStreamsLock);
-    const auto& g_it = std::find(g_captureStreams.begin(), g_captureStreams.end(), s);
-    if (g_it != g_captureStreams.end()) {
-      g_captureStreams.erase(g_it);
-    }
-  }
-  {
-    amd::ScopedLock lock(g_streamSetLock);
-    const auto& g_it = std::find(g_allCapturingStreams.begin(), g_allCapturingStreams.end(), s);
-    if (g_it != g_allCapturingStreams.end()) {
-      g_allCapturingStreams.erase(g_it);
-    }
-  }
   const auto& l_it = std::find(hip::tls.capture_streams_.begin(),
                       hip::tls.capture_streams_.end(), s);
   if (l_it != hip::tls.capture_streams_.end()) {
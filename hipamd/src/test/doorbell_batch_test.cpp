@@ -0,0 +1,226 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "device/rocm/rocdoorbell.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Tests of the deferred AQL doorbell rings on a mock queue, doesn't require a device
+class DoorbellBatchTest : public host_test::Test {
+ public:
+  DoorbellBatchTest();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+};
+
+enum {
+  TestNoBatch = 0,
+  TestBatch,
+  TestNested,
+  TestQueueFull,
+  TestWait,
+  TestTotal
+};
+
+static const char* TestNames[TestTotal] = {"no batch", "batch window",
+                                           "nested windows", "full queue in window",
+                                           "wait in window"};
+
+// The mock queue never blocks the test for longer
+static const std::chrono::seconds Timeout(5);
+
+// Mock AQL queue. The emulated HW thread processes the packets up to the rung write index
+struct MockQueue {
+  static const uint64_t Size = 64;
+
+  MockQueue() : packets_(Size) {
+    for (auto& packet : packets_) {
+      packet.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<uint64_t> write_{0};     //!< Write index of the next packet
+  std::atomic<uint64_t> read_{0};      //!< Read index of the next packet for HW
+  std::atomic<uint64_t> doorbell_{0};  //!< The end of the rung packets
+  std::atomic<uint32_t> rings_{0};     //!< The number of the doorbell rings
+  std::atomic<uint32_t> invalid_{0};   //!< HW processed a packet without the header
+  std::atomic<bool> stop_{false};      //!< Stops the HW thread
+  std::vector<std::atomic<uint64_t>> packets_;  //!< The packet header holds the index + 1
+};
+
+// Stores the write index into the mock doorbell
+struct MockRing {
+  MockQueue* queue_;
+  void operator()(uint64_t index) const {
+    queue_->rings_++;
+    queue_->doorbell_.store(index + 1, std::memory_order_release);
+  }
+};
+
+typedef amd::roc::DoorbellBatch<MockRing> Batch;
+
+static void* hwThread(void* data) {
+  MockQueue* queue = static_cast<MockQueue*>(data);
+  while (!queue->stop_.load(std::memory_order_acquire)) {
+    uint64_t doorbell = queue->doorbell_.load(std::memory_order_acquire);
+    uint64_t read = queue->read_.load(std::memory_order_relaxed);
+    for (; read < doorbell; ++read) {
+      auto& packet = queue->packets_[read % MockQueue::Size];
+      if (packet.load(std::memory_order_acquire) != read + 1) {
+        queue->invalid_++;
+      }
+      packet.store(0, std::memory_order_relaxed);
+      queue->read_.store(read + 1, std::memory_order_release);
+    }
+  }
+  return NULL;
+}
+
+// Dispatches a packet in the same way as VirtualGPU::dispatchGenericAqlPacket()
+static bool dispatch(MockQueue* queue, Batch* batch) {
+  uint64_t index = queue->write_.fetch_add(1);
+  if ((index - queue->read_.load(std::memory_order_acquire)) >= MockQueue::Size) {
+    // HW can't free the slot without the deferred doorbell
+    batch->Flush();
+    auto start = std::chrono::steady_clock::now();
+    while ((index - queue->read_.load(std::memory_order_acquire)) >= MockQueue::Size) {
+      if ((std::chrono::steady_clock::now() - start) > Timeout) {
+        return false;
+      }
+    }
+  }
+  queue->packets_[index % MockQueue::Size].store(index + 1, std::memory_order_release);
+  batch->Ring(index);
+  return true;
+}
+
+// Waits for the packet completion in the same way as the runtime waits for a signal
+static bool wait(MockQueue* queue, Batch* batch, uint64_t index) {
+  batch->Flush();
+  auto start = std::chrono::steady_clock::now();
+  while (queue->read_.load(std::memory_order_acquire) <= index) {
+    if ((std::chrono::steady_clock::now() - start) > Timeout) {
+      return false;
+    }
+  }
+  return true;
+}
+
+DoorbellBatchTest::DoorbellBatchTest() { num_sub_tests_ = TestTotal; }
+
+void DoorbellBatchTest::open(unsigned int test) {
+  desc_ = TestNames[test];
+}
+
+void DoorbellBatchTest::run() {
+  MockQueue queue;
+  Batch batch(MockRing{&queue});
+  std::thread hw(hwThread, &queue);
+
+  const uint32_t NumPackets = 16;
+  bool done = true;
+  uint32_t rings = 0;
+  switch (test_) {
+    case TestNoBatch:
+      // Every packet rings the doorbell outside of a window
+      for (uint32_t i = 0; i < NumPackets; ++i) {
+        done = done && dispatch(&queue, &batch);
+      }
+      rings = queue.rings_;
+      done = done && wait(&queue, &batch, NumPackets - 1);
+      CHECK_RESULT_NO_RETURN(rings != NumPackets, "%u rings for %u packets", rings,
+                             NumPackets);
+      break;
+    case TestBatch:
+      batch.Begin();
+      for (uint32_t i = 0; i < NumPackets; ++i) {
+        done = done && dispatch(&queue, &batch);
+      }
+      rings = queue.rings_;
+      CHECK_RESULT_NO_RETURN(rings != 0, "The window rang the doorbell %u times", rings);
+      CHECK_RESULT_NO_RETURN(queue.read_ != 0, "HW processed the deferred packets");
+      batch.End();
+      rings = queue.rings_;
+      CHECK_RESULT_NO_RETURN(rings != 1, "%u rings for one window", rings);
+      CHECK_RESULT_NO_RETURN(batch.Active(), "The window is still open");
+      done = done && wait(&queue, &batch, NumPackets - 1);
+      break;
+    case TestNested:
+      batch.Begin();
+      done = done && dispatch(&queue, &batch);
+      batch.Begin();
+      for (uint32_t i = 1; i < NumPackets; ++i) {
+        done = done && dispatch(&queue, &batch);
+      }
+      batch.End();
+      rings = queue.rings_;
+      CHECK_RESULT_NO_RETURN(rings != 0, "The inner window rang the doorbell");
+      batch.End();
+      rings = queue.rings_;
+      CHECK_RESULT_NO_RETURN(rings != 1, "%u rings for the nested windows", rings);
+      done = done && wait(&queue, &batch, NumPackets - 1);
+      break;
+    case TestQueueFull: {
+      // The window can't wait for a free slot without the deferred ring
+      const uint32_t count = 4 * MockQueue::Size;
+      batch.Begin();
+      for (uint32_t i = 0; i < count; ++i) {
+        done = done && dispatch(&queue, &batch);
+      }
+      batch.End();
+      done = done && wait(&queue, &batch, count - 1);
+      rings = queue.rings_;
+      CHECK_RESULT_NO_RETURN(rings >= count, "%u rings for %u packets in one window", rings,
+                             count);
+      break;
+    }
+    case TestWait:
+      // A wait for a deferred packet rings the doorbell, the window doesn't ring it again
+      batch.Begin();
+      for (uint32_t i = 0; i < NumPackets; ++i) {
+        done = done && dispatch(&queue, &batch);
+      }
+      done = done && wait(&queue, &batch, NumPackets - 1);
+      batch.End();
+      rings = queue.rings_;
+      CHECK_RESULT_NO_RETURN(rings != 1, "%u rings for a wait in the window", rings);
+      break;
+  }
+  CHECK_RESULT_NO_RETURN(!done, "The queue didn't process the packets");
+  CHECK_RESULT_NO_RETURN(queue.invalid_ != 0, "HW processed %u packets without the header",
+                         static_cast<uint32_t>(queue.invalid_));
+
+  queue.stop_.store(true, std::memory_order_release);
+  hw.join();
+}
+
+}  // namespace
+
+HOST_TEST(DoorbellBatchTest);
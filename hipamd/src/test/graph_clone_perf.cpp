@@ -0,0 +1,255 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "hip_graph_arena.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Graph instantiation cost of the node clone and the topological sort with the per-graph
+//! node arena and the compressed sparse row adjacency against the per-node heap allocations
+//! and the hash maps. Runs on the host with stand-in nodes
+class GraphClonePerf : public host_test::Test {
+ public:
+  GraphClonePerf();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+
+  unsigned int numNodes_;
+  bool arena_;
+};
+
+// Stand-in for hip::GraphNode with a kernel node sized payload
+struct Node {
+  static void* operator new(size_t size) {
+    return hip::GraphNodeArena::AllocNode(size);
+  }
+  static void operator delete(void* ptr) { hip::GraphNodeArena::FreeNode(ptr); }
+
+  Node() : vertexIndex_(0) { memset(params_, 0, sizeof(params_)); }
+  Node(const Node& rhs) : vertexIndex_(rhs.vertexIndex_) {
+    memcpy(params_, rhs.params_, sizeof(params_));
+  }
+  virtual ~Node() {}
+  virtual Node* clone() const { return new Node(*this); }
+
+  std::vector<Node*> edges_;
+  std::vector<Node*> dependencies_;
+  unsigned int vertexIndex_;
+  char params_[256];
+};
+
+struct Graph {
+  ~Graph() {
+    for (size_t i = 0; i < vertices_.size(); ++i) {
+      delete vertices_[i];
+    }
+  }
+  std::vector<Node*> vertices_;
+  hip::GraphNodeArena arena_;
+};
+
+static const unsigned int NodeCounts[] = {1000, 10000};
+static const unsigned int NumNodeCounts =
+    sizeof(NodeCounts) / sizeof(NodeCounts[0]);
+// Every node depends on up to MaxDeps earlier nodes within a window
+static const unsigned int MaxDeps = 3;
+static const unsigned int DepWindow = 64;
+
+static void buildGraph(Graph* graph, unsigned int numNodes) {
+  unsigned int seed = 12345;
+  for (unsigned int i = 0; i < numNodes; ++i) {
+    Node* node = new Node();
+    node->vertexIndex_ = i;
+    graph->vertices_.push_back(node);
+    unsigned int numDeps = (i == 0) ? 0 : 1 + (seed >> 16) % MaxDeps;
+    for (unsigned int d = 0; d < numDeps; ++d) {
+      seed = seed * 1103515245 + 12345;
+      unsigned int window = (i < DepWindow) ? i : DepWindow;
+      Node* dep = graph->vertices_[i - 1 - (seed >> 16) % window];
+      bool duplicate = false;
+      for (size_t k = 0; k < node->dependencies_.size(); ++k) {
+        duplicate |= (node->dependencies_[k] == dep);
+      }
+      if (!duplicate) {
+        node->dependencies_.push_back(dep);
+        dep->edges_.push_back(node);
+      }
+    }
+  }
+}
+
+// The clone and the topological sort before the arena: every node is a separate heap
+// allocation, the edges are translated through a map and the sort uses hash maps
+static void cloneLegacy(const Graph& graph, Graph* newGraph,
+                        std::vector<Node*>* order) {
+  std::unordered_map<Node*, Node*> clonedNodes;
+  for (size_t i = 0; i < graph.vertices_.size(); ++i) {
+    Node* node = graph.vertices_[i]->clone();
+    newGraph->vertices_.push_back(node);
+    clonedNodes[graph.vertices_[i]] = node;
+  }
+  std::vector<Node*> cloned;
+  for (size_t i = 0; i < graph.vertices_.size(); ++i) {
+    Node* node = graph.vertices_[i];
+    cloned.clear();
+    for (size_t e = 0; e < node->edges_.size(); ++e) {
+      cloned.push_back(clonedNodes[node->edges_[e]]);
+    }
+    clonedNodes[node]->edges_ = cloned;
+    cloned.clear();
+    for (size_t d = 0; d < node->dependencies_.size(); ++d) {
+      cloned.push_back(clonedNodes[node->dependencies_[d]]);
+    }
+    clonedNodes[node]->dependencies_ = cloned;
+  }
+  std::queue<Node*> q;
+  std::unordered_map<Node*, int> inDegree;
+  for (size_t i = 0; i < newGraph->vertices_.size(); ++i) {
+    Node* node = newGraph->vertices_[i];
+    if (node->dependencies_.empty()) {
+      q.push(node);
+    }
+    inDegree[node] = static_cast<int>(node->dependencies_.size());
+  }
+  while (!q.empty()) {
+    Node* node = q.front();
+    order->push_back(node);
+    q.pop();
+    for (size_t e = 0; e < node->edges_.size(); ++e) {
+      if (--inDegree[node->edges_[e]] == 0) {
+        q.push(node->edges_[e]);
+      }
+    }
+  }
+}
+
+// The clone and the topological sort of Graph::clone and Graph::TopologicalOrder
+static void cloneArena(const Graph& graph, Graph* newGraph,
+                       std::vector<Node*>* order) {
+  const unsigned int numNodes = static_cast<unsigned int>(graph.vertices_.size());
+  newGraph->vertices_.reserve(numNodes);
+  {
+    hip::GraphNodeArena::Scope scope(&newGraph->arena_);
+    for (unsigned int i = 0; i < numNodes; ++i) {
+      newGraph->vertices_.push_back(graph.vertices_[i]->clone());
+    }
+  }
+  for (unsigned int i = 0; i < numNodes; ++i) {
+    const Node* node = graph.vertices_[i];
+    Node* clone = newGraph->vertices_[i];
+    clone->edges_.reserve(node->edges_.size());
+    for (size_t e = 0; e < node->edges_.size(); ++e) {
+      clone->edges_.push_back(newGraph->vertices_[node->edges_[e]->vertexIndex_]);
+    }
+    clone->dependencies_.reserve(node->dependencies_.size());
+    for (size_t d = 0; d < node->dependencies_.size(); ++d) {
+      clone->dependencies_.push_back(
+          newGraph->vertices_[node->dependencies_[d]->vertexIndex_]);
+    }
+  }
+  std::vector<unsigned int> edgeOffsets(numNodes + 1);
+  std::vector<unsigned int> edgeTargets;
+  for (unsigned int i = 0; i < numNodes; ++i) {
+    edgeOffsets[i] = static_cast<unsigned int>(edgeTargets.size());
+    const Node* node = newGraph->vertices_[i];
+    for (size_t e = 0; e < node->edges_.size(); ++e) {
+      edgeTargets.push_back(node->edges_[e]->vertexIndex_);
+    }
+  }
+  edgeOffsets[numNodes] = static_cast<unsigned int>(edgeTargets.size());
+  std::vector<unsigned int> sorted;
+  sorted.reserve(numNodes);
+  std::vector<unsigned int> inDegree(numNodes);
+  for (unsigned int i = 0; i < numNodes; ++i) {
+    inDegree[i] = static_cast<unsigned int>(
+        newGraph->vertices_[i]->dependencies_.size());
+    if (inDegree[i] == 0) {
+      sorted.push_back(i);
+    }
+  }
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    for (unsigned int e = edgeOffsets[sorted[i]]; e < edgeOffsets[sorted[i] + 1];
+         ++e) {
+      if (--inDegree[edgeTargets[e]] == 0) {
+        sorted.push_back(edgeTargets[e]);
+      }
+    }
+  }
+  order->reserve(sorted.size());
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    order->push_back(newGraph->vertices_[sorted[i]]);
+  }
+}
+
+GraphClonePerf::GraphClonePerf() { num_sub_tests_ = 2 * NumNodeCounts; }
+
+void GraphClonePerf::open(unsigned int test) {
+  numNodes_ = NodeCounts[test % NumNodeCounts];
+  arena_ = (test < NumNodeCounts);
+}
+
+void GraphClonePerf::run() {
+  Graph graph;
+  buildGraph(&graph, numNodes_);
+
+  // Instantiate about one million nodes in total
+  const unsigned int numIter = 1000000 / numNodes_;
+  host_test::Timer timer;
+  timer.Reset();
+  bool valid = true;
+  for (unsigned int iter = 0; iter < numIter; ++iter) {
+    std::vector<Node*> order;
+    timer.Start();
+    Graph* newGraph = new Graph();
+    if (arena_) {
+      cloneArena(graph, newGraph, &order);
+    } else {
+      cloneLegacy(graph, newGraph, &order);
+    }
+    delete newGraph;
+    timer.Stop();
+    valid &= (order.size() == numNodes_);
+  }
+  CHECK_RESULT(!valid, "The topological order doesn't contain all nodes");
+
+  double sec = timer.GetElapsedTime();
+  // Instantiated nodes in millions per second
+  double perf = ((double)numNodes_ * numIter * 1e-06) / sec;
+  perf_ = (float)perf;
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-16s nodes: %6d (Mnodes/s)",
+           arena_ ? "arena and CSR" : "heap and maps", numNodes_);
+  desc_ = buf;
+}
+
+}  // namespace
+
+HOST_TEST(GraphClonePerf);
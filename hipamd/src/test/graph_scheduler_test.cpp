@@ -0,0 +1,286 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "hip_graph_scheduler.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Validates the HIP graph list scheduler on synthetic DAGs, doesn't require a device
+class GraphSchedulerTest : public host_test::Test {
+ public:
+  GraphSchedulerTest();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+};
+
+typedef std::vector<std::vector<uint32_t>> DepList;
+
+enum {
+  TestChain = 0,
+  TestFanOut,
+  TestCriticalPath,
+  TestRandom,
+  TestCycle,
+  TestTotal
+};
+
+static const char* TestNames[TestTotal] = {"chain", "fan-out", "critical path",
+                                           "random DAGs", "cycle"};
+
+// Checks the invariants every schedule must satisfy. Returns nullptr on success
+static const char* validate(const std::vector<uint64_t>& cost,
+                            const DepList& deps, uint32_t maxStreams,
+                            const hip::GraphListScheduler::Result& result) {
+  const uint32_t numNodes = static_cast<uint32_t>(cost.size());
+  if ((result.num_streams_ == 0) || (result.num_streams_ > maxStreams)) {
+    return "invalid number of streams";
+  }
+  if (result.launch_order_.size() != numNodes) {
+    return "launch order doesn't cover all nodes";
+  }
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    if ((result.stream_id_[i] < 0) ||
+        (result.stream_id_[i] >= static_cast<int32_t>(result.num_streams_))) {
+      return "node isn't assigned to a valid stream";
+    }
+  }
+
+  // Launch order must be a topological order
+  std::vector<uint32_t> launchIndex(numNodes, numNodes);
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    uint32_t node = result.launch_order_[i];
+    if (launchIndex[node] != numNodes) {
+      return "node is launched twice";
+    }
+    launchIndex[node] = i;
+  }
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    for (auto dep : deps[i]) {
+      if (launchIndex[dep] >= launchIndex[i]) {
+        return "node is launched before its dependency";
+      }
+    }
+  }
+
+  // Waits must target cross-stream dependencies and match the signal flags
+  std::vector<bool> signal(numNodes, false);
+  uint32_t numWaits = 0;
+  for (uint32_t i = 0; i < numNodes; ++i) {
+    for (auto wait : result.waits_[i]) {
+      if (std::find(deps[i].begin(), deps[i].end(), wait) == deps[i].end()) {
+        return "wait target isn't a dependency";
+      }
+      if (result.stream_id_[wait] == result.stream_id_[i]) {
+        return "wait on the same stream";
+      }
+      signal[wait] = true;
+      numWaits++;
+    }
+  }
+  if ((signal != result.signal_is_required_) ||
+      (numWaits != result.num_waits_)) {
+    return "signal flags don't match the waits";
+  }
+
+  // Every dependency must complete before the node starts. A node observes
+  // the previous node on its stream and the nodes it waits for, transitively.
+  std::vector<std::vector<bool>> done(numNodes,
+                                      std::vector<bool>(numNodes, false));
+  std::vector<int32_t> lastOnStream(result.num_streams_, -1);
+  for (auto node : result.launch_order_) {
+    std::vector<bool>& known = done[node];
+    std::vector<uint32_t> preds = result.waits_[node];
+    if (lastOnStream[result.stream_id_[node]] >= 0) {
+      preds.push_back(lastOnStream[result.stream_id_[node]]);
+    }
+    for (auto pred : preds) {
+      known[pred] = true;
+      for (uint32_t j = 0; j < numNodes; ++j) {
+        if (done[pred][j]) {
+          known[j] = true;
+        }
+      }
+    }
+    for (auto dep : deps[node]) {
+      if (!known[dep]) {
+        return "dependency isn't covered by the stream order or a wait";
+      }
+    }
+    lastOnStream[result.stream_id_[node]] = node;
+  }
+
+  // The estimate can't beat the critical path
+  std::vector<uint64_t> path(numNodes, 0);
+  uint64_t critical = 0;
+  for (auto node : result.launch_order_) {
+    for (auto dep : deps[node]) {
+      path[node] = std::max(path[node], path[dep]);
+    }
+    path[node] += std::max<uint64_t>(cost[node], 1);
+    critical = std::max(critical, path[node]);
+  }
+  if (result.makespan_ < critical) {
+    return "makespan is below the critical path";
+  }
+  return nullptr;
+}
+
+GraphSchedulerTest::GraphSchedulerTest() { num_sub_tests_ = TestTotal; }
+
+void GraphSchedulerTest::open(unsigned int test) {
+  desc_ = TestNames[test];
+}
+
+void GraphSchedulerTest::run() {
+  hip::GraphListScheduler::Result result;
+  std::vector<uint64_t> cost;
+  DepList deps;
+  const char* error = nullptr;
+
+  switch (test_) {
+    case TestChain: {
+      // A chain must stay on one stream without any waits
+      cost = {10, 20, 30, 40};
+      deps = {{}, {0}, {1}, {2}};
+      CHECK_RESULT(!hip::GraphListScheduler::Schedule(cost, deps, 4, &result),
+                   "Schedule failed");
+      error = validate(cost, deps, 4, result);
+      CHECK_RESULT(error != nullptr, "%s", error);
+      CHECK_RESULT(result.num_streams_ != 1, "Chain uses %u streams",
+                   result.num_streams_);
+      CHECK_RESULT(result.num_waits_ != 0, "Chain has %u waits",
+                   result.num_waits_);
+      CHECK_RESULT(result.makespan_ != 100, "Unexpected makespan %llu",
+                   (unsigned long long)result.makespan_);
+      break;
+    }
+    case TestFanOut: {
+      // Root, 8 equal branches and a join on 4 streams
+      const uint32_t branches = 8;
+      cost.assign(branches + 2, 10);
+      deps.assign(branches + 2, {});
+      for (uint32_t i = 1; i <= branches; ++i) {
+        deps[i] = {0};
+        deps[branches + 1].push_back(i);
+      }
+      CHECK_RESULT(!hip::GraphListScheduler::Schedule(cost, deps, 4, &result),
+                   "Schedule failed");
+      error = validate(cost, deps, 4, result);
+      CHECK_RESULT(error != nullptr, "%s", error);
+      CHECK_RESULT(result.num_streams_ != 4, "Fan-out uses %u streams",
+                   result.num_streams_);
+      std::vector<uint32_t> perStream(result.num_streams_, 0);
+      for (uint32_t i = 1; i <= branches; ++i) {
+        perStream[result.stream_id_[i]]++;
+      }
+      for (auto count : perStream) {
+        CHECK_RESULT(count != branches / 4, "Branches aren't balanced");
+      }
+      // Root, two branches per stream and the join
+      CHECK_RESULT(result.makespan_ != 40, "Unexpected makespan %llu",
+                   (unsigned long long)result.makespan_);
+      break;
+    }
+    case TestCriticalPath: {
+      // A long chain (1-2-3) and four short branches (4-7) between a root and
+      // a join. The chain is scheduled first and keeps one stream for itself.
+      cost = {1, 100, 100, 100, 10, 10, 10, 10, 1};
+      deps = {{}, {0}, {1}, {2}, {0}, {0}, {0}, {0}, {3, 4, 5, 6, 7}};
+      CHECK_RESULT(!hip::GraphListScheduler::Schedule(cost, deps, 2, &result),
+                   "Schedule failed");
+      error = validate(cost, deps, 2, result);
+      CHECK_RESULT(error != nullptr, "%s", error);
+      CHECK_RESULT(result.launch_order_[1] != 1,
+                   "Critical path isn't launched first");
+      const int32_t chain = result.stream_id_[1];
+      CHECK_RESULT((result.stream_id_[2] != chain) ||
+                       (result.stream_id_[3] != chain),
+                   "Critical path is split across streams");
+      for (uint32_t i = 4; i <= 7; ++i) {
+        CHECK_RESULT(result.stream_id_[i] == chain,
+                     "Short branch is serialized with the critical path");
+      }
+      CHECK_RESULT(result.makespan_ != 302, "Unexpected makespan %llu",
+                   (unsigned long long)result.makespan_);
+      // The first short branch waits for the root and the join waits for the
+      // chain, the stream order covers the other dependencies
+      CHECK_RESULT(result.num_waits_ != 2, "Unexpected number of waits %u",
+                   result.num_waits_);
+      break;
+    }
+    case TestRandom: {
+      // Random layered DAGs with random costs on 1 to 8 streams
+      std::mt19937 random(1234);
+      auto genIntRand = [&random](uint32_t a, uint32_t b) {
+        return std::uniform_int_distribution<uint32_t>(a, b)(random);
+      };
+      for (uint32_t iter = 0; iter < 64; ++iter) {
+        const uint32_t numNodes = 16 + genIntRand(0, 240);
+        const uint32_t maxStreams = 1 + (iter % 8);
+        cost.resize(numNodes);
+        deps.assign(numNodes, {});
+        for (uint32_t i = 0; i < numNodes; ++i) {
+          cost[i] = genIntRand(0, 1000);
+          const uint32_t numDeps = (i == 0) ? 0 : genIntRand(0, 3);
+          for (uint32_t d = 0; d < numDeps; ++d) {
+            uint32_t dep = genIntRand(0, i - 1);
+            if (std::find(deps[i].begin(), deps[i].end(), dep) ==
+                deps[i].end()) {
+              deps[i].push_back(dep);
+            }
+          }
+        }
+        CHECK_RESULT(
+            !hip::GraphListScheduler::Schedule(cost, deps, maxStreams, &result),
+            "Schedule failed");
+        error = validate(cost, deps, maxStreams, result);
+        CHECK_RESULT(error != nullptr, "Iteration %u: %s", iter, error);
+        if (maxStreams == 1) {
+          CHECK_RESULT(result.num_waits_ != 0,
+                       "Single stream schedule has waits");
+        }
+      }
+      break;
+    }
+    case TestCycle: {
+      cost = {1, 1, 1};
+      deps = {{2}, {0}, {1}};
+      CHECK_RESULT(hip::GraphListScheduler::Schedule(cost, deps, 2, &result),
+                   "Cycle wasn't detected");
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+}  // namespace
+
+HOST_TEST(GraphSchedulerTest);
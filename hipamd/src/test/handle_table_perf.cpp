@@ -0,0 +1,182 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "hip_handle_table.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Multi-threaded handle validation throughput of the HIP handle table against
+//! the locked set, which it replaced. Runs on the host only
+class HandleTablePerf : public host_test::Test {
+ public:
+  HandleTablePerf();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+
+  unsigned int numThreads_;
+  bool locked_;
+};
+
+struct Object {
+  uint64_t payload_;
+};
+
+// Handles owned by one thread and the number of handles, which weren't found
+struct ThreadData {
+  std::vector<Object> objects_;
+  unsigned int missed_;
+};
+
+static const unsigned int ThreadCounts[] = {1, 2, 4, 8};
+static const unsigned int NumThreadCounts =
+    sizeof(ThreadCounts) / sizeof(ThreadCounts[0]);
+
+// Every thread creates and destroys objects, while it validates its live handles.
+// Graph construction validates the graph and the dependencies on every node creation
+static const unsigned int NumObjects = 4096;
+static const unsigned int NumLive = 64;
+static const unsigned int NumIterations = 200000;
+static const unsigned int ValidationsPerUpdate = 8;
+
+// The locked set is the validation before the handle table
+class LockedSet {
+ public:
+  void Insert(const Object* handle) {
+    std::lock_guard<std::mutex> lock(lock_);
+    set_.insert(handle);
+  }
+  void Erase(const Object* handle) {
+    std::lock_guard<std::mutex> lock(lock_);
+    set_.erase(handle);
+  }
+  bool Contains(const Object* handle) {
+    std::lock_guard<std::mutex> lock(lock_);
+    return set_.find(handle) != set_.end();
+  }
+
+ private:
+  std::mutex lock_;
+  std::unordered_set<const Object*> set_;
+};
+
+static hip::HandleTable<Object>* handleTable = NULL;
+static LockedSet* lockedSet = NULL;
+static std::atomic<bool> startFlag;
+
+template <typename Table>
+static void runWorkload(Table* table, ThreadData* data) {
+  std::vector<Object>& objects = data->objects_;
+  while (!startFlag.load(std::memory_order_acquire)) {
+  }
+  for (unsigned int i = 0; i < NumLive; ++i) {
+    table->Insert(&objects[i]);
+  }
+  // The live handles are a sliding window over the objects, so the erased handles
+  // fill the table and force rebuilds under the concurrent validation
+  for (unsigned int i = 0; i < NumIterations; ++i) {
+    const unsigned int first = i % NumObjects;
+    for (unsigned int j = 0; j < ValidationsPerUpdate; ++j) {
+      const unsigned int live = (first + (j * 7) % NumLive) % NumObjects;
+      if (!table->Contains(&objects[live])) {
+        data->missed_++;
+      }
+    }
+    table->Erase(&objects[first]);
+    table->Insert(&objects[(first + NumLive) % NumObjects]);
+  }
+  for (unsigned int i = 0; i < NumLive; ++i) {
+    table->Erase(&objects[(NumIterations + i) % NumObjects]);
+  }
+}
+
+static void* threadMain(void* data) {
+  ThreadData* threadData = static_cast<ThreadData*>(data);
+  if (handleTable != NULL) {
+    runWorkload(handleTable, threadData);
+  } else {
+    runWorkload(lockedSet, threadData);
+  }
+  return NULL;
+}
+
+HandleTablePerf::HandleTablePerf() {
+  num_sub_tests_ = 2 * NumThreadCounts;
+}
+
+void HandleTablePerf::open(unsigned int test) {
+  numThreads_ = ThreadCounts[test % NumThreadCounts];
+  locked_ = (test >= NumThreadCounts);
+}
+
+void HandleTablePerf::run() {
+  hip::HandleTable<Object> table;
+  LockedSet set;
+  handleTable = locked_ ? NULL : &table;
+  lockedSet = locked_ ? &set : NULL;
+  startFlag.store(false);
+
+  std::vector<ThreadData> data(numThreads_);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    data[i].objects_.resize(NumObjects);
+    data[i].missed_ = 0;
+    threads.emplace_back(threadMain, &data[i]);
+  }
+  host_test::Timer timer;
+  timer.Reset();
+  timer.Start();
+  startFlag.store(true, std::memory_order_release);
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    threads[i].join();
+  }
+  timer.Stop();
+  double sec = timer.GetElapsedTime();
+
+  unsigned int missed = 0;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    missed += data[i].missed_;
+  }
+  CHECK_RESULT(missed != 0, "%u live handles weren't found", missed);
+
+  // Validations, inserts and erases in millions per second
+  double perf = ((double)NumIterations * numThreads_ *
+                 (ValidationsPerUpdate + 2) * 1e-06) / sec;
+  perf_ = (float)perf;
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-11s threads: %2d (Mops/s)",
+           locked_ ? "locked set" : "table", numThreads_);
+  desc_ = buf;
+}
+
+}  // namespace
+
+HOST_TEST(HandleTablePerf);
@@ -0,0 +1,123 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace host_test {
+
+//! A host test of the device independent HIP and ROCclr components. A test has a number of
+//! subtests, which run on the host without a device, the stand-ins replace the runtime objects.
+class Test {
+ public:
+  virtual ~Test() {}
+
+  //! Returns the number of the subtests
+  unsigned int NumSubTests() const { return num_sub_tests_; }
+
+  //! Runs the subtest. Returns true if it passed
+  bool Execute(unsigned int test) {
+    test_ = test;
+    failed_ = false;
+    desc_.clear();
+    perf_ = 0.0f;
+    open(test);
+    if (!failed_) {
+      run();
+    }
+    return !failed_;
+  }
+
+  //! Returns the description of the last subtest
+  const std::string& Description() const { return desc_; }
+
+  //! Returns the performance of the last subtest in the units of its description
+  float Perf() const { return perf_; }
+
+ protected:
+  //! Prepares the subtest
+  virtual void open(unsigned int test) {}
+
+  //! Runs the subtest, the checks report the failures
+  virtual void run() = 0;
+
+  unsigned int num_sub_tests_ = 1;  //!< The number of the subtests
+  unsigned int test_ = 0;           //!< The current subtest
+  std::string desc_;                //!< Description of the current subtest
+  float perf_ = 0.0f;               //!< Performance of the current subtest
+  bool failed_ = false;             //!< The current subtest failed
+};
+
+//! Host timer for the benchmarks
+class Timer {
+ public:
+  void Reset() { elapsed_ = 0.0; }
+  void Start() { start_ = std::chrono::steady_clock::now(); }
+  void Stop() {
+    elapsed_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+  }
+  //! Returns the elapsed time in seconds
+  double GetElapsedTime() const { return elapsed_; }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+  double elapsed_ = 0.0;
+};
+
+//! A registered test with its factory
+struct Entry {
+  const char* name_;
+  Test* (*create_)();
+};
+
+//! Returns all tests, registered in the executable
+inline std::vector<Entry>& Registry() {
+  static std::vector<Entry> registry;
+  return registry;
+}
+
+template <typename T> struct Registrar {
+  explicit Registrar(const char* name) {
+    Registry().push_back({name, []() -> Test* { return new T(); }});
+  }
+};
+
+}  // namespace host_test
+
+//! Registers the test class in the executable
+#define HOST_TEST(Name) static host_test::Registrar<Name> Name##Registrar(#Name)
+
+//! Fails the subtest and returns from it if the condition is true
+#define CHECK_RESULT(test, msg, ...)                                          \
+  if ((test)) {                                                               \
+    failed_ = true;                                                           \
+    printf("%s:%d - " msg "\n", __FILE__, __LINE__, ##__VA_ARGS__);           \
+    return;                                                                   \
+  }
+
+//! Fails the subtest if the condition is true, but continues it for the cleanup
+#define CHECK_RESULT_NO_RETURN(test, msg, ...)                                \
+  if ((test)) {                                                               \
+    failed_ = true;                                                           \
+    printf("%s:%d - " msg "\n", __FILE__, __LINE__, ##__VA_ARGS__);           \
+  }
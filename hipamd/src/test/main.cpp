@@ -0,0 +1,60 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "host_test.hpp"
+
+// usage: <executable> [test name] [subtest]
+int main(int argc, char** argv) {
+  const char* name = (argc > 1) ? argv[1] : nullptr;
+  const int subtest = (argc > 2) ? atoi(argv[2]) : -1;
+  unsigned int failed = 0;
+  unsigned int found = 0;
+  for (const auto& entry : host_test::Registry()) {
+    if ((name != nullptr) && (strcmp(name, entry.name_) != 0)) {
+      continue;
+    }
+    found++;
+    std::unique_ptr<host_test::Test> test(entry.create_());
+    for (unsigned int i = 0; i < test->NumSubTests(); ++i) {
+      if ((subtest >= 0) && (static_cast<unsigned int>(subtest) != i)) {
+        continue;
+      }
+      const bool passed = test->Execute(i);
+      failed += passed ? 0 : 1;
+      if (test->Perf() != 0.0f) {
+        printf("%-20s %2u: %-60s %10.3f %s\n", entry.name_, i, test->Description().c_str(),
+               test->Perf(), passed ? "passed" : "FAILED");
+      } else {
+        printf("%-20s %2u: %-60s %s\n", entry.name_, i, test->Description().c_str(),
+               passed ? "passed" : "FAILED");
+      }
+    }
+  }
+  if (found == 0) {
+    printf("Test %s wasn't found\n", name);
+    return 1;
+  }
+  return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "hip_mempool_cache.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Allocates and frees on many threads through the per-stream caches of the HIP memory pool
+//! with host stand-in allocations, against the pool lock on every operation
+class MemPoolCachePerf : public host_test::Test {
+ public:
+  MemPoolCachePerf();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+
+  unsigned int numThreads_;
+  bool locked_;
+};
+
+// Stand-in for hip::Stream. The streams are cache line apart, so every thread gets own cache
+struct alignas(64) Stream {
+  unsigned int id_;
+};
+
+// Host stand-in of a pool allocation
+struct Block {
+  size_t getSize() const { return size_; }
+  size_t size_;
+  std::atomic<bool> busy_;  // The allocation was returned to the app
+};
+
+static const unsigned int ThreadCounts[] = {1, 2, 4, 8};
+static const unsigned int NumThreadCounts =
+    sizeof(ThreadCounts) / sizeof(ThreadCounts[0]);
+static const unsigned int NumAllocs = 500000;
+// The live allocations per thread, as the temporary tensors of a training step
+static const unsigned int NumLive = 4;
+static const size_t Shapes[] = {256, 4096, 65536, 1048576, 3 * 1048576};
+static const unsigned int NumShapes = sizeof(Shapes) / sizeof(Shapes[0]);
+
+// The shared part of the pool: the free heap under the pool lock
+class Pool {
+ public:
+  ~Pool() {
+    for (auto block : blocks_) {
+      delete block;
+    }
+  }
+
+  Block* Allocate(size_t size) {
+    const size_t maxSize = (size_t)((size / 8.0) * 9);
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = free_.lower_bound(size);
+    if ((it != free_.end()) && (it->first <= maxSize)) {
+      Block* block = it->second;
+      free_.erase(it);
+      return block;
+    }
+    Block* block = new Block;
+    block->size_ = size;
+    block->busy_ = false;
+    blocks_.push_back(block);
+    return block;
+  }
+
+  void Free(Block* block) {
+    std::lock_guard<std::mutex> lock(lock_);
+    Migrate(block);
+  }
+
+  // @note The caller must hold the pool lock
+  void Migrate(Block* block) { free_.insert({block->size_, block}); }
+
+  // The size of the allocations outside of the free heap, as the busy heap of the runtime
+  uint64_t BusySize() {
+    std::lock_guard<std::mutex> lock(lock_);
+    uint64_t size = 0;
+    for (auto block : blocks_) {
+      size += block->size_;
+    }
+    for (auto& it : free_) {
+      size -= it.first;
+    }
+    return size;
+  }
+
+  size_t NumFree() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return free_.size();
+  }
+  size_t NumBlocks() const { return blocks_.size(); }
+
+  std::mutex lock_;
+
+ private:
+  std::multimap<size_t, Block*> free_;
+  std::vector<Block*> blocks_;
+};
+
+// The pool with the lock-free per-stream caches of the freed allocations
+struct CachedPool {
+  Block* Allocate(size_t size, Stream* stream) {
+    const double maxSize = (size / 8.0) * 9;
+    Block* block = caches_.Allocate(size, maxSize, stream, [this](Block* block, Stream*) {
+      pool_.Free(block);
+    });
+    return (block != NULL) ? block : pool_.Allocate(size);
+  }
+
+  void Free(Block* block, Stream* stream) {
+    if (caches_.Claim(stream)) {
+      if (caches_.Insert(block, stream)) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(pool_.lock_);
+      caches_.Flush(stream, [this](Block* block, Stream*) { pool_.Migrate(block); });
+      if (caches_.Insert(block, stream)) {
+        return;
+      }
+      pool_.Migrate(block);
+      return;
+    }
+    pool_.Free(block);
+  }
+
+  Pool pool_;
+  hip::StreamCaches<Stream, Block> caches_;
+};
+
+// The pool, which takes the lock on every operation
+struct LockedPool {
+  Block* Allocate(size_t size, Stream*) { return pool_.Allocate(size); }
+  void Free(Block* block, Stream*) { pool_.Free(block); }
+
+  Pool pool_;
+};
+
+struct ThreadData {
+  Stream* stream_;
+  unsigned int failed_;
+};
+
+static CachedPool* cachedPool = NULL;
+static LockedPool* lockedPool = NULL;
+static std::atomic<bool> startFlag;
+
+// Every thread allocates and frees on its own stream, the oldest allocation is freed first
+template <typename PoolType>
+static void runAllocs(PoolType* pool, ThreadData* data) {
+  Stream* stream = data->stream_;
+  Block* live[NumLive] = {};
+  while (!startFlag.load(std::memory_order_acquire)) {
+  }
+  for (unsigned int i = 0; i < NumAllocs; ++i) {
+    unsigned int slot = i % NumLive;
+    if (live[slot] != NULL) {
+      live[slot]->busy_.store(false, std::memory_order_relaxed);
+      pool->Free(live[slot], stream);
+    }
+    size_t size = Shapes[(i * 7 + stream->id_) % NumShapes];
+    Block* block = pool->Allocate(size, stream);
+    // The pool must not give the same allocation to two threads or the wrong size
+    if (block->busy_.exchange(true, std::memory_order_relaxed) ||
+        (block->size_ < size) || (block->size_ > (size / 8.0) * 9)) {
+      data->failed_++;
+    }
+    live[slot] = block;
+  }
+  for (unsigned int slot = 0; slot < NumLive; ++slot) {
+    if (live[slot] != NULL) {
+      live[slot]->busy_.store(false, std::memory_order_relaxed);
+      pool->Free(live[slot], stream);
+    }
+  }
+}
+
+static void* threadMain(void* data) {
+  ThreadData* threadData = static_cast<ThreadData*>(data);
+  if (cachedPool != NULL) {
+    runAllocs(cachedPool, threadData);
+  } else {
+    runAllocs(lockedPool, threadData);
+  }
+  return NULL;
+}
+
+MemPoolCachePerf::MemPoolCachePerf() {
+  num_sub_tests_ = 2 * NumThreadCounts;
+}
+
+void MemPoolCachePerf::open(unsigned int test) {
+  numThreads_ = ThreadCounts[test % NumThreadCounts];
+  locked_ = (test >= NumThreadCounts);
+}
+
+void MemPoolCachePerf::run() {
+  CachedPool cached;
+  LockedPool locked;
+  cachedPool = locked_ ? NULL : &cached;
+  lockedPool = locked_ ? &locked : NULL;
+  startFlag.store(false);
+
+  std::vector<Stream> streams(numThreads_);
+  std::vector<ThreadData> data(numThreads_);
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    streams[i].id_ = i;
+    data[i].stream_ = &streams[i];
+    data[i].failed_ = 0;
+  }
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    threads.emplace_back(threadMain, &data[i]);
+  }
+  host_test::Timer timer;
+  timer.Reset();
+  timer.Start();
+  startFlag.store(true, std::memory_order_release);
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    threads[i].join();
+  }
+  timer.Stop();
+  double sec = timer.GetElapsedTime();
+
+  unsigned int failed = 0;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    failed += data[i].failed_;
+  }
+  CHECK_RESULT(failed != 0, "%u allocations were invalid", failed);
+
+  Pool& pool = locked_ ? locked.pool_ : cached.pool_;
+  if (!locked_) {
+    // All allocations were freed, hence the used memory must exclude the cached ones
+    uint64_t used = pool.BusySize() - cached.caches_.CachedSize();
+    CHECK_RESULT(used != 0, "Used memory is %llu bytes after all frees",
+                 (unsigned long long)used);
+    cached.caches_.FlushAll([&](Block* block, Stream*) { pool.Migrate(block); });
+    CHECK_RESULT(cached.caches_.CachedSize() != 0,
+                 "Cached size is %llu bytes after the flush",
+                 (unsigned long long)cached.caches_.CachedSize());
+  }
+  CHECK_RESULT(pool.NumFree() != pool.NumBlocks(),
+               "%zu of %zu allocations are in the free heap", pool.NumFree(),
+               pool.NumBlocks());
+
+  // Allocations in millions per second
+  perf_ = (float)(((double)NumAllocs * numThreads_ * 1e-06) / sec);
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-12s threads: %2d new: %5zu (Mallocs/s)",
+           locked_ ? "pool lock" : "stream cache", numThreads_,
+           pool.NumBlocks());
+  desc_ = buf;
+}
+
+}  // namespace
+
+HOST_TEST(MemPoolCachePerf);
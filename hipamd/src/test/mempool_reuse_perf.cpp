@@ -0,0 +1,271 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <math.h>
+#include <stdio.h>
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "hip_mempool_bins.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Replays allocation traces through the reuse search of the HIP memory pool heap with host
+//! stand-in allocations and HIP events
+class MemPoolReusePerf : public host_test::Test {
+ public:
+  MemPoolReusePerf();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+
+  unsigned int trace_;
+  bool sortedMap_;
+};
+
+// Trace operation. The free operation carries the GPU lag of the HIP event in trace steps
+struct Op {
+  bool alloc_;
+  unsigned int id_;
+  unsigned int stream_;
+  unsigned int lag_;
+  size_t size_;
+};
+
+struct TraceDesc {
+  const char* name_;
+  unsigned int numShapes_;    // The number of the distinct tensor shapes, 0 - random sizes
+  size_t minSize_;
+  size_t maxSize_;
+  unsigned int numStreams_;
+  unsigned int maxLag_;
+  unsigned int maxLive_;
+};
+
+static const TraceDesc Traces[] = {
+    // Training loop: the same tensors every iteration on a few streams
+    {"training", 48, 256, 16 * 1024 * 1024, 4, 32, 256},
+    // Many streams with the sizes in a few bins and the long GPU lag, so the bins are crowded
+    // with the allocations, which aren't safe for the current stream
+    {"crowded bins", 0, 4096, 8192, 16, 2048, 1024},
+};
+static const unsigned int NumTraces = sizeof(Traces) / sizeof(Traces[0]);
+static const unsigned int NumOps = 1000000;
+
+static void generateTrace(const TraceDesc& desc, std::vector<Op>* ops) {
+  std::mt19937 random(5678);
+  std::uniform_real_distribution<double> logSize(log((double)desc.minSize_),
+                                                 log((double)desc.maxSize_));
+  std::vector<size_t> shapes;
+  for (unsigned int i = 0; i < desc.numShapes_; ++i) {
+    shapes.push_back(((size_t)exp(logSize(random)) + 255) & ~size_t(255));
+  }
+  std::vector<Op> live;
+  unsigned int nextId = 0;
+  ops->clear();
+  while (ops->size() < NumOps) {
+    if (live.empty() || ((live.size() < desc.maxLive_) && (random() % 2 == 0))) {
+      Op op = {true, nextId++, (unsigned int)(random() % desc.numStreams_), 0, 0};
+      op.size_ = shapes.empty() ? (size_t)exp(logSize(random))
+                                : shapes[random() % shapes.size()];
+      live.push_back(op);
+      ops->push_back(op);
+    } else {
+      size_t index = random() % live.size();
+      Op op = live[index];
+      op.alloc_ = false;
+      op.lag_ = random() % (desc.maxLag_ + 1);
+      live[index] = live.back();
+      live.pop_back();
+      ops->push_back(op);
+    }
+  }
+}
+
+// Host stand-in of a pool allocation with its HIP event
+struct Block {
+  size_t size_;
+  unsigned int stream_;  // The stream of the free, the allocation is safe for it
+  size_t retire_;        // Trace step, when the HIP event completes
+  bool ready_;           // The event was observed as complete
+};
+
+// Replays a trace through the reuse search. The size class bins search is the heap logic,
+// the sorted map walk is the search before the bins
+class Replay {
+ public:
+  Replay(bool sortedMap, bool verify) : sortedMap_(sortedMap), verify_(verify) {}
+
+  void Run(const std::vector<Op>& ops) {
+    liveBlocks_.assign(ops.size(), 0);
+    for (now_ = 0; now_ < ops.size(); ++now_) {
+      const Op& op = ops[now_];
+      if (op.alloc_) {
+        liveBlocks_[op.id_] = Allocate(op.size_, op.stream_);
+      } else {
+        Free(liveBlocks_[op.id_], op.stream_, op.lag_);
+      }
+    }
+  }
+
+  unsigned int allocs_ = 0;   // The number of the allocations
+  unsigned int created_ = 0;  // The allocations, which weren't found in the pool
+  unsigned int missed_ = 0;   // The allocations, which weren't found, but the pool had one
+  size_t queries_ = 0;        // The number of the HIP event queries
+
+ private:
+  bool IsSafe(Block& block, unsigned int stream, bool query) {
+    if (block.ready_ || (block.stream_ == stream)) {
+      return true;
+    }
+    if (query) {
+      queries_++;
+      block.ready_ = (block.retire_ <= now_);
+    }
+    return block.ready_;
+  }
+
+  unsigned int Allocate(size_t size, unsigned int stream) {
+    allocs_++;
+    const size_t maxSize = (size_t)((size / 8.0) * 9);
+    unsigned int found = 0;
+    bool result = false;
+    if (sortedMap_) {
+      for (auto it = map_.lower_bound({size, 0});
+           (it != map_.end()) && (it->first.first <= maxSize); ++it) {
+        if (IsSafe(blocks_[it->second], stream, true)) {
+          found = it->second;
+          map_.erase(it);
+          result = true;
+          break;
+        }
+      }
+    } else {
+      // The same passes as Heap::FindMemory() with the opportunistic reuse
+      auto visit = [&](uint32_t pass, unsigned int index) {
+        Block& block = blocks_[index];
+        if (pass == 2) {
+          queries_++;
+          if (block.retire_ > now_) {
+            return false;
+          }
+          block.ready_ = true;
+          bins_.MarkReady(index);
+        }
+        if ((block.size_ < size) || (block.size_ > maxSize)) {
+          return false;
+        }
+        return (pass != 1) || (block.stream_ == stream);
+      };
+      result = bins_.Find(size, maxSize, 3, visit, &found);
+      if (result) {
+        bins_.Erase(found);
+      }
+    }
+    if (result) {
+      free_[found] = false;
+      return found;
+    }
+    if (verify_) {
+      // The search must not miss a free allocation, which fits and is safe
+      for (size_t i = 0; i < blocks_.size(); ++i) {
+        Block& block = blocks_[i];
+        if (free_[i] && (block.size_ >= size) && (block.size_ <= maxSize) &&
+            ((block.stream_ == stream) || (block.retire_ <= now_))) {
+          missed_++;
+          break;
+        }
+      }
+    }
+    created_++;
+    blocks_.push_back({size, stream, 0, false});
+    free_.push_back(false);
+    return (unsigned int)(blocks_.size() - 1);
+  }
+
+  void Free(unsigned int index, unsigned int stream, unsigned int lag) {
+    Block& block = blocks_[index];
+    block.stream_ = stream;
+    block.retire_ = now_ + lag;
+    block.ready_ = false;
+    free_[index] = true;
+    if (sortedMap_) {
+      map_.insert({{block.size_, index}, index});
+    } else {
+      bins_.Insert(index, block.size_, index, false);
+    }
+  }
+
+  bool sortedMap_;
+  bool verify_;
+  size_t now_ = 0;
+  std::vector<Block> blocks_;
+  std::vector<bool> free_;
+  std::vector<unsigned int> liveBlocks_;
+  std::map<std::pair<size_t, unsigned int>, unsigned int> map_;
+  hip::SizeClassBins<unsigned int, unsigned int> bins_;
+};
+
+MemPoolReusePerf::MemPoolReusePerf() { num_sub_tests_ = 2 * NumTraces; }
+
+void MemPoolReusePerf::open(unsigned int test) {
+  trace_ = test % NumTraces;
+  sortedMap_ = (test >= NumTraces);
+}
+
+void MemPoolReusePerf::run() {
+  std::vector<Op> ops;
+  generateTrace(Traces[trace_], &ops);
+
+  Replay replay(sortedMap_, false);
+  host_test::Timer timer;
+  timer.Reset();
+  timer.Start();
+  replay.Run(ops);
+  timer.Stop();
+  double sec = timer.GetElapsedTime();
+
+  if (!sortedMap_) {
+    // Validate the search on the same trace without the timing
+    Replay verify(false, true);
+    verify.Run(ops);
+    CHECK_RESULT(verify.missed_ != 0,
+                 "%u allocations weren't reused, but the pool had a safe one",
+                 verify.missed_);
+  }
+
+  // Allocations in millions per second
+  perf_ = (float)((replay.allocs_ * 1e-06) / sec);
+
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "%-11s %-12s new: %6u queries/alloc: %6.2f (Mallocs/s)",
+           sortedMap_ ? "sorted map" : "size bins", Traces[trace_].name_,
+           replay.created_, (double)replay.queries_ / replay.allocs_);
+  desc_ = buf;
+}
+
+}  // namespace
+
+HOST_TEST(MemPoolReusePerf);
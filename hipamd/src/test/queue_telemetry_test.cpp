@@ -0,0 +1,197 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "device/devqueuestats.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Tests of the AQL queue occupancy and stall telemetry, doesn't require a device
+class QueueTelemetryTest : public host_test::Test {
+ public:
+  QueueTelemetryTest();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+};
+
+enum {
+  TestBuckets = 0,
+  TestPackets,
+  TestStalls,
+  TestPeriodicLog,
+  TestThreads,
+  TestTotal
+};
+
+static const char* TestNames[TestTotal] = {"histogram buckets", "packets", "stalls",
+                                           "periodic log", "concurrent packets"};
+
+typedef amd::device::QueueStats Stats;
+typedef amd::device::QueueTelemetry Telemetry;
+
+static const uint32_t NumThreads = 4;
+static const uint32_t PacketsPerThread = 100000;
+
+// Every thread records the packets with own fill levels
+static void packetThread(Telemetry* telemetry, uint32_t id) {
+  for (uint32_t i = 0; i < PacketsPerThread; ++i) {
+    telemetry->Packet(id * PacketsPerThread + i, (i & 1) != 0);
+  }
+}
+
+static uint64_t histogramSum(const uint64_t* buckets) {
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < Stats::kHistogramBuckets; ++i) {
+    sum += buckets[i];
+  }
+  return sum;
+}
+
+QueueTelemetryTest::QueueTelemetryTest() { num_sub_tests_ = TestTotal; }
+
+void QueueTelemetryTest::open(unsigned int test) {
+  desc_ = TestNames[test];
+}
+
+void QueueTelemetryTest::run() {
+  Stats stats;
+  switch (test_) {
+    case TestBuckets: {
+      // The bucket N counts the values in [2^(N-1), 2^N) range
+      CHECK_RESULT(Telemetry::Bucket(0) != 0, "Zero isn't in the bucket 0");
+      CHECK_RESULT(Telemetry::Bucket(1) != 1, "One isn't in the bucket 1");
+      for (uint32_t bucket = 2; bucket < Stats::kHistogramBuckets; ++bucket) {
+        const uint64_t low = 1ULL << (bucket - 1);
+        CHECK_RESULT(Telemetry::Bucket(low) != bucket, "%llu isn't in the bucket %u",
+                     static_cast<unsigned long long>(low), bucket);
+        CHECK_RESULT(Telemetry::Bucket(low - 1) != bucket - 1,
+                     "%llu isn't in the bucket %u",
+                     static_cast<unsigned long long>(low - 1), bucket - 1);
+      }
+      // The last bucket counts all larger values
+      CHECK_RESULT(Telemetry::Bucket(~0ULL) != Stats::kHistogramBuckets - 1,
+                   "The largest value isn't in the last bucket");
+      break;
+    }
+    case TestPackets: {
+      Telemetry telemetry;
+      const uint64_t fillLevels[] = {0, 1, 3, 3, 64, 7};
+      for (uint64_t fill : fillLevels) {
+        telemetry.Packet(fill, fill == 3);
+      }
+      telemetry.Get(&stats);
+      CHECK_RESULT(stats.packets_ != 6, "Unexpected number of packets %llu",
+                   static_cast<unsigned long long>(stats.packets_));
+      CHECK_RESULT(stats.barrierPackets_ != 2, "Unexpected number of barriers %llu",
+                   static_cast<unsigned long long>(stats.barrierPackets_));
+      CHECK_RESULT(stats.maxFillLevel_ != 64, "Unexpected max fill level %llu",
+                   static_cast<unsigned long long>(stats.maxFillLevel_));
+      const uint64_t expected[Stats::kHistogramBuckets] = {1, 1, 2, 1, 0, 0, 0, 1};
+      for (uint32_t i = 0; i < Stats::kHistogramBuckets; ++i) {
+        CHECK_RESULT(stats.fillLevel_[i] != expected[i], "Bucket %u counts %llu packets", i,
+                     static_cast<unsigned long long>(stats.fillLevel_[i]));
+      }
+      CHECK_RESULT(stats.queueFullStalls_ != 0 || stats.signalWaits_ != 0,
+                   "The packets recorded a wait");
+      break;
+    }
+    case TestStalls: {
+      Telemetry telemetry;
+      telemetry.QueueFullStall(1500);     // 1us
+      telemetry.QueueFullStall(40000);    // 40us
+      telemetry.SignalWait(500);          // 0us
+      telemetry.SignalWait(3000000);      // 3000us
+      telemetry.SignalWait(2000);         // 2us
+      telemetry.KernargRecycle();
+      telemetry.Get(&stats);
+      CHECK_RESULT(stats.queueFullStalls_ != 2 || stats.queueFullNs_ != 41500,
+                   "Unexpected free slot waits %llu, %llu ns",
+                   static_cast<unsigned long long>(stats.queueFullStalls_),
+                   static_cast<unsigned long long>(stats.queueFullNs_));
+      CHECK_RESULT(stats.queueFullUs_[1] != 1 || stats.queueFullUs_[6] != 1,
+                   "The free slot waits are in the wrong buckets");
+      CHECK_RESULT(stats.signalWaits_ != 3 || stats.signalWaitNs_ != 3002500,
+                   "Unexpected signal waits %llu, %llu ns",
+                   static_cast<unsigned long long>(stats.signalWaits_),
+                   static_cast<unsigned long long>(stats.signalWaitNs_));
+      CHECK_RESULT(stats.signalWaitUs_[0] != 1 || stats.signalWaitUs_[2] != 1 ||
+                       stats.signalWaitUs_[12] != 1,
+                   "The signal waits are in the wrong buckets");
+      CHECK_RESULT(stats.kernargRecycles_ != 1, "Unexpected kernel arguments waits %llu",
+                   static_cast<unsigned long long>(stats.kernargRecycles_));
+      CHECK_RESULT(stats.packets_ != 0, "The waits recorded a packet");
+      break;
+    }
+    case TestPeriodicLog: {
+      // The periodic log is disabled with 0 interval
+      Telemetry disabled(0);
+      for (uint32_t i = 0; i < 4 * (Telemetry::kLogCheckMask + 1); ++i) {
+        CHECK_RESULT(disabled.Packet(i, false), "The disabled log is due");
+      }
+      // The time is checked once per a batch of packets only
+      Telemetry telemetry(1);
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      for (uint32_t i = 1; i < Telemetry::kLogCheckMask + 1; ++i) {
+        CHECK_RESULT(telemetry.Packet(i, false), "The log is due within a batch");
+      }
+      CHECK_RESULT(!telemetry.Packet(0, false), "The log isn't due after the interval");
+      // The log isn't due before the interval
+      Telemetry longInterval(1000000);
+      for (uint32_t i = 0; i < 4 * (Telemetry::kLogCheckMask + 1); ++i) {
+        CHECK_RESULT(longInterval.Packet(i, false), "The log is due before the interval");
+      }
+      break;
+    }
+    case TestThreads: {
+      // The relaxed counters don't lose the concurrent packets
+      Telemetry telemetry;
+      std::vector<std::thread> threads;
+      for (uint32_t i = 0; i < NumThreads; ++i) {
+        threads.emplace_back(packetThread, &telemetry, i);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      telemetry.Get(&stats);
+      const uint64_t total = static_cast<uint64_t>(NumThreads) * PacketsPerThread;
+      CHECK_RESULT(stats.packets_ != total, "%llu packets were recorded",
+                   static_cast<unsigned long long>(stats.packets_));
+      CHECK_RESULT(stats.barrierPackets_ != total / 2, "%llu barriers were recorded",
+                   static_cast<unsigned long long>(stats.barrierPackets_));
+      CHECK_RESULT(histogramSum(stats.fillLevel_) != total,
+                   "The fill level histogram lost packets");
+      CHECK_RESULT(stats.maxFillLevel_ != total - 1, "Unexpected max fill level %llu",
+                   static_cast<unsigned long long>(stats.maxFillLevel_));
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+HOST_TEST(QueueTelemetryTest);
@@ -0,0 +1,229 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "host_test.hpp"
+#include "utils/rangemap.hpp"
+
+namespace {
+
+//! Looks up the addresses of millions of memory object ranges on many threads through
+//! the lock-free radix map of MemObjMap, against the map under the shared lock
+class RangeMapPerf : public host_test::Test {
+ public:
+  RangeMapPerf();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+
+  unsigned int numThreads_;
+  bool locked_;
+};
+
+// Stand-in for amd::Memory. The range never changes, the writer removes and inserts it again
+struct Memory {
+  uintptr_t start_;
+  uintptr_t end_;
+};
+
+static const unsigned int ThreadCounts[] = {1, 2, 4, 8};
+static const unsigned int NumThreadCounts =
+    sizeof(ThreadCounts) / sizeof(ThreadCounts[0]);
+static const unsigned int NumRanges = 2000000;
+static const unsigned int LookupsPerThread = 1000000;
+
+// MemObjMap: the map is authoritative and the updates are serialized by the lock
+struct Objects {
+  explicit Objects(bool indexed) : indexed_(indexed) {}
+
+  void Add(Memory* memory) {
+    std::unique_lock<std::shared_mutex> lock(lock_);
+    map_.insert({memory->start_, memory});
+    if (indexed_) {
+      index_.insert(memory->start_, memory->end_, memory);
+    }
+  }
+
+  void Remove(Memory* memory) {
+    std::unique_lock<std::shared_mutex> lock(lock_);
+    map_.erase(memory->start_);
+    if (indexed_) {
+      index_.remove(memory->start_);
+    }
+  }
+
+  Memory* Find(uintptr_t address) {
+    Memory* memory = NULL;
+    uintptr_t start = 0;
+    if (indexed_ && index_.find(address, &memory, &start)) {
+      return memory;
+    }
+    std::shared_lock<std::shared_mutex> lock(lock_);
+    auto it = map_.upper_bound(address);
+    if (it == map_.begin()) {
+      return NULL;
+    }
+    --it;
+    return (address < it->second->end_) ? it->second : NULL;
+  }
+
+  bool indexed_;
+  std::shared_mutex lock_;
+  std::map<uintptr_t, Memory*> map_;
+  amd::ConcurrentRangeMap<Memory> index_;
+};
+
+struct ThreadData {
+  Objects* objects_;
+  std::vector<Memory>* ranges_;
+  unsigned int seed_;
+  unsigned int failed_;
+  size_t updates_;
+};
+
+static std::atomic<bool> startFlag;
+static std::atomic<unsigned int> numRunning;
+
+// Every lookup is an address inside a random range, as the kernel pointer arguments
+static void* readerMain(void* data) {
+  ThreadData* threadData = static_cast<ThreadData*>(data);
+  std::vector<Memory>& ranges = *threadData->ranges_;
+  std::mt19937 random(threadData->seed_);
+  while (!startFlag.load(std::memory_order_acquire)) {
+  }
+  for (unsigned int i = 0; i < LookupsPerThread; ++i) {
+    const Memory& range = ranges[random() % NumRanges];
+    const uintptr_t address = range.start_ + random() % (range.end_ - range.start_);
+    Memory* memory = threadData->objects_->Find(address);
+    // The writer can remove the range only for a moment, but never a wrong range is found
+    if ((memory != NULL) && (memory != &range)) {
+      threadData->failed_++;
+    }
+  }
+  numRunning.fetch_sub(1, std::memory_order_release);
+  return NULL;
+}
+
+// The allocations are freed and allocated again during the lookups
+static void* writerMain(void* data) {
+  ThreadData* threadData = static_cast<ThreadData*>(data);
+  std::vector<Memory>& ranges = *threadData->ranges_;
+  std::mt19937 random(threadData->seed_);
+  while (!startFlag.load(std::memory_order_acquire)) {
+  }
+  while (numRunning.load(std::memory_order_acquire) != 0) {
+    Memory* memory = &ranges[random() % NumRanges];
+    threadData->objects_->Remove(memory);
+    threadData->objects_->Add(memory);
+    threadData->updates_++;
+  }
+  return NULL;
+}
+
+RangeMapPerf::RangeMapPerf() { num_sub_tests_ = 2 * NumThreadCounts; }
+
+void RangeMapPerf::open(unsigned int test) {
+  numThreads_ = ThreadCounts[test % NumThreadCounts];
+  locked_ = (test >= NumThreadCounts);
+}
+
+void RangeMapPerf::run() {
+  // The sizes from the kernel arguments to the large buffers, the allocations are packed
+  // and share the pages as the suballocations of the memory pools
+  std::vector<Memory> ranges(NumRanges);
+  std::mt19937 random(4321);
+  uintptr_t address = 0x7f0000000000;
+  for (unsigned int i = 0; i < NumRanges; ++i) {
+    const unsigned int kind = random() % 16;
+    uintptr_t size = 256 + (random() % 4096);
+    if (kind == 0) {
+      size = (uintptr_t(1) << 20) + random() % (uintptr_t(1) << 24);
+    } else if (kind < 4) {
+      size = 4096 + random() % (uintptr_t(1) << 16);
+    }
+    ranges[i].start_ = address;
+    ranges[i].end_ = address + size;
+    address += (size + 255) & ~uintptr_t(255);
+  }
+  Objects objects(!locked_);
+  for (unsigned int i = 0; i < NumRanges; ++i) {
+    objects.Add(&ranges[i]);
+  }
+
+  std::vector<ThreadData> data(numThreads_ + 1);
+  for (unsigned int i = 0; i <= numThreads_; ++i) {
+    data[i].objects_ = &objects;
+    data[i].ranges_ = &ranges;
+    data[i].seed_ = 1000 + i;
+    data[i].failed_ = 0;
+    data[i].updates_ = 0;
+  }
+  startFlag.store(false);
+  numRunning.store(numThreads_);
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    threads.emplace_back(readerMain, &data[i]);
+  }
+  threads.emplace_back(writerMain, &data[numThreads_]);
+  host_test::Timer timer;
+  timer.Reset();
+  timer.Start();
+  startFlag.store(true, std::memory_order_release);
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    threads[i].join();
+  }
+  timer.Stop();
+  threads[numThreads_].join();
+  double sec = timer.GetElapsedTime();
+
+  unsigned int failed = 0;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    failed += data[i].failed_;
+  }
+  CHECK_RESULT(failed != 0, "%u lookups found a wrong range", failed);
+  // All ranges are live after the writer, hence every lookup must resolve
+  for (unsigned int i = 0; i < NumRanges; i += 97) {
+    CHECK_RESULT(objects.Find(ranges[i].end_ - 1) != &ranges[i],
+                 "Range %u wasn't found after the updates", i);
+  }
+
+  // Lookups in millions per second
+  perf_ = (float)(((double)LookupsPerThread * numThreads_ * 1e-06) / sec);
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-11s threads: %2d updates: %8zu (Mlookups/s)",
+           locked_ ? "shared lock" : "radix map", numThreads_,
+           data[numThreads_].updates_);
+  desc_ = buf;
+}
+
+}  // namespace
+
+HOST_TEST(RangeMapPerf);
@@ -0,0 +1,324 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "host_test.hpp"
+#include "utils/rangemap.hpp"
+
+namespace {
+
+//! Tests of the lock-free radix map of the memory object ranges, doesn't require a device
+class RangeMapTest : public host_test::Test {
+ public:
+  RangeMapTest();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+};
+
+enum {
+  TestDroppedRange = 0,
+  TestHiddenOverlap,
+  TestPageBucket,
+  TestLargeRanges,
+  TestLargeShadow,
+  TestStress,
+  TestOverlapStress,
+  TestTotal
+};
+
+static const char* TestNames[TestTotal] = {
+    "range behind unindexed one", "overlap behind unindexed one", "page bucket",
+    "large ranges",               "large unindexed range",        "random stress",
+    "overlap stress"};
+
+// The values are opaque for the map, the test uses the entries of a host array
+typedef amd::ConcurrentRangeMap<int> RangeMap;
+
+static const uintptr_t PageSize = 4096;
+static const uintptr_t Region = 0x7f0000000000;
+
+// Reference of the live ranges: start -> (end, value)
+typedef std::map<uintptr_t, std::pair<uintptr_t, int*>> Ranges;
+
+// Reference of the shadows of the unindexed ranges: start -> end
+typedef std::map<uintptr_t, uintptr_t> Shadows;
+
+// Resolves the address as the memory object map does: through the closest range before it
+static int* resolve(const Ranges& ranges, uintptr_t address, uintptr_t* start) {
+  auto it = ranges.upper_bound(address);
+  if (it == ranges.begin()) {
+    return NULL;
+  }
+  --it;
+  *start = it->first;
+  return (address < it->second.first) ? it->second.second : NULL;
+}
+
+// Returns true if a shadow covers the page of the address
+static bool shadowed(const Shadows& shadows, uintptr_t address) {
+  const uintptr_t page = address & ~(PageSize - 1);
+  for (auto it = shadows.begin(); (it != shadows.end()) && (it->first < page + PageSize); ++it) {
+    if (it->second > page) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool overlaps(const Ranges& ranges, uintptr_t start, uintptr_t end) {
+  auto next = ranges.lower_bound(start);
+  if ((next != ranges.end()) && (next->first < end)) {
+    return true;
+  }
+  return (next != ranges.begin()) && (std::prev(next)->second.first > start);
+}
+
+// The number of the ranges on the page, the map doesn't index the pages with over 16
+static size_t rangesOnPage(const Ranges& ranges, uintptr_t address) {
+  const uintptr_t page = address & ~(PageSize - 1);
+  size_t count = 0;
+  for (auto it = ranges.begin(); (it != ranges.end()) && (it->first < page + PageSize); ++it) {
+    if (it->second.first > page) {
+      count++;
+    }
+  }
+  return count;
+}
+
+RangeMapTest::RangeMapTest() { num_sub_tests_ = TestTotal; }
+
+void RangeMapTest::open(unsigned int test) {
+  desc_ = TestNames[test];
+}
+
+void RangeMapTest::run() {
+  RangeMap map;
+  std::vector<int> values(1024);
+  int* value = NULL;
+  uintptr_t start = 0;
+
+  switch (test_) {
+    case TestDroppedRange: {
+      // B overlaps A, hence it isn't indexed and hides A from the bucket of C's page
+      map.insert(0x1000, 0x10800, &values[0]);
+      map.insert(0x2000, 0x3000, &values[1]);
+      map.insert(0x10800, 0x10900, &values[2]);
+      CHECK_RESULT(map.find(0x10100, &value, &start),
+                   "Lookup succeeded with an unindexed range");
+      // Only the pages of B and the rest of A overflow
+      CHECK_RESULT(!map.find(0x1100, &value, &start) || (value != &values[0]),
+                   "A wasn't found before B");
+      CHECK_RESULT(!map.find(0x20000, &value, &start) || (value != NULL),
+                   "Lookup of an empty page failed with an unindexed range");
+      map.remove(0x2000);
+      CHECK_RESULT(!map.find(0x10100, &value, &start), "Lookup failed after the removal");
+      CHECK_RESULT((value != &values[0]) || (start != 0x1000),
+                   "Address of A was found in %p at 0x%zx", value, (size_t)start);
+      CHECK_RESULT(!map.find(0x10800, &value, &start) || (value != &values[2]),
+                   "C wasn't found");
+      CHECK_RESULT(!map.find(0x2000, &value, &start) || (value != &values[0]),
+                   "A wasn't found in the removed range");
+      // The page of C must be rebuilt with A after C is removed
+      map.remove(0x10800);
+      CHECK_RESULT(!map.find(0x10100, &value, &start) || (value != &values[0]),
+                   "A wasn't found after C removal");
+      CHECK_RESULT(!map.find(0x10800, &value, &start) || (value != NULL),
+                   "Removed C was found");
+      break;
+    }
+    case TestHiddenOverlap: {
+      // D overlaps A, but the previous range is unindexed B, which ends before D
+      map.insert(0x1000, 0x10800, &values[0]);
+      map.insert(0x2000, 0x3000, &values[1]);
+      map.insert(0x4000, 0x5000, &values[3]);
+      map.remove(0x2000);
+      CHECK_RESULT(map.find(0x4100, &value, &start),
+                   "Lookup succeeded with the overlapping range");
+      map.remove(0x4000);
+      CHECK_RESULT(!map.find(0x4100, &value, &start) || (value != &values[0]),
+                   "A wasn't found after the overlapping ranges were removed");
+      CHECK_RESULT(!map.find(0x10100, &value, &start) || (value != &values[0]),
+                   "A wasn't found on its last page");
+      break;
+    }
+    case TestPageBucket: {
+      // 16 ranges share a page bucket, the 17th overflows the page
+      for (uintptr_t i = 0; i < 16; ++i) {
+        map.insert(Region + i * 128, Region + i * 128 + 100, &values[i]);
+      }
+      for (uintptr_t i = 0; i < 16; ++i) {
+        CHECK_RESULT(!map.find(Region + i * 128 + 99, &value, &start) ||
+                         (value != &values[i]) || (start != Region + i * 128),
+                     "Range %zu wasn't found", (size_t)i);
+        CHECK_RESULT(!map.find(Region + i * 128 + 100, &value, &start) || (value != NULL),
+                     "Address after range %zu was found", (size_t)i);
+      }
+      map.insert(Region + 16 * 128, Region + 16 * 128 + 100, &values[16]);
+      CHECK_RESULT(map.find(Region, &value, &start), "The overflown page was indexed");
+      CHECK_RESULT(!map.find(Region + PageSize, &value, &start) || (value != NULL),
+                   "The next page isn't empty");
+      map.remove(Region);
+      CHECK_RESULT(!map.find(Region + 16 * 128, &value, &start) || (value != &values[16]),
+                   "The page wasn't rebuilt after the removal");
+      break;
+    }
+    case TestLargeRanges: {
+      // The ranges cover the slots of all levels and share the pages on their edges
+      const uintptr_t sizes[] = {PageSize, 2 * 1024 * 1024 + 100, 1024ull * 1024 * 1024 + 5000};
+      uintptr_t address = Region + 100;
+      for (int i = 0; i < 3; ++i) {
+        map.insert(address, address + sizes[i], &values[i]);
+        address += sizes[i];
+      }
+      address = Region + 100;
+      for (int i = 0; i < 3; ++i) {
+        const uintptr_t probes[] = {address, address + sizes[i] / 2, address + sizes[i] - 1};
+        for (uintptr_t probe : probes) {
+          CHECK_RESULT(!map.find(probe, &value, &start) || (value != &values[i]) ||
+                           (start != address),
+                       "Range %d wasn't found at 0x%zx", i, (size_t)probe);
+        }
+        address += sizes[i];
+      }
+      CHECK_RESULT(!map.find(address, &value, &start) || (value != NULL),
+                   "Address after the ranges was found");
+      map.remove(Region + 100 + sizes[0]);
+      CHECK_RESULT(!map.find(Region + 100 + sizes[0] + PageSize * 3, &value, &start) ||
+                       (value != NULL),
+                   "Removed range was found");
+      CHECK_RESULT(!map.find(Region + 100 + sizes[0] + sizes[1], &value, &start) ||
+                       (value != &values[2]),
+                   "The next range wasn't found after the removal");
+      break;
+    }
+    case TestLargeShadow: {
+      // B overlaps the end of A and C, its shadow overflows the slots of the upper levels
+      const uintptr_t GB = 1024ull * 1024 * 1024;
+      map.insert(Region, Region + GB + 100, &values[0]);
+      map.insert(Region + 2 * GB, Region + 3 * GB, &values[2]);
+      map.insert(Region + GB / 2, Region + 2 * GB + 100, &values[1]);
+      CHECK_RESULT(!map.find(Region + 100, &value, &start) || (value != &values[0]),
+                   "A wasn't found before B");
+      const uintptr_t hidden[] = {Region + GB / 2, Region + GB, Region + GB + 200,
+                                  Region + 2 * GB - 1};
+      for (uintptr_t address : hidden) {
+        CHECK_RESULT(map.find(address, &value, &start), "Lookup of 0x%zx succeeded in B",
+                     (size_t)address);
+      }
+      CHECK_RESULT(!map.find(Region + 2 * GB + PageSize, &value, &start) ||
+                       (value != &values[2]),
+                   "C wasn't found after B");
+      CHECK_RESULT(!map.find(Region + 4 * GB, &value, &start) || (value != NULL),
+                   "Lookup after the ranges failed");
+      map.remove(Region + GB / 2);
+      CHECK_RESULT(!map.find(Region + GB, &value, &start) || (value != &values[0]),
+                   "A wasn't found after B removal");
+      CHECK_RESULT(!map.find(Region + GB + 200, &value, &start) || (value != NULL),
+                   "The gap wasn't found after B removal");
+      CHECK_RESULT(!map.find(Region + 2 * GB, &value, &start) || (value != &values[2]),
+                   "C wasn't found after B removal");
+      break;
+    }
+    case TestStress:
+    case TestOverlapStress: {
+      const bool overlap = (test_ == TestOverlapStress);
+      std::mt19937_64 random(1234);
+      Ranges ranges;
+      Ranges indexed;
+      Shadows shadows;
+      unsigned int next = 0;
+      for (unsigned int i = 0; i < 100000; ++i) {
+        if (ranges.empty() || (ranges.size() < 256 && (random() % 2) == 0)) {
+          // The sizes from a few bytes to a few MB, as the kernel arguments and buffers
+          const uintptr_t size = uintptr_t(1) << (random() % 23);
+          uintptr_t begin = Region + (random() % (64 * 1024 * 1024)) + 1;
+          uintptr_t end = begin + size + random() % size;
+          if (!ranges.empty() && ((random() % 2) == 0)) {
+            auto it = ranges.begin();
+            std::advance(it, random() % ranges.size());
+            if (overlap && ((random() % 4) == 0)) {
+              // A nested range hides the indexed range from the page rebuilds
+              begin = it->first + (random() % (it->second.first - it->first));
+              end = begin + 1 + random() % (it->second.first - begin);
+            } else {
+              // The adjacent ranges share the page on their edge
+              begin = it->second.first;
+              end = begin + size + random() % size;
+            }
+          }
+          if ((ranges.count(begin) != 0) || (!overlap && overlaps(ranges, begin, end))) {
+            continue;
+          }
+          int* v = &values[next++ % values.size()];
+          map.insert(begin, end, v);
+          // The unindexed range shadows the rest of the indexed range, which covers its start
+          uintptr_t outer = 0;
+          if (resolve(indexed, begin, &outer) != NULL) {
+            shadows[begin] = std::max(end, indexed[outer].first);
+          } else if (overlaps(ranges, begin, end)) {
+            shadows[begin] = end;
+          } else {
+            indexed[begin] = {end, v};
+          }
+          ranges[begin] = {end, v};
+        } else {
+          auto it = ranges.begin();
+          std::advance(it, random() % ranges.size());
+          map.remove(it->first);
+          indexed.erase(it->first);
+          shadows.erase(it->first);
+          ranges.erase(it);
+        }
+        for (int probe = 0; probe < 4; ++probe) {
+          uintptr_t address = Region + (random() % (72 * 1024 * 1024));
+          if ((probe % 2) == 0 && !ranges.empty()) {
+            // Probe the edges of a live range
+            auto it = ranges.begin();
+            std::advance(it, random() % ranges.size());
+            address = (probe == 0) ? it->first : (it->second.first - 1);
+          }
+          if (!map.find(address, &value, &start)) {
+            // Only the overflown pages and the shadows of the unindexed ranges aren't indexed
+            CHECK_RESULT((rangesOnPage(ranges, address) <= 16) && !shadowed(shadows, address),
+                         "Lookup of 0x%zx failed in step %u", (size_t)address, i);
+            continue;
+          }
+          uintptr_t expectedStart = 0;
+          int* expected = resolve(ranges, address, &expectedStart);
+          CHECK_RESULT((value != expected) || ((value != NULL) && (start != expectedStart)),
+                       "Lookup of 0x%zx found a wrong range in step %u", (size_t)address, i);
+        }
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+HOST_TEST(RangeMapTest);
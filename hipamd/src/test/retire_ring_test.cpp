@@ -0,0 +1,284 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "device/rocm/rocring.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Tests of the retire point ring allocator with fake signals, doesn't require a device
+class RetireRingTest : public host_test::Test {
+ public:
+  RetireRingTest();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+};
+
+enum {
+  TestAcquire = 0,
+  TestDispatchRetire,
+  TestWaitOldest,
+  TestBarrier,
+  TestRecycle,
+  TestStaging,
+  TestStress,
+  TestTotal
+};
+
+static const char* TestNames[TestTotal] = {
+    "aligned acquire",      "dispatch retire points", "wait for oldest point",
+    "barrier for uncovered", "recycle completed",     "staging barriers",
+    "random stress"};
+
+static const uintptr_t RingBase = 0x10000;
+static const uint32_t RingSize = 4096;
+static const uint32_t NumRetirePoints = 16;
+
+// Fake signals of an in-order queue. A signal covers all allocations, made before it was
+// armed, and the queue completes the signals in the arm order
+class FakeSource : public amd::roc::RetireSource {
+ public:
+  explicit FakeSource(uint32_t numSignals)
+      : values_(numSignals + 1, 0), covers_(numSignals + 1, 0) {}
+
+  std::vector<uint64_t> Signals() const {
+    std::vector<uint64_t> signals;
+    for (uint64_t i = 1; i < values_.size(); ++i) {
+      signals.push_back(i);
+    }
+    return signals;
+  }
+
+  bool IsDone(uint64_t signal) override { return values_[signal] == 0; }
+
+  void Arm(uint64_t signal) override {
+    values_[signal] = 1;
+    covers_[signal] = allocs_;
+    pending_.push_back(signal);
+  }
+
+  bool Wait(uint64_t signal) override {
+    waits_++;
+    while ((values_[signal] != 0) && !pending_.empty()) {
+      CompleteOldest();
+    }
+    return values_[signal] == 0;
+  }
+
+  void Barrier(uint64_t signal) override { barriers_++; }
+
+  void RecycleWait(uint64_t required_tail) override { recycles_++; }
+
+  //! Completes the oldest outstanding signal
+  void CompleteOldest() {
+    if (pending_.empty()) {
+      return;
+    }
+    uint64_t signal = pending_.front();
+    pending_.pop_front();
+    values_[signal] = 0;
+    freed_ = std::max(freed_, covers_[signal]);
+  }
+
+  //! Completes all outstanding signals
+  void CompleteAll() {
+    while (!pending_.empty()) {
+      CompleteOldest();
+    }
+  }
+
+  uint32_t waits_ = 0;     //!< The number of the waits for a signal
+  uint32_t barriers_ = 0;  //!< The number of the issued barriers
+  uint32_t recycles_ = 0;  //!< The number of the waits for the ring space
+  size_t allocs_ = 0;      //!< The number of the allocations
+  size_t freed_ = 0;       //!< The allocations before this index are free
+
+ private:
+  std::vector<uint32_t> values_;   //!< Signal values
+  std::vector<size_t> covers_;     //!< The allocations, covered by the signal
+  std::deque<uint64_t> pending_;   //!< Outstanding signals in the arm order
+};
+
+struct Region {
+  uintptr_t start_;
+  uintptr_t end_;
+};
+
+// Acquires a region and validates it against the regions, which aren't free yet
+static bool acquire(amd::roc::RetireRing* ring, FakeSource* source,
+                    std::vector<Region>* regions, uint32_t size, uint32_t alignment,
+                    bool dispatch) {
+  uintptr_t start = ring->Acquire(size, alignment);
+  Region region = {start, start + size};
+  if (((start % alignment) != 0) || (start < RingBase) ||
+      (region.end_ > (RingBase + RingSize))) {
+    return false;
+  }
+  for (size_t i = source->freed_; i < regions->size(); ++i) {
+    if ((region.start_ < (*regions)[i].end_) && ((*regions)[i].start_ < region.end_)) {
+      return false;
+    }
+  }
+  regions->push_back(region);
+  source->allocs_++;
+  // The dispatch, which uses the region, may carry a retire point
+  if (dispatch) {
+    ring->DispatchRetireSignal();
+  }
+  return true;
+}
+
+RetireRingTest::RetireRingTest() { num_sub_tests_ = TestTotal; }
+
+void RetireRingTest::open(unsigned int test) {
+  desc_ = TestNames[test];
+}
+
+void RetireRingTest::run() {
+  const bool dispatchRetire = (test_ != TestStaging);
+  const uint32_t numRetirePoints = dispatchRetire ? NumRetirePoints : 4;
+  FakeSource source(numRetirePoints);
+  amd::roc::RetireRing ring(source, RingSize, numRetirePoints, dispatchRetire);
+  ring.Init(RingBase, source.Signals());
+  std::vector<Region> regions;
+  const uint32_t granule = RingSize / numRetirePoints;
+
+  switch (test_) {
+    case TestAcquire: {
+      // The regions follow each other with the alignment and never cross the ring end
+      for (uint32_t i = 0; i < 200; ++i) {
+        CHECK_RESULT(!acquire(&ring, &source, &regions, 100, 64, false),
+                     "Region %u is invalid", i);
+        source.CompleteAll();
+      }
+      for (size_t i = 1; i < regions.size(); ++i) {
+        uintptr_t expected = (regions[i - 1].end_ + 63) & ~uintptr_t(63);
+        if ((expected + 100) > (RingBase + RingSize)) {
+          expected = RingBase;
+        }
+        CHECK_RESULT(regions[i].start_ != expected, "Region %zu starts at 0x%zx instead of 0x%zx",
+                     i, static_cast<size_t>(regions[i].start_), static_cast<size_t>(expected));
+      }
+      break;
+    }
+    case TestDispatchRetire: {
+      // A retire point is requested once per granule of the ring usage
+      uint32_t points = 0;
+      for (uint32_t i = 0; i < 4 * NumRetirePoints; ++i) {
+        CHECK_RESULT(!acquire(&ring, &source, &regions, 64, 64, false), "Region %u is invalid",
+                     i);
+        if (ring.DispatchRetireSignal() != 0) {
+          points++;
+        }
+        source.CompleteAll();
+      }
+      CHECK_RESULT(points != NumRetirePoints, "%u retire points instead of %u", points,
+                   NumRetirePoints);
+      CHECK_RESULT(source.barriers_ != 0, "%u barriers with the dispatch retire points",
+                   source.barriers_);
+      break;
+    }
+    case TestWaitOldest: {
+      // A full ring waits only for the oldest retire point, which covers the new region
+      for (uint32_t i = 0; i < RingSize / granule; ++i) {
+        CHECK_RESULT(!acquire(&ring, &source, &regions, granule, 64, true),
+                     "Region %u is invalid", i);
+      }
+      CHECK_RESULT(source.waits_ != 0, "The ring waited before it was full");
+      CHECK_RESULT(!acquire(&ring, &source, &regions, granule, 64, true),
+                   "Region after the wait is invalid");
+      CHECK_RESULT(source.waits_ != 1, "%u waits instead of one", source.waits_);
+      CHECK_RESULT(source.barriers_ != 0, "%u barriers for the covered region",
+                   source.barriers_);
+      CHECK_RESULT(source.recycles_ != 1, "%u recycles instead of one", source.recycles_);
+      break;
+    }
+    case TestBarrier: {
+      // The dispatches don't carry the retire points, hence the ring issues a barrier
+      for (uint32_t i = 0; i < RingSize / granule; ++i) {
+        CHECK_RESULT(!acquire(&ring, &source, &regions, granule, 64, false),
+                     "Region %u is invalid", i);
+      }
+      CHECK_RESULT(!acquire(&ring, &source, &regions, granule, 64, false),
+                   "Region after the barrier is invalid");
+      CHECK_RESULT(source.barriers_ != 1, "%u barriers instead of one", source.barriers_);
+      CHECK_RESULT(source.waits_ != 1, "%u waits instead of one", source.waits_);
+      break;
+    }
+    case TestRecycle: {
+      // The completed retire points release the ring without a wait
+      for (uint32_t i = 0; i < 4 * (RingSize / granule); ++i) {
+        CHECK_RESULT(!acquire(&ring, &source, &regions, granule, 64, true),
+                     "Region %u is invalid", i);
+        source.CompleteAll();
+      }
+      CHECK_RESULT(source.waits_ != 0, "%u waits for the completed points", source.waits_);
+      CHECK_RESULT(source.recycles_ != 0, "%u recycles for the completed points",
+                   source.recycles_);
+      break;
+    }
+    case TestStaging: {
+      // The staging ring issues a barrier retire point for every granule
+      const uint32_t count = 4 * (RingSize / 256);
+      for (uint32_t i = 0; i < count; ++i) {
+        CHECK_RESULT(!acquire(&ring, &source, &regions, 256, 256, false),
+                     "Region %u is invalid", i);
+      }
+      const uint32_t expected = (count * 256) / granule - 1;
+      CHECK_RESULT(source.barriers_ != expected, "%u barriers instead of %u", source.barriers_,
+                   expected);
+      break;
+    }
+    case TestStress: {
+      std::mt19937 random(1234);
+      for (uint32_t mode = 0; mode < 2; ++mode) {
+        const bool retire = (mode == 0);
+        FakeSource stress(NumRetirePoints);
+        amd::roc::RetireRing stressRing(stress, RingSize, NumRetirePoints, retire);
+        stressRing.Init(RingBase, stress.Signals());
+        regions.clear();
+        for (uint32_t i = 0; i < 100000; ++i) {
+          const uint32_t size = 1 + random() % 1024;
+          const uint32_t alignment = 16u << (random() % 5);
+          // The dependency tracking may drop the barrier bit of some dispatches
+          const bool dispatch = retire && ((random() % 4) != 0);
+          CHECK_RESULT(!acquire(&stressRing, &stress, &regions, size, alignment, dispatch),
+                       "Region %u overlaps a busy region (mode %u)", i, mode);
+          if ((random() % 8) == 0) {
+            stress.CompleteOldest();
+          }
+        }
+      }
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+HOST_TEST(RetireRingTest);
@@ -0,0 +1,206 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "hip_capture_streams.hpp"
+#include "hip_handle_table.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Multi-threaded stream capture throughput of the HIP capture bookkeeping with stand-in
+//! streams, which record the captured calls on the host instead of a device
+class StreamCapturePerf : public host_test::Test {
+ public:
+  StreamCapturePerf();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+
+  unsigned int numThreads_;
+  bool locked_;
+};
+
+// Stand-in for hip::Stream. The captured calls are recorded as nodes of the capture graph
+struct Stream {
+  bool invalidated_;
+  std::vector<unsigned int> nodes_;
+};
+
+static const unsigned int ThreadCounts[] = {1, 2, 4, 8};
+static const unsigned int NumThreadCounts =
+    sizeof(ThreadCounts) / sizeof(ThreadCounts[0]);
+static const unsigned int NumCaptures = 2000;
+static const unsigned int CallsPerCapture = 100;
+
+// Capture bookkeeping of the runtime: lock-free stream validation and the capture checks,
+// which don't take the global locks for the thread local captures
+struct LockFreeCapture {
+  bool IsValid(Stream* stream) { return handles_.Contains(stream); }
+  bool InvalidateGlobal() {
+    return streams_.ForEachGlobal([](Stream* stream) { stream->invalidated_ = true; });
+  }
+  void Begin(Stream* stream) { streams_.Add(stream, false); }
+  void End(Stream* stream) { streams_.Remove(stream); }
+
+  hip::HandleTable<Stream> handles_;
+  hip::CaptureStreams<Stream, std::mutex> streams_;
+};
+
+// Bookkeeping before the lock-free capture: the stream validation and every capture check
+// serialize on the process wide locks
+struct LockedCapture {
+  bool IsValid(Stream* stream) {
+    std::lock_guard<std::mutex> lock(handlesLock_);
+    return handles_.find(stream) != handles_.end();
+  }
+  bool InvalidateGlobal() {
+    std::lock_guard<std::mutex> lock(streamsLock_);
+    for (size_t i = 0; i < global_.size(); ++i) {
+      global_[i]->invalidated_ = true;
+    }
+    return !global_.empty();
+  }
+  void Begin(Stream* stream) {
+    std::lock_guard<std::mutex> lock(streamsLock_);
+    streams_.insert(stream);
+  }
+  void End(Stream* stream) {
+    std::lock_guard<std::mutex> lock(streamsLock_);
+    streams_.erase(stream);
+  }
+
+  std::mutex handlesLock_;
+  std::unordered_set<Stream*> handles_;
+  std::mutex streamsLock_;
+  std::vector<Stream*> global_;
+  std::unordered_set<Stream*> streams_;
+};
+
+struct ThreadData {
+  Stream stream_;
+  unsigned int failed_;
+};
+
+static LockFreeCapture* lockFreeCapture = NULL;
+static LockedCapture* lockedCapture = NULL;
+static std::atomic<bool> startFlag;
+
+// Every thread captures its own stream in the thread local mode, as the applications,
+// which build a graph per thread
+template <typename Capture>
+static void runCaptures(Capture* capture, ThreadData* data) {
+  Stream* stream = &data->stream_;
+  while (!startFlag.load(std::memory_order_acquire)) {
+  }
+  for (unsigned int c = 0; c < NumCaptures; ++c) {
+    capture->Begin(stream);
+    stream->nodes_.clear();
+    for (unsigned int i = 0; i < CallsPerCapture; ++i) {
+      // The checks of a captured launch: the stream handle and the global mode captures
+      if (!capture->IsValid(stream) || capture->InvalidateGlobal()) {
+        data->failed_++;
+        continue;
+      }
+      stream->nodes_.push_back(i);
+    }
+    capture->End(stream);
+    if (stream->invalidated_ || (stream->nodes_.size() != CallsPerCapture)) {
+      data->failed_++;
+    }
+  }
+}
+
+static void* threadMain(void* data) {
+  ThreadData* threadData = static_cast<ThreadData*>(data);
+  if (lockFreeCapture != NULL) {
+    runCaptures(lockFreeCapture, threadData);
+  } else {
+    runCaptures(lockedCapture, threadData);
+  }
+  return NULL;
+}
+
+StreamCapturePerf::StreamCapturePerf() {
+  num_sub_tests_ = 2 * NumThreadCounts;
+}
+
+void StreamCapturePerf::open(unsigned int test) {
+  numThreads_ = ThreadCounts[test % NumThreadCounts];
+  locked_ = (test >= NumThreadCounts);
+}
+
+void StreamCapturePerf::run() {
+  LockFreeCapture lockFree;
+  LockedCapture locked;
+  lockFreeCapture = locked_ ? NULL : &lockFree;
+  lockedCapture = locked_ ? &locked : NULL;
+  startFlag.store(false);
+
+  std::vector<ThreadData> data(numThreads_);
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    data[i].stream_.invalidated_ = false;
+    data[i].stream_.nodes_.reserve(CallsPerCapture);
+    data[i].failed_ = 0;
+    lockFree.handles_.Insert(&data[i].stream_);
+    locked.handles_.insert(&data[i].stream_);
+  }
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    threads.emplace_back(threadMain, &data[i]);
+  }
+  host_test::Timer timer;
+  timer.Reset();
+  timer.Start();
+  startFlag.store(true, std::memory_order_release);
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    threads[i].join();
+  }
+  timer.Stop();
+  double sec = timer.GetElapsedTime();
+
+  unsigned int failed = 0;
+  for (unsigned int i = 0; i < numThreads_; ++i) {
+    failed += data[i].failed_;
+  }
+  CHECK_RESULT(failed != 0, "%u captured calls failed", failed);
+
+  // Captured calls in millions per second
+  double perf =
+      ((double)NumCaptures * CallsPerCapture * numThreads_ * 1e-06) / sec;
+  perf_ = (float)perf;
+
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%-12s threads: %2d (Mcalls/s)",
+           locked_ ? "global locks" : "lock-free", numThreads_);
+  desc_ = buf;
+}
+
+}  // namespace
+
+HOST_TEST(StreamCapturePerf);
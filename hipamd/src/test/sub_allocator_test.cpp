@@ -0,0 +1,221 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#include <stdio.h>
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "hip_mempool_buddy.hpp"
+#include "host_test.hpp"
+
+namespace {
+
+//! Tests of the buddy blocks of the HIP memory pool suballocator, doesn't require a device
+class SubAllocatorTest : public host_test::Test {
+ public:
+  SubAllocatorTest();
+
+ protected:
+  void open(unsigned int test) override;
+  void run() override;
+};
+
+enum {
+  TestOrders = 0,
+  TestSplit,
+  TestMerge,
+  TestChunkReturn,
+  TestStress,
+  TestTotal
+};
+
+static const char* TestNames[TestTotal] = {"block orders", "split", "buddy merge",
+                                           "whole chunk return", "random stress"};
+
+// The chunks are opaque handles for the buddy lists
+typedef hip::BuddyBlocks<unsigned int> Blocks;
+
+static const size_t ChunkSize = 64 * 1024;
+static const uint32_t ChunkOrder = 8;  // 64KB chunk of 256 byte blocks
+
+SubAllocatorTest::SubAllocatorTest() { num_sub_tests_ = TestTotal; }
+
+void SubAllocatorTest::open(unsigned int test) {
+  desc_ = TestNames[test];
+}
+
+void SubAllocatorTest::run() {
+  Blocks blocks;
+  unsigned int chunk = 0;
+  size_t offset = 0;
+
+  switch (test_) {
+    case TestOrders: {
+      CHECK_RESULT(blocks.Init(1024), "Chunk smaller than 8 blocks was accepted");
+      CHECK_RESULT(!blocks.Init(ChunkSize - 1000), "Valid chunk size was rejected");
+      CHECK_RESULT(blocks.ChunkSize() != ChunkSize, "Chunk size %zu isn't rounded up",
+                   blocks.ChunkSize());
+      CHECK_RESULT(blocks.IsSmall(0), "Empty allocation is small");
+      CHECK_RESULT(!blocks.IsSmall(ChunkSize / 8), "The largest block isn't small");
+      CHECK_RESULT(blocks.IsSmall(ChunkSize / 8 + 1), "Block above 1/8 of the chunk is small");
+      CHECK_RESULT((Blocks::Order(1) != 0) || (Blocks::Order(256) != 0) ||
+                       (Blocks::Order(257) != 1) || (Blocks::Order(512) != 1) ||
+                       (Blocks::Order(4096) != 4) || (Blocks::Order(4097) != 5),
+                   "Wrong block orders");
+      break;
+    }
+    case TestSplit: {
+      // The first block splits the chunk and leaves one upper half free on every order
+      blocks.Init(ChunkSize);
+      blocks.AddChunk(1);
+      CHECK_RESULT(!blocks.Allocate(100, &chunk, &offset), "Allocation failed");
+      CHECK_RESULT((chunk != 1) || (offset != 0), "First block isn't at the chunk start");
+      for (uint32_t order = 0; order < ChunkOrder; ++order) {
+        CHECK_RESULT(blocks.FreeBlocks(order) != 1, "%zu free blocks of order %u",
+                     blocks.FreeBlocks(order), order);
+      }
+      CHECK_RESULT(blocks.FreeBlocks(ChunkOrder) != 0, "The chunk is still free");
+      // The next blocks take the lowest free blocks of their orders
+      CHECK_RESULT(!blocks.Allocate(256, &chunk, &offset) || (offset != 256),
+                   "Second block is at %zu instead of 256", offset);
+      CHECK_RESULT(!blocks.Allocate(1000, &chunk, &offset) || (offset != 1024),
+                   "1KB block is at %zu instead of 1024", offset);
+      CHECK_RESULT(!blocks.Allocate(300, &chunk, &offset) || (offset != 512),
+                   "512B block is at %zu instead of 512", offset);
+      CHECK_RESULT((blocks.FreeBlocks(0) != 0) || (blocks.FreeBlocks(1) != 0) ||
+                       (blocks.FreeBlocks(2) != 0) || (blocks.FreeBlocks(3) != 1),
+                   "Wrong free blocks after the splits");
+      break;
+    }
+    case TestMerge: {
+      blocks.Init(ChunkSize);
+      blocks.AddChunk(1);
+      size_t offsets[4];
+      for (int i = 0; i < 4; ++i) {
+        CHECK_RESULT(!blocks.Allocate(256, &chunk, &offsets[i]), "Allocation %d failed", i);
+      }
+      // 256 and 512 aren't buddies, hence they stay separate
+      CHECK_RESULT(blocks.Free(1, offsets[1], 256), "The chunk was returned");
+      CHECK_RESULT(blocks.Free(1, offsets[2], 256), "The chunk was returned");
+      CHECK_RESULT(blocks.FreeBlocks(0) != 2, "%zu free blocks of order 0 instead of 2",
+                   blocks.FreeBlocks(0));
+      // 0 merges with 256 into a 512 byte block
+      CHECK_RESULT(blocks.Free(1, offsets[0], 256), "The chunk was returned");
+      CHECK_RESULT((blocks.FreeBlocks(0) != 1) || (blocks.FreeBlocks(1) != 1),
+                   "The buddies weren't merged");
+      // A merged block is allocated as one
+      CHECK_RESULT(!blocks.Allocate(512, &chunk, &offset) || (offset != 0),
+                   "Merged block is at %zu instead of 0", offset);
+      CHECK_RESULT(blocks.Free(1, offset, 512), "The chunk was returned");
+      // The last block merges all the way up to the chunk
+      CHECK_RESULT(!blocks.Free(1, offsets[3], 256), "Free chunk wasn't returned");
+      CHECK_RESULT(blocks.IsChunk(1), "The chunk is still in the lists");
+      for (uint32_t order = 0; order <= ChunkOrder; ++order) {
+        CHECK_RESULT(blocks.FreeBlocks(order) != 0, "%zu free blocks of order %u",
+                     blocks.FreeBlocks(order), order);
+      }
+      break;
+    }
+    case TestChunkReturn: {
+      blocks.Init(ChunkSize);
+      blocks.AddChunk(1);
+      const size_t largest = ChunkSize / 8;
+      std::vector<size_t> first;
+      for (int i = 0; i < 8; ++i) {
+        CHECK_RESULT(!blocks.Allocate(largest, &chunk, &offset) || (chunk != 1),
+                     "Allocation %d failed", i);
+        first.push_back(offset);
+      }
+      // The full chunk requires a new one
+      CHECK_RESULT(blocks.Allocate(256, &chunk, &offset), "Full chunk had a free block");
+      blocks.AddChunk(2);
+      CHECK_RESULT(!blocks.Allocate(256, &chunk, &offset) || (chunk != 2),
+                   "The second chunk wasn't used");
+      for (int i = 0; i < 8; ++i) {
+        bool returned = blocks.Free(1, first[i], largest);
+        CHECK_RESULT(returned != (i == 7), "Block %d %s the chunk", i,
+                     returned ? "returned" : "didn't return");
+      }
+      CHECK_RESULT(blocks.IsChunk(1) || !blocks.IsChunk(2), "Wrong chunk was returned");
+      CHECK_RESULT(blocks.Chunks().size() != 1, "%zu chunks instead of one",
+                   blocks.Chunks().size());
+      CHECK_RESULT(!blocks.Free(2, offset, 256), "The second chunk wasn't returned");
+      CHECK_RESULT(!blocks.Chunks().empty(), "The chunks weren't returned");
+      break;
+    }
+    case TestStress: {
+      blocks.Init(ChunkSize);
+      std::mt19937 random(4321);
+      // Live blocks of every chunk as offset and size
+      std::map<unsigned int, std::map<size_t, size_t>> live;
+      unsigned int nextChunk = 1;
+      for (uint32_t i = 0; i < 200000; ++i) {
+        if (live.empty() || ((random() % 2) == 0)) {
+          const size_t size = 1 + random() % (ChunkSize / 8);
+          if (!blocks.Allocate(size, &chunk, &offset)) {
+            blocks.AddChunk(nextChunk++);
+            CHECK_RESULT(!blocks.Allocate(size, &chunk, &offset),
+                         "Allocation failed in a new chunk");
+          }
+          const size_t blockSize = Blocks::BlockSize(size);
+          CHECK_RESULT(((offset % blockSize) != 0) || ((offset + blockSize) > ChunkSize),
+                       "Block at %zu of %zu bytes is misplaced", offset, blockSize);
+          auto& chunkLive = live[chunk];
+          auto next = chunkLive.lower_bound(offset);
+          CHECK_RESULT((next != chunkLive.end()) && (next->first < (offset + blockSize)),
+                       "Block at %zu overlaps the next block", offset);
+          if (next != chunkLive.begin()) {
+            auto prev = std::prev(next);
+            CHECK_RESULT((prev->first + Blocks::BlockSize(prev->second)) > offset,
+                         "Block at %zu overlaps the previous block", offset);
+          }
+          chunkLive[offset] = size;
+        } else {
+          auto chunkIt = live.begin();
+          std::advance(chunkIt, random() % live.size());
+          auto block = chunkIt->second.begin();
+          std::advance(block, random() % chunkIt->second.size());
+          const bool returned = blocks.Free(chunkIt->first, block->first, block->second);
+          chunkIt->second.erase(block);
+          CHECK_RESULT(returned != chunkIt->second.empty(),
+                       "Chunk %u return doesn't match its live blocks", chunkIt->first);
+          if (chunkIt->second.empty()) {
+            live.erase(chunkIt);
+          }
+        }
+      }
+      // Free all blocks, every chunk must be returned
+      for (auto& chunkLive : live) {
+        for (auto& block : chunkLive.second) {
+          blocks.Free(chunkLive.first, block.first, block.second);
+        }
+      }
+      CHECK_RESULT(!blocks.Chunks().empty(), "%zu chunks weren't returned",
+                   blocks.Chunks().size());
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+HOST_TEST(SubAllocatorTest);
@@ -239,6 +239,13 @@ class BlitManager : public amd::HeapObject {
                            uint32_t count
   ) const = 0;
 
+  //! Small copies and fills in a single dispatch, described by amd::BatchCopyFillEntry
+  virtual bool batchCopyFill(const void* entries,
+                             uint32_t count
+  ) const {
+    return false;
+  }
+
   //! Enables synchronization on blit operations
   void enableSynchronization() { syncOperation_ = true; }
 
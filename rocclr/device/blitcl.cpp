@@ -168,6 +168,49 @@ const char* BlitLinearSourceCode = BLIT_KERNELS(
   __kernel void __amd_rocclr_batchMemOp(__global void* params, uint count) {
     __amd_batchMemOp(params, count);
   }
+
+  // Every workgroup processes a single entry: x - dst, y - src or fill value, z - size,
+  // w - fill element size or 0 for the copy
+  __kernel void __amd_rocclr_batchCopyFill(__global ulong4* entries, uint count) {
+    ulong4 entry = entries[get_group_id(0)];
+    __global uchar* dst = (__global uchar*)entry.x;
+    ulong size = entry.z;
+    ulong id = get_local_id(0);
+    ulong stride = get_local_size(0);
+    bool aligned = ((entry.x | size) & (sizeof(uint) - 1)) == 0;
+    if (entry.w == 0) {
+      __global uchar* src = (__global uchar*)entry.y;
+      if (aligned && ((entry.y & (sizeof(uint) - 1)) == 0)) {
+        __global uint* srcD = (__global uint*)src;
+        __global uint* dstD = (__global uint*)dst;
+        for (ulong i = id; i < size / sizeof(uint); i += stride) {
+          dstD[i] = srcD[i];
+        }
+      } else {
+        for (ulong i = id; i < size; i += stride) {
+          dst[i] = src[i];
+        }
+      }
+    } else {
+      // Replicate the element into a dword, the element size is 1, 2 or 4 bytes
+      uint pattern = (uint)entry.y;
+      if (entry.w == 1) {
+        pattern = (pattern & 0xff) * 0x01010101u;
+      } else if (entry.w == 2) {
+        pattern = (pattern & 0xffff) * 0x00010001u;
+      }
+      if (aligned) {
+        __global uint* dstD = (__global uint*)dst;
+        for (ulong i = id; i < size / sizeof(uint); i += stride) {
+          dstD[i] = pattern;
+        }
+      } else {
+        for (ulong i = id; i < size; i += stride) {
+          dst[i] = (uchar)(pattern >> (8 * (i % sizeof(uint))));
+        }
+      }
+    }
+  }
 );
 
 const char* HipExtraSourceCode = BLIT_KERNELS(
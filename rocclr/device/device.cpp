@@ -356,6 +356,7 @@ Memory* Device::p2p_stage_ = nullptr;
 
 std::shared_mutex MemObjMap::AllocatedLock_ ROCCLR_INIT_PRIORITY(101);
 std::map<uintptr_t, amd::Memory*> MemObjMap::MemObjMap_ ROCCLR_INIT_PRIORITY(101);
+ConcurrentRangeMap<amd::Memory> MemObjMap::MemObjIndex_ ROCCLR_INIT_PRIORITY(101);
 std::map<uintptr_t, amd::Memory*> MemObjMap::VirtualMemObjMap_ ROCCLR_INIT_PRIORITY(101);
 
 void MemObjMap::AddMemObj(const void* k, amd::Memory* v) {
@@ -364,6 +365,8 @@ void MemObjMap::AddMemObj(const void* k, amd::Memory* v) {
   if (!rval.second) {
     DevLogPrintfError("Memobj map already has an entry for ptr: 0x%x",
                       reinterpret_cast<uintptr_t>(k));
+  } else {
+    MemObjIndex_.insert(rval.first->first, rval.first->first + v->getSize(), v);
   }
 }
 
@@ -372,18 +375,28 @@ void MemObjMap::RemoveMemObj(const void* k) {
   auto rval = MemObjMap_.erase(reinterpret_cast<uintptr_t>(k));
   guarantee(rval == 1, "Memobj map does not have ptr: 0x%x",
                         reinterpret_cast<uintptr_t>(k));
+  MemObjIndex_.remove(reinterpret_cast<uintptr_t>(k));
 }
 
 amd::Memory* MemObjMap::FindMemObj(const void* k, size_t* offset) {
-  std::shared_lock lock(AllocatedLock_);
   uintptr_t key = reinterpret_cast<uintptr_t>(k);
+  amd::Memory* mem = nullptr;
+  uintptr_t start = 0;
+  if (MemObjIndex_.find(key, &mem, &start)) {
+    if ((mem != nullptr) && (offset != nullptr)) {
+      *offset = key - start;
+    }
+    return mem;
+  }
+  // The index can't resolve the address, hence search the map
+  std::shared_lock lock(AllocatedLock_);
   auto it = MemObjMap_.upper_bound(key);
   if (it == MemObjMap_.begin()) {
     return nullptr;
   }
 
   --it;
-  amd::Memory* mem = it->second;
+  mem = it->second;
   if (key >= it->first && key < (it->first + mem->getSize())) {
     if (offset != nullptr) {
       *offset = key - it->first;
@@ -423,6 +436,7 @@ void MemObjMap::Purge(amd::Device* dev) {
     const std::vector<Device*>& devices = memObj->getContext().devices();
     if (devices.size() == 1 && devices[0] == dev && !(flags & ROCCLR_MEM_INTERNAL_MEMORY)) {
       memObj->release();
+      MemObjIndex_.remove(it->first);
       it = MemObjMap_.erase(it);
     } else {
       ++it;
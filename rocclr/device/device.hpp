@@ -28,6 +28,7 @@
 #include "platform/object.hpp"
 #include "platform/memory.hpp"
 #include "utils/util.hpp"
+#include "utils/rangemap.hpp"
 #include "amdocl/cl_kernel.h"
 #include "elf/elf.hpp"
 #include "appprofile.hpp"
@@ -38,6 +39,7 @@
 #include "hsailctx.hpp"
 #endif
 #include "devsignal.hpp"
+#include "devqueuestats.hpp"
 
 #if defined(__clang__)
 #if __has_feature(address_sanitizer)
@@ -93,6 +95,7 @@ class SvmUnmapMemoryCommand;
 class SvmPrefetchAsyncCommand;
 class StreamOperationCommand;
 class BatchMemoryOperationCommand;
+class BatchCopyFillCommand;
 class VirtualMapCommand;
 class ExternalSemaphoreCmd;
 class Isa;
@@ -1312,6 +1315,7 @@ class VirtualDevice : public amd::HeapObject {
   virtual void submitBatchMemoryOperation(amd::BatchMemoryOperationCommand& cmd) {
     ShouldNotReachHere();
   }
+  virtual void submitBatchCopyFill(amd::BatchCopyFillCommand& cmd) { ShouldNotReachHere(); }
   virtual void submitVirtualMap(amd::VirtualMapCommand& cmd) { ShouldNotReachHere(); }
 
   virtual address allocKernelArguments(size_t size, size_t alignment) { return nullptr; }
@@ -1336,6 +1340,12 @@ class VirtualDevice : public amd::HeapObject {
   virtual bool dispatchAqlPacket(uint8_t* aqlpacket,
                                  const std::string& kernelName,
                                  amd::AccumulateCommand* vcmd = nullptr) = 0;
+  //! Defers the doorbell rings of the following AQL packets until EndDoorbellBatch()
+  virtual void BeginDoorbellBatch() {}
+  //! Rings the doorbell once for the packets, dispatched since BeginDoorbellBatch()
+  virtual void EndDoorbellBatch() {}
+  //! Returns the queue telemetry. Returns false if the telemetry isn't collected
+  virtual bool GetQueueStats(QueueStats* stats) const { return false; }
 
   //! Returns the number of outstanding HSA async handlers
   std::atomic<uint64_t>& QueuedAsyncHandlers() const { return queued_async_handlers_; }
@@ -1387,6 +1397,8 @@ class MemObjMap : public AllStatic {
  private:
   //!< the mem object<->hostptr information container
   static std::map<uintptr_t, amd::Memory*> MemObjMap_;
+  //!< Lock-free index of the mem object ranges for the lookups
+  static ConcurrentRangeMap<amd::Memory> MemObjIndex_;
   //!< the virtual mem object<->hostptr information container
   static std::map<uintptr_t, amd::Memory*> VirtualMemObjMap_;
   //!< Shared read/write lock
@@ -0,0 +1,151 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace amd::device {
+
+//! Telemetry of a hardware queue. The histograms use power of 2 buckets: the bucket N
+//! counts the values in [2^(N-1), 2^N) range and the bucket 0 counts zeros
+struct QueueStats {
+  static constexpr uint32_t kHistogramBuckets = 16;
+  uint64_t queueId_ = 0;          //!< Hardware queue ID
+  uint64_t queueSize_ = 0;        //!< Number of the packet slots in the queue
+  uint64_t packets_ = 0;          //!< Dispatched AQL packets, including barriers
+  uint64_t barrierPackets_ = 0;   //!< Barrier packets inserted by the runtime
+  uint64_t maxFillLevel_ = 0;     //!< Highest number of the outstanding packets at dispatch
+  uint64_t queueFullStalls_ = 0;  //!< Dispatches, which waited for a free slot
+  uint64_t queueFullNs_ = 0;      //!< Total time of the free slot waits
+  uint64_t signalWaits_ = 0;      //!< Host waits for the queue signals
+  uint64_t signalWaitNs_ = 0;     //!< Total time of the host signal waits
+  uint64_t kernargRecycles_ = 0;  //!< Waits for the kernel arguments ring space
+  uint64_t maxSignals_ = 0;       //!< High-water mark of the queue signal pool
+  uint64_t fillLevel_[kHistogramBuckets] = {};     //!< Outstanding packets at dispatch
+  uint64_t queueFullUs_[kHistogramBuckets] = {};   //!< Free slot wait time in us
+  uint64_t signalWaitUs_[kHistogramBuckets] = {};  //!< Host signal wait time in us
+};
+
+//! Queue occupancy and stall telemetry. The counters are relaxed atomics, since the waits
+//! may occur outside of the execution lock and the query doesn't take the lock
+class QueueTelemetry {
+ public:
+  //! The periodic log is due every log_interval_ms, 0 disables the periodic log
+  explicit QueueTelemetry(uint64_t log_interval_ms = 0)
+    : log_interval_ns_(log_interval_ms * 1000000ULL), last_log_(Now()) {}
+
+  //! Records a packet and the number of the outstanding packets at its dispatch.
+  //! Returns true if the periodic log is due
+  bool Packet(uint64_t fill_level, bool barrier) {
+    const uint64_t packets = packets_.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (barrier) {
+      barrier_packets_.fetch_add(1, std::memory_order_relaxed);
+    }
+    fill_level_[Bucket(fill_level)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max_fill_level = max_fill_level_.load(std::memory_order_relaxed);
+    while ((fill_level > max_fill_level) &&
+           !max_fill_level_.compare_exchange_weak(max_fill_level, fill_level,
+                                                  std::memory_order_relaxed)) {
+    }
+    // Check the time only once per a batch of packets to keep the dispatch cost low
+    if ((log_interval_ns_ == 0) || ((packets & kLogCheckMask) != 0)) {
+      return false;
+    }
+    const uint64_t now = Now();
+    uint64_t last_log = last_log_.load(std::memory_order_relaxed);
+    return ((now - last_log) >= log_interval_ns_) &&
+        last_log_.compare_exchange_strong(last_log, now, std::memory_order_relaxed);
+  }
+
+  //! Records a wait for a free queue slot
+  void QueueFullStall(uint64_t time_ns) {
+    queue_full_stalls_.fetch_add(1, std::memory_order_relaxed);
+    queue_full_ns_.fetch_add(time_ns, std::memory_order_relaxed);
+    queue_full_us_[Bucket(time_ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //! Records a host wait for a queue signal
+  void SignalWait(uint64_t time_ns) {
+    signal_waits_.fetch_add(1, std::memory_order_relaxed);
+    signal_wait_ns_.fetch_add(time_ns, std::memory_order_relaxed);
+    signal_wait_us_[Bucket(time_ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //! Records a wait for the kernel arguments ring space
+  void KernargRecycle() { kernarg_recycles_.fetch_add(1, std::memory_order_relaxed); }
+
+  //! Copies the counters into the provided structure
+  void Get(QueueStats* stats) const {
+    stats->packets_ = packets_.load(std::memory_order_relaxed);
+    stats->barrierPackets_ = barrier_packets_.load(std::memory_order_relaxed);
+    stats->maxFillLevel_ = max_fill_level_.load(std::memory_order_relaxed);
+    stats->queueFullStalls_ = queue_full_stalls_.load(std::memory_order_relaxed);
+    stats->queueFullNs_ = queue_full_ns_.load(std::memory_order_relaxed);
+    stats->signalWaits_ = signal_waits_.load(std::memory_order_relaxed);
+    stats->signalWaitNs_ = signal_wait_ns_.load(std::memory_order_relaxed);
+    stats->kernargRecycles_ = kernarg_recycles_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < QueueStats::kHistogramBuckets; ++i) {
+      stats->fillLevel_[i] = fill_level_[i].load(std::memory_order_relaxed);
+      stats->queueFullUs_[i] = queue_full_us_[i].load(std::memory_order_relaxed);
+      stats->signalWaitUs_[i] = signal_wait_us_[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  //! Returns the power of 2 histogram bucket of the value
+  static uint32_t Bucket(uint64_t value) {
+    uint32_t bucket = 0;
+    while ((value != 0) && (bucket < (QueueStats::kHistogramBuckets - 1))) {
+      value >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  //! The time is checked once per this number of packets plus one
+  static constexpr uint64_t kLogCheckMask = 0xff;
+
+ private:
+  using Histogram = std::atomic<uint64_t>[QueueStats::kHistogramBuckets];
+
+  //! Returns the monotonic time in ns
+  static uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  const uint64_t log_interval_ns_;             //!< Interval of the periodic log
+  std::atomic<uint64_t> packets_{0};           //!< Dispatched packets
+  std::atomic<uint64_t> barrier_packets_{0};   //!< Inserted barrier packets
+  std::atomic<uint64_t> max_fill_level_{0};    //!< Highest fill level
+  std::atomic<uint64_t> queue_full_stalls_{0}; //!< Free slot waits
+  std::atomic<uint64_t> queue_full_ns_{0};     //!< Total time of the free slot waits
+  std::atomic<uint64_t> signal_waits_{0};      //!< Host signal waits
+  std::atomic<uint64_t> signal_wait_ns_{0};    //!< Total time of the host signal waits
+  std::atomic<uint64_t> kernarg_recycles_{0};  //!< Kernel arguments ring waits
+  std::atomic<uint64_t> last_log_;             //!< Time of the last periodic log
+  Histogram fill_level_ = {};                  //!< Fill level histogram
+  Histogram queue_full_us_ = {};               //!< Free slot wait histogram
+  Histogram signal_wait_us_ = {};              //!< Host signal wait histogram
+};
+
+}  // namespace amd::device
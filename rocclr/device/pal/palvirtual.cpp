@@ -2288,7 +2288,7 @@ void VirtualGPU::submitVirtualMap(amd::VirtualMapCommand& vcmd) {
     vaddr_pal_mem->iMem(),
     vaddr_offset,
     phymem_igpu_mem,
-    0,
+    vcmd.offset(),
     vcmd.size(),
     Pal::VirtualGpuMemAccessMode::NoAccess
   };
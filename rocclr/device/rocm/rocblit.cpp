@@ -2540,6 +2540,42 @@ bool KernelBlitManager::batchMemOps(const void* paramArray, size_t paramSize,
   return result;
 }
 
+// ================================================================================================
+bool KernelBlitManager::batchCopyFill(const void* entries, uint32_t count) const {
+  amd::ScopedLock k(lockXferOps_);
+  uint blitType = BatchCopyFill;
+  if (kernels_[blitType] == nullptr) {
+    return false;
+  }
+  size_t dim = 1;
+
+  // Every workgroup processes a single entry of the batch
+  constexpr size_t kWorkGroupSize = 256;
+  size_t globalWorkOffset[1] = { 0 };
+  size_t globalWorkSize[1] = { count * kWorkGroupSize };
+  size_t localWorkSize[1] = { kWorkGroupSize };
+
+  // The captured packets are replayed, hence the entries can't be in the kernel arg ring
+  constexpr bool kDirectVa = true;
+  const size_t size = count * sizeof(amd::BatchCopyFillEntry);
+  auto constBuf = gpu().allocPersistentKernArg(size, kCBAlignment);
+  memcpy(constBuf, entries, size);
+
+  setArgument(kernels_[blitType], 0, sizeof(cl_mem), constBuf, 0, nullptr, kDirectVa);
+  setArgument(kernels_[blitType], 1, sizeof(uint32_t), &count);
+
+  // Create ND range object for the kernel's execution
+  amd::NDRangeContainer ndrange(dim, globalWorkOffset, globalWorkSize, localWorkSize);
+
+  // Execute the blit
+  address parameters = captureArguments(kernels_[blitType]);
+  bool result = gpu().submitKernelInternal(ndrange, *kernels_[blitType], parameters, nullptr);
+  releaseArguments(parameters);
+  synchronize();
+
+  return result;
+}
+
 // ================================================================================================
 bool KernelBlitManager::initHeap(device::Memory* heap_to_initialize, device::Memory* initial_blocks,
                                  uint heap_size, uint number_of_initial_blocks) const {
@@ -278,6 +278,7 @@ class KernelBlitManager : public DmaBlitManager {
     GwsInit,
     InitHeap,
     BatchMemOp,
+    BatchCopyFill,
     BlitLinearTotal,
     FillImage = BlitLinearTotal,
     BlitCopyImage,
@@ -505,6 +506,9 @@ class KernelBlitManager : public DmaBlitManager {
   //! Batch memory ops- Submits batch of streamWaits and streamWrite operations.
   virtual bool batchMemOps(const void* paramArray, size_t paramSize, uint32_t count) const;
 
+  //! Batch copy and fill - Submits small copies and fills in a single dispatch.
+  virtual bool batchCopyFill(const void* entries, uint32_t count) const;
+
   virtual amd::Monitor* lockXfer() const { return &lockXferOps_; }
 
   virtual bool initHeap(device::Memory* heap_to_initialize,
@@ -594,6 +598,7 @@ static const char* BlitName[KernelBlitManager::BlitTotal] = {
     "__amd_rocclr_streamOpsWrite",    "__amd_rocclr_streamOpsWait",
     "__amd_rocclr_scheduler",         "__amd_rocclr_gwsInit",
     "__amd_rocclr_initHeap",          "__amd_rocclr_batchMemOp",
+    "__amd_rocclr_batchCopyFill",
     "__amd_rocclr_fillImage",         "__amd_rocclr_copyImage",
     "__amd_rocclr_copyImage1DA",      "__amd_rocclr_copyImageToBuffer",
     "__amd_rocclr_copyBufferToImage"};
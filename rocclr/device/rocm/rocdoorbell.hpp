@@ -0,0 +1,77 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+namespace amd::roc {
+
+//! Defers the AQL doorbell rings of the packets, dispatched inside of the batch windows.
+//! The queue processes the packets up to the rung write index only, hence the owner must
+//! flush the deferred ring before any wait for the queue progress.
+//! RingFunc is a functor, which stores the provided write index into the doorbell signal.
+template <typename RingFunc>
+class DoorbellBatch {
+ public:
+  explicit DoorbellBatch(RingFunc ring) : ring_(ring) {}
+
+  //! Opens a batch window. The windows can be nested
+  void Begin() { ++depth_; }
+
+  //! Closes a batch window. The outermost window rings the deferred doorbell
+  void End() {
+    assert(depth_ > 0 && "Unbalanced doorbell batch window!");
+    if (--depth_ == 0) {
+      Flush();
+    }
+  }
+
+  //! Rings the doorbell with the provided write index or defers it in a batch window
+  void Ring(uint64_t index) {
+    if (depth_ > 0) {
+      // The packet headers are already visible, hence the last write index covers all packets
+      index_ = index;
+      pending_ = true;
+    } else {
+      ring_(index);
+    }
+  }
+
+  //! Rings the deferred doorbell
+  void Flush() {
+    if (pending_) {
+      pending_ = false;
+      ring_(index_);
+    }
+  }
+
+  //! Returns true if a batch window is open
+  bool Active() const { return depth_ > 0; }
+
+ private:
+  RingFunc ring_;           //!< Stores the write index into the doorbell signal
+  uint32_t depth_ = 0;      //!< Nesting depth of the batch windows
+  bool pending_ = false;    //!< The doorbell ring was deferred
+  uint64_t index_ = 0;      //!< Write index of the deferred doorbell ring
+};
+
+}  // namespace amd::roc
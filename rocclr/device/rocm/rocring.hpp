@@ -0,0 +1,201 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace amd::roc {
+
+//! Completion source of the ring retire points. The signals are opaque handles,
+//! the null handle is 0
+class RetireSource {
+ public:
+  virtual ~RetireSource() {}
+
+  //! Returns true if the work before the signal is complete
+  virtual bool IsDone(uint64_t signal) = 0;
+
+  //! Arms the signal for a new retire point
+  virtual void Arm(uint64_t signal) = 0;
+
+  //! Waits for the signal completion. Returns false on a failure
+  virtual bool Wait(uint64_t signal) = 0;
+
+  //! Issues a barrier, which completes the signal after all previous work
+  virtual void Barrier(uint64_t signal) = 0;
+
+  //! Notifies a wait for the ring space up to the required offset
+  virtual void RecycleWait(uint64_t /*required_tail*/) {}
+};
+
+//! Ring allocator, which reclaims the regions with the retire points. A retire point is a
+//! ring offset plus a signal of the source. All regions before the offset are free after
+//! the signal completes.
+class RetireRing {
+ public:
+  //! If dispatch_retire is true, then the retire points are attached to the dispatches,
+  //! otherwise a barrier is issued for every 1/num_retire_points of the ring
+  RetireRing(RetireSource& source, uint32_t size, uint32_t num_retire_points,
+             bool dispatch_retire)
+      : source_(source),
+        size_(size),
+        retire_granule_(size / num_retire_points),
+        dispatch_retire_(dispatch_retire) {}
+
+  //! Sets the ring base address and the signals for the retire points
+  void Init(uintptr_t base, const std::vector<uint64_t>& signals) {
+    base_ = base;
+    free_signals_ = signals;
+  }
+
+  //! Acquires a region of the provided size and alignment, returns its address
+  uintptr_t Acquire(uint32_t size, uint32_t alignment) {
+    assert(alignment != 0);
+    assert((size + alignment <= size_) && "The allocation doesn't fit into the ring!");
+    // Without the dispatch retire points the previous regions are retired with a barrier
+    if (!dispatch_retire_ && ((head_ - last_retire_) >= retire_granule_)) {
+      AddBarrierRetirePoint();
+    }
+    uint64_t start = head_;
+    uint64_t offset = head_ % size_;
+    uintptr_t result = AlignUp(base_ + offset, alignment);
+    if ((result + size) > (base_ + size_)) {
+      // The region doesn't fit before the end of the ring, hence skip the ring tail
+      start += size_ - offset;
+      offset = 0;
+      result = AlignUp(base_, alignment);
+    }
+    const uint64_t end = start + ((result + size) - (base_ + offset));
+    if ((end - tail_) > size_) {
+      // Wait for the oldest regions. An empty ring fits any allocation up to the ring size
+      Reclaim(std::min(end - size_, head_));
+      tail_ = std::max(tail_, end - size_);
+    }
+    head_ = end;
+    return result;
+  }
+
+  //! Returns the signal for a new retire point, completed with the dispatch, or
+  //! the null signal if the retire point isn't required.
+  //! The dispatch must have the barrier bit, so its completion covers all previous work
+  uint64_t DispatchRetireSignal() {
+    if (!dispatch_retire_ || ((head_ - last_retire_) < retire_granule_)) {
+      return 0;
+    }
+    // Recycle the completed retire points
+    while (!retire_points_.empty() && source_.IsDone(retire_points_.front().signal_)) {
+      Retire();
+    }
+    if (free_signals_.empty()) {
+      // The next dispatch will try again
+      return 0;
+    }
+    uint64_t signal = free_signals_.back();
+    free_signals_.pop_back();
+    source_.Arm(signal);
+    retire_points_.push_back({head_, signal});
+    last_retire_ = head_;
+    return signal;
+  }
+
+  //! Resets the ring. The source must be idle, hence all retire points are done
+  void Reset() {
+    while (!retire_points_.empty()) {
+      Retire();
+    }
+    head_ = 0;
+    tail_ = 0;
+    last_retire_ = 0;
+  }
+
+ private:
+  struct RetirePoint {
+    uint64_t offset_;  //!< All regions before the offset are free after the signal
+    uint64_t signal_;  //!< Signal of the dispatch or the barrier
+  };
+
+  static uintptr_t AlignUp(uintptr_t value, uint32_t alignment) {
+    return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+  }
+
+  //! Releases the retired regions. If the ring tail is behind the required offset,
+  //! then waits for the oldest retire points
+  void Reclaim(uint64_t required_tail) {
+    // Release the retired regions without a wait
+    while (!retire_points_.empty() && source_.IsDone(retire_points_.front().signal_)) {
+      Retire();
+    }
+    if (tail_ >= required_tail) {
+      return;
+    }
+    // The outstanding retire points don't cover the required region, hence retire all work
+    if (retire_points_.empty() || (retire_points_.back().offset_ < required_tail)) {
+      AddBarrierRetirePoint();
+    }
+    source_.RecycleWait(required_tail);
+    while (tail_ < required_tail) {
+      bool test = source_.Wait(retire_points_.front().signal_);
+      assert(test && "Runtime can't fail a wait for the ring region!");
+      Retire();
+    }
+  }
+
+  //! Issues a barrier for a new retire point at the current ring head
+  void AddBarrierRetirePoint() {
+    if (free_signals_.empty()) {
+      // Recycle the signal of the oldest retire point
+      bool test = source_.Wait(retire_points_.front().signal_);
+      assert(test && "Runtime can't fail a wait for the ring region!");
+      Retire();
+    }
+    uint64_t signal = free_signals_.back();
+    free_signals_.pop_back();
+    source_.Arm(signal);
+    source_.Barrier(signal);
+    retire_points_.push_back({head_, signal});
+    last_retire_ = head_;
+  }
+
+  //! Moves the retire point into the free list and the ring tail to the point offset
+  void Retire() {
+    const RetirePoint& point = retire_points_.front();
+    tail_ = std::max(tail_, point.offset_);
+    free_signals_.push_back(point.signal_);
+    retire_points_.pop_front();
+  }
+
+  RetireSource& source_;              //!< Completion source of the retire points
+  uintptr_t base_ = 0;                //!< Ring base address
+  uint32_t size_;                     //!< Ring size
+  uint32_t retire_granule_;           //!< Ring usage between two retire points
+  bool dispatch_retire_;              //!< The retire points are attached to the dispatches
+  uint64_t head_ = 0;                 //!< Ring offset of the next allocation, never wraps
+  uint64_t tail_ = 0;                 //!< Ring offset of the oldest used region
+  uint64_t last_retire_ = 0;          //!< Offset of the last retire point
+  std::vector<uint64_t> free_signals_;       //!< Signals, available for the new retire points
+  std::deque<RetirePoint> retire_points_;    //!< Outstanding retire points in the ring order
+};
+
+}  // namespace amd::roc
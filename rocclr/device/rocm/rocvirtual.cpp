@@ -251,24 +251,70 @@ bool HsaAmdSignalHandler(hsa_signal_value_t value, void* arg) {
 
 // ================================================================================================
 bool VirtualGPU::MemoryDependency::create(size_t numMemObj) {
-  if (numMemObj > 0) {
-    // Allocate the array of memory objects for dependency tracking
-    memObjectsInQueue_ = new MemoryState[numMemObj];
-    if (nullptr == memObjectsInQueue_) {
-      return false;
+  // The value only enables the tracking, since the ranges storage grows on demand
+  enabled_ = (numMemObj > 0);
+  if (enabled_) {
+    kernelRanges_.reserve(numMemObj);
+  }
+  return true;
+}
+
+// ================================================================================================
+void VirtualGPU::MemoryDependency::newKernel() {
+  // The objects of the previous kernel become busy for the new kernel
+  for (const auto& range : kernelRanges_) {
+    addBusyRange(range);
+  }
+  kernelRanges_.clear();
+}
+
+// ================================================================================================
+bool VirtualGPU::MemoryDependency::isBusy(uint64_t start, uint64_t end, bool readOnly) const {
+  // Find the first busy range, which may overlap the start
+  auto it = busyRanges_.upper_bound(start);
+  if (it != busyRanges_.begin()) {
+    auto prev = std::prev(it);
+    if (prev->second.end_ > start) {
+      it = prev;
+    }
+  }
+  for (; (it != busyRanges_.end()) && (it->first < end); ++it) {
+    // If the busy region was written or the current one is for write
+    if (!it->second.readOnly_ || !readOnly) {
+      return true;
     }
-    memset(memObjectsInQueue_, 0, sizeof(MemoryState) * numMemObj);
-    maxMemObjectsInQueue_ = numMemObj;
   }
+  return false;
+}
 
-  return true;
+// ================================================================================================
+void VirtualGPU::MemoryDependency::addBusyRange(const MemoryState& range) {
+  uint64_t start = range.start_;
+  uint64_t end = range.end_;
+  bool readOnly = range.readOnly_;
+  if (start == end) {
+    return;
+  }
+  auto it = busyRanges_.upper_bound(start);
+  if (it != busyRanges_.begin()) {
+    auto prev = std::prev(it);
+    if (prev->second.end_ > start) {
+      it = prev;
+    }
+  }
+  // Merge all overlapped ranges, the merged range is read only if all accesses were read only
+  while ((it != busyRanges_.end()) && (it->first < end)) {
+    start = std::min(start, it->first);
+    end = std::max(end, it->second.end_);
+    readOnly = readOnly && it->second.readOnly_;
+    it = busyRanges_.erase(it);
+  }
+  busyRanges_.emplace_hint(it, start, BusyRange{end, readOnly});
 }
 
 // ================================================================================================
 void VirtualGPU::MemoryDependency::validate(VirtualGPU& gpu, const Memory* memory, bool readOnly) {
-  bool flushL1Cache = false;
-
-  if (maxMemObjectsInQueue_ == 0) {
+  if (!enabled_) {
     // Sync AQL packets
     gpu.setAqlHeader(gpu.dispatchPacketHeader_);
     return;
@@ -277,33 +323,9 @@ void VirtualGPU::MemoryDependency::validate(VirtualGPU& gpu, const Memory* memor
   uint64_t curStart = reinterpret_cast<uint64_t>(memory->getDeviceMemory());
   uint64_t curEnd = curStart + memory->size();
 
-  // Loop through all memory objects in the queue and find dependency
+  // Find dependency on the objects of the previous kernels
   // @note don't include objects from the current kernel
-  for (size_t j = 0; j < endMemObjectsInQueue_; ++j) {
-    // Check if the queue already contains this mem object and
-    // GPU operations aren't readonly
-    uint64_t busyStart = memObjectsInQueue_[j].start_;
-    uint64_t busyEnd = memObjectsInQueue_[j].end_;
-
-    // Check if the start inside the busy region
-    if ((((curStart >= busyStart) && (curStart < busyEnd)) ||
-         // Check if the end inside the busy region
-         ((curEnd > busyStart) && (curEnd <= busyEnd)) ||
-         // Check if the start/end cover the busy region
-         ((curStart <= busyStart) && (curEnd >= busyEnd))) &&
-        // If the buys region was written or the current one is for write
-        (!memObjectsInQueue_[j].readOnly_ || !readOnly)) {
-      flushL1Cache = true;
-      break;
-    }
-  }
-
-  // Did we reach the limit?
-  if (maxMemObjectsInQueue_ <= numMemObjectsInQueue_) {
-    flushL1Cache = true;
-  }
-
-  if (flushL1Cache) {
+  if (isBusy(curStart, curEnd, readOnly)) {
     // Sync AQL packets
     gpu.setAqlHeader(gpu.dispatchPacketHeader_);
 
@@ -315,50 +337,22 @@ void VirtualGPU::MemoryDependency::validate(VirtualGPU& gpu, const Memory* memor
   // Insert current memory object into the queue always,
   // since runtime calls flush before kernel execution and it has to keep
   // current kernel in tracking
-  memObjectsInQueue_[numMemObjectsInQueue_].start_ = curStart;
-  memObjectsInQueue_[numMemObjectsInQueue_].end_ = curEnd;
-  memObjectsInQueue_[numMemObjectsInQueue_].readOnly_ = readOnly;
-  numMemObjectsInQueue_++;
+  kernelRanges_.push_back({curStart, curEnd, readOnly});
 }
 
 // ================================================================================================
 void VirtualGPU::MemoryDependency::clear(bool all) {
-  if (numMemObjectsInQueue_ > 0) {
-    if (all) {
-      endMemObjectsInQueue_ = numMemObjectsInQueue_;
-    }
-
-    // If the current launch didn't start from the beginning, then move the data
-    if (0 != endMemObjectsInQueue_) {
-      // Preserve all objects from the current kernel
-      size_t i, j;
-      for (i = 0, j = endMemObjectsInQueue_; j < numMemObjectsInQueue_; i++, j++) {
-        memObjectsInQueue_[i].start_ = memObjectsInQueue_[j].start_;
-        memObjectsInQueue_[i].end_ = memObjectsInQueue_[j].end_;
-        memObjectsInQueue_[i].readOnly_ = memObjectsInQueue_[j].readOnly_;
-      }
-    } else if (numMemObjectsInQueue_ >= maxMemObjectsInQueue_) {
-      // note: The array growth shouldn't occur under the normal conditions,
-      // but in a case when SVM path sends the amount of SVM ptrs over
-      // the max size of kernel arguments
-      MemoryState* ptr  = new MemoryState[maxMemObjectsInQueue_ << 1];
-      if (nullptr == ptr) {
-        numMemObjectsInQueue_ = 0;
-        return;
-      }
-      maxMemObjectsInQueue_ <<= 1;
-      memcpy(ptr, memObjectsInQueue_, sizeof(MemoryState) * numMemObjectsInQueue_);
-      delete[] memObjectsInQueue_;
-      memObjectsInQueue_= ptr;
-    }
-
-    numMemObjectsInQueue_ -= endMemObjectsInQueue_;
-    endMemObjectsInQueue_ = 0;
+  busyRanges_.clear();
+  // Preserve all objects from the current kernel
+  if (all) {
+    kernelRanges_.clear();
   }
 }
 
 // ================================================================================================
 VirtualGPU::HwQueueTracker::~HwQueueTracker() {
+  ClPrint(amd::LOG_INFO, amd::LOG_SIG, "Signal pool high-water mark: %zu signals",
+          HighWaterMark());
   for (auto& signal: signal_list_) {
     CpuWaitForSignal(signal);
     signal->release();
@@ -406,6 +400,7 @@ bool VirtualGPU::HwQueueTracker::Create() {
     }
     signal_list_[i] = signal.release();
   }
+  high_water_mark_.store(signal_list_.size(), std::memory_order_relaxed);
   // Add extra signals with the interrupts for the callbacks
   if (AMD_DIRECT_DISPATCH && gpu_.dev().ActiveWait()) {
     for (uint32_t i = 0; i < 5; ++i) {
@@ -420,6 +415,42 @@ bool VirtualGPU::HwQueueTracker::Create() {
   return true;
 }
 
+// ================================================================================================
+ProfilingSignal* VirtualGPU::HwQueueTracker::FreeSignal() {
+  // Reuse a retired signal before a new allocation
+  if (!signal_pool_.empty()) {
+    ProfilingSignal* signal = signal_pool_.top();
+    signal_pool_.pop();
+    return signal;
+  }
+  std::unique_ptr<ProfilingSignal> signal(new ProfilingSignal());
+  if ((signal == nullptr) || !CreateSignal(signal.get())) {
+    return nullptr;
+  }
+  return signal.release();
+}
+
+// ================================================================================================
+void VirtualGPU::HwQueueTracker::RecycleSignal(size_t id) {
+  ProfilingSignal* signal = signal_list_[id];
+  // The signal after the recycled one must be done also, the same way as the reuse in the list
+  // avoids a race with a GPU waiter. The signal, assigned to a marker's event, stays in the list
+  size_t next = (id + 1) % signal_list_.size();
+  if ((id == current_id_) || (next == current_id_) || (signal->referenceCount() > 1) ||
+      (hsa_signal_load_relaxed(signal_list_[next]->signal_) > 0)) {
+    return;
+  }
+  // Process the timestamp of the retired signal
+  CpuWaitForSignal(signal);
+  signal_list_.erase(signal_list_.begin() + id);
+  if (id < current_id_) {
+    --current_id_;
+  }
+  auto& pool = (signal->flags_.interrupt_ && AMD_DIRECT_DISPATCH && gpu_.dev().ActiveWait()) ?
+      signal_pool_irq_ : signal_pool_;
+  pool.push(signal);
+}
+
 // ================================================================================================
 hsa_signal_t VirtualGPU::HwQueueTracker::ActiveSignal(
     hsa_signal_value_t init_val, Timestamp* ts) {
@@ -429,14 +460,22 @@ hsa_signal_t VirtualGPU::HwQueueTracker::ActiveSignal(
   auto temp_id = (current_id_ + 2) % signal_list_.size();
   // If GPU is still busy with processing, then add more signals to avoid more frequent stalls
   if (hsa_signal_load_relaxed(signal_list_[temp_id]->signal_) > 0) {
-    std::unique_ptr<ProfilingSignal> signal(new ProfilingSignal());
-    if ((signal != nullptr) && CreateSignal(signal.get())) {
-      // Find valid new index
-      ++current_id_ %= signal_list_.size();
-      // Insert the new signal into the current slot and ignore any wait
-      signal_list_.insert(signal_list_.begin() + current_id_, signal.release());
-      new_signal = true;
+    if (signal_list_.size() < std::max(ROC_SIGNAL_POOL_MAX_SIZE, ROC_SIGNAL_POOL_SIZE)) {
+      ProfilingSignal* signal = FreeSignal();
+      if (signal != nullptr) {
+        // Find valid new index
+        ++current_id_ %= signal_list_.size();
+        // Insert the new signal into the current slot and ignore any wait
+        signal_list_.insert(signal_list_.begin() + current_id_, signal);
+        if (signal_list_.size() > HighWaterMark()) {
+          high_water_mark_.store(signal_list_.size(), std::memory_order_relaxed);
+        }
+        new_signal = true;
+      }
     }
+  } else if (signal_list_.size() > ROC_SIGNAL_POOL_SIZE) {
+    // The pipeline is shallower than the list, hence return one retired signal into the pool
+    RecycleSignal(temp_id);
   }
 
   // If it's the new signal, then the wait can be avoided.
@@ -610,6 +649,8 @@ std::vector<hsa_signal_t>& VirtualGPU::HwQueueTracker::WaitingSignal(HwQueueEngi
 
 // ================================================================================================
 bool VirtualGPU::HwQueueTracker::CpuWaitForSignal(ProfilingSignal* signal) {
+  // The signal may belong to a packet with the deferred doorbell
+  gpu_.flushDoorbell();
   // Wait for the current signal
   if (signal->ts_ != nullptr) {
     // Update timestamp values if requested
@@ -621,10 +662,14 @@ bool VirtualGPU::HwQueueTracker::CpuWaitForSignal(ProfilingSignal* signal) {
     amd::ScopedLock lock(signal->LockSignalOps());
     ClPrint(amd::LOG_DEBUG, amd::LOG_COPY, "Host wait on completion_signal=0x%zx",
             signal->signal_.handle);
+    const uint64_t start = ROC_QUEUE_STATS ? amd::Os::timeNanos() : 0;
     if (!WaitForSignal(signal->signal_, gpu_.ActiveWait())) {
       LogPrintfError("Failed signal [0x%lx] wait", signal->signal_);
       return false;
     }
+    if (ROC_QUEUE_STATS) {
+      gpu_.Telemetry().SignalWait(amd::Os::timeNanos() - start);
+    }
     signal->flags_.done_ = true;
   }
   return true;
@@ -638,6 +683,27 @@ void VirtualGPU::HwQueueTracker::ResetCurrentSignal() {
   current_id_ = (current_id_ == 0) ? (signal_list_.size() - 1) : (current_id_ - 1);
 }
 
+// ================================================================================================
+bool VirtualGPU::isAgentLocalMemory(amd::Memory& mem) const {
+  // Host, fine grain, uncached and shared allocations can be accessed outside of the agent
+  constexpr amd::Memory::Flags kSystemMemFlags = CL_MEM_USE_HOST_PTR | CL_MEM_ALLOC_HOST_PTR |
+      CL_MEM_SVM_FINE_GRAIN_BUFFER | ROCCLR_MEM_HSA_UNCACHED | ROCCLR_MEM_INTERPROCESS;
+  if (((mem.getMemFlags() & kSystemMemFlags) != 0) || mem.isInterop() || mem.ipcShared()) {
+    return false;
+  }
+  // Other devices in the context can access the memory directly
+  const auto& devices = mem.getContext().devices();
+  if ((devices.size() != 1) || (devices[0] != &dev())) {
+    return false;
+  }
+  // Views inherit the location of the original allocation
+  if (mem.parent() != nullptr) {
+    return isAgentLocalMemory(*mem.parent());
+  }
+  const Memory* gpuMem = static_cast<Memory*>(mem.getDeviceMemory(dev(), false));
+  return (gpuMem != nullptr) && !gpuMem->isHostMemDirectAccess();
+}
+
 // ================================================================================================
 bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address params,
   size_t& ldsAddress, bool cooperativeGroups, bool& imageBufferWrtBack,
@@ -646,7 +712,9 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
   const amd::KernelSignature& signature = kernel.signature();
   const amd::KernelParameters& kernelParams = kernel.parameters();
 
-  if (!cooperativeGroups && memoryDependency().maxMemObjectsInQueue() != 0) {
+  // The captured packets are replayed out of the tracked queue order, hence keep them in sync
+  bool isGraphCapture = (currCmd_ != nullptr) && currCmd_->getPktCapturingState();
+  if (!cooperativeGroups && !isGraphCapture && memoryDependency().enabled()) {
     // AQL packets
     setAqlHeader(dispatchPacketHeaderNoSync_);
   }
@@ -674,6 +742,10 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
   // Mark the tracker with a new kernel, so it can avoid checks of the aliased objects
   memoryDependency().newKernel();
 
+  // The release scope analysis starts from the device local state and falls back to
+  // the system scope on the first object, which can be observed outside of the agent
+  kernelSystemScope_ = false;
+
   bool deviceSupportFGS = 0 != dev().isFineGrainedSystem(true);
   bool supportFineGrainedSystem = deviceSupportFGS;
   FGSStatus status = kernelParams.getSvmSystemPointersSupport();
@@ -702,6 +774,7 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
   for (size_t i = 0; i < count; i++) {
     memory = amd::MemObjMap::FindMemObj(svmPtrArray[i]);
     if (nullptr == memory) {
+      kernelSystemScope_ = true;
       if (!supportFineGrainedSystem) {
         return false;
       } else if (sync) {
@@ -713,6 +786,7 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
         continue;
       }
     } else {
+      kernelSystemScope_ |= !isAgentLocalMemory(*memory);
       Memory* rocMemory = static_cast<Memory*>(memory->getDeviceMemory(dev()));
       if (nullptr != rocMemory) {
         // Synchronize data with other memory instances if necessary
@@ -762,8 +836,10 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
         ClPrint(amd::LOG_INFO, amd::LOG_KERN,
             "Arg%d: %s %s = ptr:%p", i, desc.typeName_.c_str(), desc.name_.c_str(), globalAddress);
         if (mem == nullptr) {
-          //! This condition is for SVM fine-grain
-          if (dev().isFineGrainedSystem(true)) {
+          // The location of an unknown pointer is unclear
+          kernelSystemScope_ |= (globalAddress != nullptr);
+          //! This condition is for SVM fine-grain and for the unknown HIP pointers
+          if (dev().isFineGrainedSystem(true) || (amd::IS_HIP && (globalAddress != nullptr))) {
             // Sync AQL packets
             setAqlHeader(dispatchPacketHeader_);
             // Clear memory dependency state
@@ -772,6 +848,7 @@ bool VirtualGPU::processMemObjects(const amd::Kernel& kernel, const_address para
           }
         }
         else {
+          kernelSystemScope_ |= !isAgentLocalMemory(*mem);
           gpuMem = static_cast<Memory*>(mem->getDeviceMemory(dev()));
 
           const void* globalAddress = *reinterpret_cast<const void* const*>(params + desc.offset_);
@@ -1007,8 +1084,19 @@ bool VirtualGPU::dispatchGenericAqlPacket(
   }
 
   // Make sure the slot is free for usage
-  while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= sw_queue_size) {
-    amd::Os::yield();
+  if ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= sw_queue_size) {
+    // HW can't free the slot without the deferred doorbell
+    flushDoorbell();
+    const uint64_t start = ROC_QUEUE_STATS ? amd::Os::timeNanos() : 0;
+    while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= sw_queue_size) {
+      amd::Os::yield();
+    }
+    if (ROC_QUEUE_STATS) {
+      Telemetry().QueueFullStall(amd::Os::timeNanos() - start);
+    }
+  }
+  if (ROC_QUEUE_STATS && Telemetry().Packet(index - read, false)) {
+    LogQueueStats();
   }
 
   // Add blocking command if the original value of read index was behind of the queue size.
@@ -1023,6 +1111,13 @@ bool VirtualGPU::dispatchGenericAqlPacket(
 
   AqlPacket* aql_loc = &((AqlPacket*)(gpu_queue_->base_address))[index & queueMask];
   *aql_loc = *packet;
+  // The dispatch with the barrier bit completes after all previous work, hence it can retire
+  // the kernel arguments. Note: the original packet may be a captured one and stays unchanged
+  if (std::is_same<AqlPacket, hsa_kernel_dispatch_packet_t>::value &&
+      (aql_loc->completion_signal.handle == 0) &&
+      (extractAqlBits(header, HSA_PACKET_HEADER_BARRIER, HSA_PACKET_HEADER_WIDTH_BARRIER) != 0)) {
+    aql_loc->completion_signal = managed_kernarg_buffer_.DispatchRetireSignal();
+  }
   if (header != 0) {
     packet_store_release(reinterpret_cast<uint32_t*>(aql_loc), header, rest);
   }
@@ -1053,7 +1148,7 @@ bool VirtualGPU::dispatchGenericAqlPacket(
           reinterpret_cast<hsa_kernel_dispatch_packet_t*>(packet)->reserved2, read,
           index);
 
-  hsa_signal_store_screlease(gpu_queue_->doorbell_signal, index);
+  doorbell_.Ring(index);
 
   // Mark the flag indicating if a dispatch is outstanding.
   // We are not waiting after every dispatch.
@@ -1061,6 +1156,7 @@ bool VirtualGPU::dispatchGenericAqlPacket(
 
   // Wait on signal ?
   if (blocking) {
+    flushDoorbell();
     LogInfo("Runtime reached the AQL queue limit. SW is much ahead of HW. Blocking AQL queue!");
     if (!Barriers().WaitCurrent()) {
       LogPrintfError("Failed blocking queue wait with signal [0x%lx]",
@@ -1072,6 +1168,23 @@ bool VirtualGPU::dispatchGenericAqlPacket(
   return true;
 }
 
+// ================================================================================================
+void VirtualGPU::BeginDoorbellBatch() {
+  if (ROC_BATCH_DOORBELL) {
+    // Other threads can't wait for the deferred packets under the execution lock
+    execution().lock();
+    doorbell_.Begin();
+  }
+}
+
+// ================================================================================================
+void VirtualGPU::EndDoorbellBatch() {
+  if (ROC_BATCH_DOORBELL) {
+    doorbell_.End();
+    execution().unlock();
+  }
+}
+
 // ================================================================================================
 void VirtualGPU::dispatchBlockingWait() {
   auto wait_signals = Barriers().WaitingSignal();
@@ -1201,13 +1314,23 @@ void VirtualGPU::dispatchBarrierPacket(uint16_t packetHeader, bool skipSignal,
     fence_dirty_ = false;
   }
 
-  while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask);
+  if ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask) {
+    flushDoorbell();
+    const uint64_t start = ROC_QUEUE_STATS ? amd::Os::timeNanos() : 0;
+    while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask);
+    if (ROC_QUEUE_STATS) {
+      Telemetry().QueueFullStall(amd::Os::timeNanos() - start);
+    }
+  }
+  if (ROC_QUEUE_STATS && Telemetry().Packet(index - read, true)) {
+    LogQueueStats();
+  }
   hsa_barrier_and_packet_t* aql_loc =
     &(reinterpret_cast<hsa_barrier_and_packet_t*>(gpu_queue_->base_address))[index & queueMask];
   *aql_loc = barrier_packet_;
   __atomic_store_n(reinterpret_cast<uint32_t*>(aql_loc), packetHeader, __ATOMIC_RELEASE);
 
-  hsa_signal_store_screlease(gpu_queue_->doorbell_signal, index);
+  doorbell_.Ring(index);
   ClPrint(amd::LOG_DEBUG, amd::LOG_AQL,
           "SWq=0x%zx, HWq=0x%zx, id=%d, BarrierAND Header = 0x%x (type=%d, barrier=%d, acquire=%d,"
           " release=%d), "
@@ -1291,13 +1414,23 @@ void VirtualGPU::dispatchBarrierValuePacket(uint16_t packetHeader, bool resolveD
   uint64_t index = hsa_queue_add_write_index_screlease(gpu_queue_, 1);
   uint64_t read = hsa_queue_load_read_index_relaxed(gpu_queue_);
 
-  while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask);
+  if ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask) {
+    flushDoorbell();
+    const uint64_t start = ROC_QUEUE_STATS ? amd::Os::timeNanos() : 0;
+    while ((index - hsa_queue_load_read_index_scacquire(gpu_queue_)) >= queueMask);
+    if (ROC_QUEUE_STATS) {
+      Telemetry().QueueFullStall(amd::Os::timeNanos() - start);
+    }
+  }
+  if (ROC_QUEUE_STATS && Telemetry().Packet(index - read, true)) {
+    LogQueueStats();
+  }
   hsa_amd_barrier_value_packet_t* aql_loc = &(reinterpret_cast<hsa_amd_barrier_value_packet_t*>(
       gpu_queue_->base_address))[index & queueMask];
   *aql_loc = barrier_value_packet_;
   packet_store_release(reinterpret_cast<uint32_t*>(aql_loc), packetHeader, rest);
 
-  hsa_signal_store_screlease(gpu_queue_->doorbell_signal, index);
+  doorbell_.Ring(index);
 
   ClPrint(amd::LOG_DEBUG, amd::LOG_AQL,
           "SWq=0x%zx, HWq=0x%zx, id=%d, BarrierValue Header = 0x%x AmdFormat = 0x%x "
@@ -1365,8 +1498,10 @@ VirtualGPU::VirtualGPU(Device& device, bool profiling, bool cooperative,
       schedulerQueue_(nullptr),
       schedulerSignal_({0}),
       barriers_(*this),
-      managed_buffer_(*this, ManagedBuffer::kPoolNumSignals * device.settings().stagedXferSize_),
-      managed_kernarg_buffer_(*this, device.settings().kernargPoolSize_),
+      managed_buffer_(*this, ManagedBuffer::kPoolNumSignals * device.settings().stagedXferSize_,
+                      ManagedBuffer::kPoolNumSignals, false),
+      managed_kernarg_buffer_(*this, device.settings().kernargPoolSize_,
+                              ManagedBuffer::kDispatchRetirePoints, true),
       cuMask_(cuMask),
       priority_(priority),
       copy_command_type_(0),
@@ -1418,6 +1553,10 @@ VirtualGPU::VirtualGPU(Device& device, bool profiling, bool cooperative,
 VirtualGPU::~VirtualGPU() {
   delete blitMgr_;
 
+  if (ROC_QUEUE_STATS && (gpu_queue_ != nullptr)) {
+    LogQueueStats();
+  }
+
   if (tracking_created_) {
     // Release the resources of signal
     releaseGpuMemoryFence();
@@ -1522,7 +1661,7 @@ bool VirtualGPU::create() {
 
 // ================================================================================================
 VirtualGPU::ManagedBuffer::~ManagedBuffer() {
-  for (auto& it : pool_signal_) {
+  for (auto& it : signals_) {
     if (it.handle != 0) {
       hsa_signal_destroy(it);
     }
@@ -1534,8 +1673,7 @@ VirtualGPU::ManagedBuffer::~ManagedBuffer() {
 
 // ================================================================================================
 bool VirtualGPU::ManagedBuffer::Create(Device::MemorySegment mem_segment) {
-  pool_chunk_end_ = pool_size_ / kPoolNumSignals;
-  active_chunk_ = 0;
+  ResetPool();
   // Allocate memory for managed buffer
   if (mem_segment == Device::MemorySegment::kKernArg &&
       (gpu_.dev().settings().kernel_arg_impl_ != KernelArgImpl::HostKernelArgs) &&
@@ -1555,11 +1693,16 @@ bool VirtualGPU::ManagedBuffer::Create(Device::MemorySegment mem_segment) {
     return false;
   }
   hsa_agent_t agent = gpu_.dev().getBackendDevice();
-  for (auto& it : pool_signal_) {
+  for (auto& it : signals_) {
     if (HSA_STATUS_SUCCESS != hsa_signal_create(0, 1, &agent, &it)) {
       return false;
     }
   }
+  std::vector<uint64_t> handles;
+  for (const auto& it : signals_) {
+    handles.push_back(it.handle);
+  }
+  ring_.Init(reinterpret_cast<uintptr_t>(pool_base_), handles);
   return true;
 }
 
@@ -1570,44 +1713,77 @@ address VirtualGPU::ManagedBuffer::Acquire(uint32_t size) {
 }
 
 // ================================================================================================
-address VirtualGPU::ManagedBuffer::Acquire(uint32_t size, uint32_t alignment) {
-  assert(alignment != 0);
-  address result = nullptr;
-  result = amd::alignUp(pool_base_ + pool_cur_offset_, alignment);
-  const size_t pool_new_usage = (result + size) - pool_base_;
-  if (pool_new_usage <= pool_chunk_end_) {
-    pool_cur_offset_ = pool_new_usage;
-    return result;
-  } else {
-    // Reset the signal for the barrier packet
-    hsa_signal_silent_store_relaxed(pool_signal_[active_chunk_], kInitSignalValueOne);
-    ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Issue barrier to flush chunk %d", active_chunk_);
-    // Currently don't skip wait signal check, because SDMA engine cna be used in staging copy
-    constexpr bool kSkipSignal = false;
-    // Dispatch a barrier packet into the queue
-    gpu_.dispatchBarrierPacket(kBarrierPacketHeader, kSkipSignal, pool_signal_[active_chunk_]);
-    // Get the next chunk
-    active_chunk_ = ++active_chunk_ % kPoolNumSignals;
-    // Make sure the new active chunk is free
-    bool test = WaitForSignal(pool_signal_[active_chunk_], gpu_.ActiveWait());
-    assert(test && "Runtime can't fail a wait for chunk!");
-    // Make sure the current offset matches the new chunk to avoid possible overlaps
-    // between chunks and issues during recycle
-    pool_cur_offset_ = (active_chunk_ == 0) ? 0 : pool_chunk_end_;
-    pool_chunk_end_ = pool_cur_offset_ + pool_size_ / kPoolNumSignals;
-    result = amd::alignUp(pool_base_ + pool_cur_offset_, alignment);
-    pool_cur_offset_ = (result + size) - pool_base_;
-  }
+bool VirtualGPU::ManagedBuffer::IsDone(uint64_t signal) {
+  return hsa_signal_load_relaxed(hsa_signal_t{signal}) == 0;
+}
+
+// ================================================================================================
+void VirtualGPU::ManagedBuffer::Arm(uint64_t signal) {
+  hsa_signal_silent_store_relaxed(hsa_signal_t{signal}, kInitSignalValueOne);
+}
 
-  return result;
+// ================================================================================================
+bool VirtualGPU::ManagedBuffer::Wait(uint64_t signal) {
+  // The retire points may belong to the packets with the deferred doorbell
+  gpu_.flushDoorbell();
+  return WaitForSignal(hsa_signal_t{signal}, gpu_.ActiveWait());
 }
 
+// ================================================================================================
+void VirtualGPU::ManagedBuffer::Barrier(uint64_t signal) {
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Issue barrier for the ring retire point");
+  // Currently don't skip wait signal check, because SDMA engine cna be used in staging copy
+  constexpr bool kSkipSignal = false;
+  // Dispatch a barrier packet into the queue
+  gpu_.dispatchBarrierPacket(kBarrierPacketHeader, kSkipSignal, hsa_signal_t{signal});
+}
 
 // ================================================================================================
-void VirtualGPU::ManagedBuffer::ResetPool() {
-  pool_cur_offset_ = 0;
-  pool_chunk_end_ = pool_size_ / kPoolNumSignals;
-  active_chunk_ = 0;
+void VirtualGPU::ManagedBuffer::RecycleWait(uint64_t required_tail) {
+  ClPrint(amd::LOG_INFO, amd::LOG_KERN, "Wait for the ring offset %lu retire", required_tail);
+  // The dispatch retired ring holds the kernel arguments
+  if (ROC_QUEUE_STATS && dispatch_retire_) {
+    gpu_.Telemetry().KernargRecycle();
+  }
+}
+
+// ================================================================================================
+void VirtualGPU::LogQueueStats() const {
+  device::QueueStats stats;
+  if (!GetQueueStats(&stats)) {
+    return;
+  }
+  // Print only the used buckets as "bucket:count" pairs
+  auto histogram = [](const uint64_t* buckets) {
+    std::string result;
+    for (uint32_t i = 0; i < device::QueueStats::kHistogramBuckets; ++i) {
+      if (buckets[i] != 0) {
+        result += std::to_string(i) + ":" + std::to_string(buckets[i]) + " ";
+      }
+    }
+    return result;
+  };
+  ClPrint(amd::LOG_INFO, amd::LOG_QUEUE,
+          "HWq=0x%zx stats: packets=%lu barriers=%lu max_fill=%lu full_stalls=%lu "
+          "full_ms=%.3f signal_waits=%lu signal_wait_ms=%.3f kernarg_recycles=%lu "
+          "max_signals=%lu fill_log2=[%s] full_us_log2=[%s] signal_wait_us_log2=[%s]",
+          stats.queueId_, stats.packets_, stats.barrierPackets_, stats.maxFillLevel_,
+          stats.queueFullStalls_, stats.queueFullNs_ / 1e6, stats.signalWaits_,
+          stats.signalWaitNs_ / 1e6, stats.kernargRecycles_, stats.maxSignals_,
+          histogram(stats.fillLevel_).c_str(), histogram(stats.queueFullUs_).c_str(),
+          histogram(stats.signalWaitUs_).c_str());
+}
+
+// ================================================================================================
+bool VirtualGPU::GetQueueStats(device::QueueStats* stats) const {
+  if (!ROC_QUEUE_STATS) {
+    return false;
+  }
+  Telemetry().Get(stats);
+  stats->queueId_ = gpu_queue_->id;
+  stats->queueSize_ = gpu_queue_->size;
+  stats->maxSignals_ = barriers_.HighWaterMark();
+  return true;
 }
 
 // ================================================================================================
@@ -1615,6 +1791,14 @@ void* VirtualGPU::allocKernArg(size_t size, size_t alignment) {
   return managed_kernarg_buffer_.Acquire(size, alignment);
 }
 
+// ================================================================================================
+void* VirtualGPU::allocPersistentKernArg(size_t size, size_t alignment) {
+  if ((currCmd_ != nullptr) && currCmd_->getPktCapturingState()) {
+    return currCmd_->getKernArgOffset(size, alignment);
+  }
+  return allocKernArg(size, alignment);
+}
+
 // ================================================================================================
 address VirtualGPU::allocKernelArguments(size_t size, size_t alignment) {
   if (ROC_SKIP_KERNEL_ARG_COPY) {
@@ -2841,6 +3025,21 @@ void VirtualGPU::submitBatchMemoryOperation(amd::BatchMemoryOperationCommand& cm
   }
   profilingEnd(cmd);
 }
+// ================================================================================================
+void VirtualGPU::submitBatchCopyFill(amd::BatchCopyFillCommand& cmd) {
+  // Make sure VirtualGPU has an exclusive access to the resources
+  amd::ScopedLock lock(execution());
+  profilingBegin(cmd);
+
+  const auto& entries = cmd.entries();
+  bool result = blitMgr().batchCopyFill(entries.data(), static_cast<uint32_t>(entries.size()));
+  if (!result) {
+    LogError("submitBatchCopyFill failed!");
+    cmd.setStatus(CL_INVALID_OPERATION);
+  }
+  profilingEnd(cmd);
+}
+
 // ================================================================================================
 void VirtualGPU::submitVirtualMap(amd::VirtualMapCommand& vcmd) {
   // Make sure VirtualGPU has an exclusive access to the resources
@@ -2869,7 +3068,8 @@ void VirtualGPU::submitVirtualMap(amd::VirtualMapCommand& vcmd) {
     hsa_amd_vmem_alloc_handle_t opaque_hsa_handle;
     opaque_hsa_handle.handle = phys_mem_obj->getUserData().hsa_handle;
     if ((hsa_status = hsa_amd_vmem_map(vaddr_sub_obj->getSvmPtr(), vcmd.size(),
-                        vaddr_sub_obj->getOffset(), opaque_hsa_handle, 0)) == HSA_STATUS_SUCCESS) {
+                        vaddr_sub_obj->getOffset() + vcmd.offset(), opaque_hsa_handle, 0))
+                        == HSA_STATUS_SUCCESS) {
       assert(amd::MemObjMap::FindMemObj(vcmd.ptr()) == nullptr);
       amd::MemObjMap::AddMemObj(vcmd.ptr(), vaddr_sub_obj);
       vaddr_sub_obj->getUserData().phys_mem_obj = phys_mem_obj;
@@ -3203,6 +3403,50 @@ static inline void nontemporalMemcpy(
 
 void VirtualGPU::HiddenHeapInit() { const_cast<Device&>(dev()).HiddenHeapInit(*this); }
 
+// ================================================================================================
+const hsa_kernel_dispatch_packet_t& VirtualGPU::dispatchTemplate(
+    const device::Kernel& devKernel, uint32_t dims, const amd::NDRange& local,
+    uint32_t groupSegmentSize) {
+  // Heap objects are at least 16 bytes aligned, hence skip the low bits in the index
+  const uintptr_t key = reinterpret_cast<uintptr_t>(&devKernel);
+  DispatchTemplate& entry = dispatchTemplates_[(key >> 4) % kDispatchTemplates];
+  hsa_kernel_dispatch_packet_t& packet = entry.packet_;
+
+  const uint16_t workgroupX = dims > 0 ? local[0] : 1;
+  const uint16_t workgroupY = dims > 1 ? local[1] : 1;
+  const uint16_t workgroupZ = dims > 2 ? local[2] : 1;
+  const bool usesStack = (devKernel.workGroupInfo()->usedStackSize_ & 0x1) == 0x1;
+
+  // The code object handle and the stack size can change for the same kernel address
+  if ((entry.kernel_ == &devKernel) && (entry.code_handle_ == devKernel.KernelCodeHandle()) &&
+      (!usesStack || (entry.stack_size_ == dev().StackSize())) &&
+      (packet.workgroup_size_x == workgroupX) && (packet.workgroup_size_y == workgroupY) &&
+      (packet.workgroup_size_z == workgroupZ) &&
+      (packet.group_segment_size == groupSegmentSize)) {
+    return packet;
+  }
+
+  memset(&packet, 0, sizeof(packet));
+  packet.header = kInvalidAql;
+  packet.kernel_object = devKernel.KernelCodeHandle();
+  packet.workgroup_size_x = workgroupX;
+  packet.workgroup_size_y = workgroupY;
+  packet.workgroup_size_z = workgroupZ;
+  packet.group_segment_size = groupSegmentSize;
+  packet.private_segment_size = devKernel.workGroupInfo()->privateMemSize_;
+
+  if (usesStack) {
+    packet.private_segment_size = std::min<uint64_t>(
+        std::max<uint64_t>(dev().StackSize(), packet.private_segment_size),
+        Device::kMaxStackSize);
+  }
+
+  entry.kernel_ = &devKernel;
+  entry.code_handle_ = devKernel.KernelCodeHandle();
+  entry.stack_size_ = dev().StackSize();
+  return packet;
+}
+
 // ================================================================================================
 bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes,
     const amd::Kernel& kernel, const_address parameters, void* event_handle,
@@ -3517,12 +3761,9 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes,
       return false;
     }
 
-    // Initialize the dispatch Packet
-    hsa_kernel_dispatch_packet_t dispatchPacket;
-    memset(&dispatchPacket, 0, sizeof(dispatchPacket));
-
-    dispatchPacket.header = kInvalidAql;
-    dispatchPacket.kernel_object = gpuKernel.KernelCodeHandle();
+    // Initialize the dispatch Packet from the cached template of the kernel and launch shape
+    hsa_kernel_dispatch_packet_t dispatchPacket =
+        dispatchTemplate(*devKernel, sizes.dimensions(), local, ldsUsage + sharedMemBytes);
 
     // dispatchPacket.header = aqlHeader_;
     // dispatchPacket.setup |= sizes.dimensions() << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS;
@@ -3530,19 +3771,7 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes,
     dispatchPacket.grid_size_y = sizes.dimensions() > 1 ? newGlobalSize[1] : 1;
     dispatchPacket.grid_size_z = sizes.dimensions() > 2 ? newGlobalSize[2] : 1;
 
-    dispatchPacket.workgroup_size_x = sizes.dimensions() > 0 ? local[0] : 1;
-    dispatchPacket.workgroup_size_y = sizes.dimensions() > 1 ? local[1] : 1;
-    dispatchPacket.workgroup_size_z = sizes.dimensions() > 2 ? local[2] : 1;
-
     dispatchPacket.kernarg_address = argBuffer;
-    dispatchPacket.group_segment_size = ldsUsage + sharedMemBytes;
-    dispatchPacket.private_segment_size = devKernel->workGroupInfo()->privateMemSize_;
-
-    if ((devKernel->workGroupInfo()->usedStackSize_ & 0x1) == 0x1) {
-      dispatchPacket.private_segment_size = std::min<uint64_t>(
-          std::max<uint64_t>(dev().StackSize(), dispatchPacket.private_segment_size),
-          Device::kMaxStackSize);
-    }
 
     // Pass the header accordingly
     auto aqlHeaderWithOrder = aqlHeader_;
@@ -3551,7 +3780,32 @@ bool VirtualGPU::submitKernelInternal(const amd::NDRangeContainer& sizes,
       aqlHeaderWithOrder &= kAqlHeaderMask;
     }
 
-    if (vcmd != nullptr && vcmd->getEventScope() == amd::Device::kCacheStateSystem) {
+    const bool eventSystemScope =
+        (vcmd != nullptr) && (vcmd->getEventScope() == amd::Device::kCacheStateSystem);
+
+    // An operation before the kernel (SDMA copy, image import/export, SVM prefetch) may request
+    // the system scope, which the kernel header applies for the acquire and the release.
+    // Keep the system scope acquire for the data of that operation, but use agent scope release
+    // if the kernel accesses only device local memory. Host and peer accesses of the results go
+    // through a barrier or a marker, which performs the system scope release, since the fence
+    // is marked as dirty. The queues with the system scope fences (AMD_OPT_FLUSH=0) keep them.
+    // @note: The captured packets are replayed without the fence tracking
+    if (ROC_FENCE_SCOPE_ANALYSIS && dev().settings().fenceScopeAgent_ && addSystemScope_ &&
+        !eventSystemScope && !kernelSystemScope_ && !isGraphCapture && !printfEnabled &&
+        !gpuKernel.dynamicParallelism()) {
+      constexpr uint16_t kFenceScopeMask =
+          (((1 << HSA_PACKET_HEADER_WIDTH_SCACQUIRE_FENCE_SCOPE) - 1) <<
+              HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE) |
+          (((1 << HSA_PACKET_HEADER_WIDTH_SCRELEASE_FENCE_SCOPE) - 1) <<
+              HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE);
+      aqlHeaderWithOrder &= ~kFenceScopeMask;
+      aqlHeaderWithOrder |= (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_SCACQUIRE_FENCE_SCOPE) |
+                            (HSA_FENCE_SCOPE_AGENT << HSA_PACKET_HEADER_SCRELEASE_FENCE_SCOPE);
+      addSystemScope_ = false;
+      fence_dirty_ = true;
+    }
+
+    if (eventSystemScope) {
       addSystemScope_ = true;
     }
 
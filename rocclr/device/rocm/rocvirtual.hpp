@@ -30,7 +30,12 @@
 #include "rocprintf.hpp"
 #include "hsa/hsa_ven_amd_aqlprofile.h"
 #include "rocsched.hpp"
+#include "rocdoorbell.hpp"
+#include "rocring.hpp"
 #include "device/device.hpp"
+#include <array>
+#include <deque>
+#include <map>
 #include <stack>
 
 namespace amd::roc {
@@ -176,14 +181,27 @@ class Timestamp : public amd::ReferenceCountedObject {
 
 class VirtualGPU : public device::VirtualDevice {
  public:
-  class ManagedBuffer : public amd::EmbeddedObject {
+  //! Ring buffer of the memory, used by the queue operations. The regions are reclaimed
+  //! in the allocation order with the retire points. A retire point is the ring offset and
+  //! an HSA signal, which completes when all operations before the offset are done.
+  //! The retire points are attached to the dispatches as their completion signals, or
+  //! issued as barrier packets, hence a full ring waits only for the oldest retire point.
+  class ManagedBuffer : public amd::EmbeddedObject, private RetireSource {
   public:
-    //! The number of chunks the arg pool will be divided
+    //! The number of chunks the staging pool will be divided
     static constexpr uint32_t kPoolNumSignals = 4;
-    ManagedBuffer(VirtualGPU& gpu, uint32_t pool_size)
+    //! The number of retire points for the dispatch reclaimed buffer
+    static constexpr uint32_t kDispatchRetirePoints = 16;
+
+    //! If dispatch_retire is true, then the retire points are attached to the dispatches,
+    //! otherwise a barrier packet is issued for every 1/num_retire_points of the pool
+    ManagedBuffer(VirtualGPU& gpu, uint32_t pool_size, uint32_t num_retire_points,
+                  bool dispatch_retire)
       : gpu_(gpu)
       , pool_size_(pool_size)
-      , pool_signal_(kPoolNumSignals) {}
+      , dispatch_retire_(dispatch_retire)
+      , signals_(num_retire_points)
+      , ring_(*this, pool_size, num_retire_points, dispatch_retire) {}
     ~ManagedBuffer();
 
     //! Allocates all necessary resources to manage memory
@@ -193,33 +211,47 @@ class VirtualGPU : public device::VirtualDevice {
     address Acquire(uint32_t size);
 
     //! Acquires custom aligned memory for use on the gpu
-    address Acquire(uint32_t size, uint32_t alignment);
+    address Acquire(uint32_t size, uint32_t alignment) {
+      return reinterpret_cast<address>(ring_.Acquire(size, alignment));
+    }
+
+    //! Returns the signal for a new retire point, completed with the dispatch, or
+    //! a null signal if the retire point isn't required.
+    //! The dispatch must have the barrier bit, so its completion covers all previous work
+    hsa_signal_t DispatchRetireSignal() { return hsa_signal_t{ring_.DispatchRetireSignal()}; }
 
     //! Reset mem pool
-    void ResetPool();
+    void ResetPool() { ring_.Reset(); }
 
   private:
-    VirtualGPU& gpu_;                 //!< Queue object for ROCm device
-    address   pool_base_ = nullptr;   //!< Memory pool base address
-    uint32_t  pool_size_;             //!< Memory pool base size
-    uint32_t  pool_chunk_end_ = 0;    //!< The end offset of the current chunk
-    uint32_t  active_chunk_ = 0;      //!< The index of the current active chunk
-    uint32_t  pool_cur_offset_ = 0;   //!< Current active offset for update
-    std::vector<hsa_signal_t> pool_signal_; //!< Pool of HSA signals to manage multiple chunks
+    //! RetireSource interface with HSA signals and barrier packets of the queue
+    bool IsDone(uint64_t signal) override;
+    void Arm(uint64_t signal) override;
+    bool Wait(uint64_t signal) override;
+    void Barrier(uint64_t signal) override;
+    void RecycleWait(uint64_t required_tail) override;
+
+    VirtualGPU& gpu_;                   //!< Queue object for ROCm device
+    address   pool_base_ = nullptr;     //!< Memory pool base address
+    uint32_t  pool_size_;               //!< Memory pool base size
+    bool      dispatch_retire_;         //!< The retire points are attached to the dispatches
+    std::vector<hsa_signal_t> signals_; //!< HSA signals for the retire points
+    RetireRing ring_;                   //!< Ring allocator of the pool
   };
+
+  //! Tracks the memory ranges, accessed by the kernels in the queue since the last barrier.
+  //! The ranges of the previous kernels are kept disjoint in a sorted map, hence the overlap
+  //! query is logarithmic in the number of tracked ranges and the capacity isn't limited.
   class MemoryDependency : public amd::EmbeddedObject {
    public:
     //! Default constructor
-    MemoryDependency()
-        : memObjectsInQueue_(nullptr), numMemObjectsInQueue_(0), maxMemObjectsInQueue_(0) {}
-
-    ~MemoryDependency() { delete[] memObjectsInQueue_; }
+    MemoryDependency() : enabled_(false) {}
 
     //! Creates memory dependecy structure
     bool create(size_t numMemObj);
 
     //! Notify the tracker about new kernel
-    void newKernel() { endMemObjectsInQueue_ = numMemObjectsInQueue_; }
+    void newKernel();
 
     //! Validates memory object on dependency
     void validate(VirtualGPU& gpu, const Memory* memory, bool readOnly);
@@ -227,8 +259,8 @@ class VirtualGPU : public device::VirtualDevice {
     //! Clear memory dependency
     void clear(bool all = true);
 
-    //! Max number of mem objects in the queue
-    size_t maxMemObjectsInQueue() const { return maxMemObjectsInQueue_; }
+    //! Returns true if the dependency tracking is enabled
+    bool enabled() const { return enabled_; }
 
    private:
     struct MemoryState {
@@ -237,10 +269,20 @@ class VirtualGPU : public device::VirtualDevice {
       bool readOnly_;   //! Current GPU state in the queue
     };
 
-    MemoryState* memObjectsInQueue_;  //!< Memory object state in the queue
-    size_t endMemObjectsInQueue_;     //!< End of mem objects in the queue
-    size_t numMemObjectsInQueue_;     //!< Number of mem objects in the queue
-    size_t maxMemObjectsInQueue_;     //!< Maximum number of mem objects in the queue
+    struct BusyRange {
+      uint64_t end_;    //! Busy memory end address
+      bool readOnly_;   //! All accesses to the range were read only
+    };
+
+    //! Returns true if the range conflicts with a busy range of the previous kernels
+    bool isBusy(uint64_t start, uint64_t end, bool readOnly) const;
+
+    //! Adds the range into the busy map, merging it with the overlapped ranges
+    void addBusyRange(const MemoryState& range);
+
+    bool enabled_;                              //!< Dependency tracking is enabled
+    std::map<uint64_t, BusyRange> busyRanges_;  //!< Disjoint ranges of the previous kernels
+    std::vector<MemoryState> kernelRanges_;     //!< Ranges of the current kernel
   };
 
   class HwQueueTracker : public amd::EmbeddedObject {
@@ -280,6 +322,9 @@ class VirtualGPU : public device::VirtualDevice {
     //! Get the last active signal on the queue
     ProfilingSignal* GetLastSignal() const { return signal_list_[current_id_]; }
 
+    //! Returns the maximum number of the signals in flight
+    size_t HighWaterMark() const { return high_water_mark_.load(std::memory_order_relaxed); }
+
     //! Clear external signals
     void ClearExternalSignals() { external_signals_.clear(); }
 
@@ -307,11 +352,19 @@ class VirtualGPU : public device::VirtualDevice {
     //! Wait for the provided signal
     bool CpuWaitForSignal(ProfilingSignal* signal);
 
+    //! Returns a retired signal from the pool or a new signal
+    ProfilingSignal* FreeSignal();
+
+    //! Moves the retired signal from the list into the pool
+    void RecycleSignal(size_t id);
+
     HwQueueEngine engine_ = HwQueueEngine::Unknown; //!< Engine used in the current operations
     std::stack<ProfilingSignal*> signal_pool_irq_;  //!< The pool of free signals with interrupts
     std::stack<ProfilingSignal*> signal_pool_;      //!< The pool of free signals without interrupt
     std::vector<ProfilingSignal*> signal_list_;     //!< The pool of all signals for processing
     size_t current_id_ = 0;       //!< Last submitted signal
+    //! The maximum size of the signal list. The telemetry query reads it without the lock
+    std::atomic<size_t> high_water_mark_{0};
     bool sdma_profiling_ = false; //!< If TRUE, then SDMA profiling is enabled
     const VirtualGPU& gpu_;       //!< VirtualGPU, associated with this tracker
     std::vector<ProfilingSignal*> external_signals_; //!< External signals for a wait in this queue
@@ -357,6 +410,7 @@ class VirtualGPU : public device::VirtualDevice {
   void submitFillMemory(amd::FillMemoryCommand& cmd);
   void submitStreamOperation(amd::StreamOperationCommand& cmd);
   void submitBatchMemoryOperation(amd::BatchMemoryOperationCommand& cmd);
+  void submitBatchCopyFill(amd::BatchCopyFillCommand& cmd);
   void submitVirtualMap(amd::VirtualMapCommand& cmd);
   void submitMigrateMemObjects(amd::MigrateMemObjectsCommand& cmd);
 
@@ -403,6 +457,19 @@ class VirtualGPU : public device::VirtualDevice {
                          std::vector<device::Memory*>& wrtBackImageBuffer //!< Images for writeback
                          );
 
+  //! Returns true if the memory object is visible only to this agent, hence the kernel access
+  //! doesn't require a system scope release
+  bool isAgentLocalMemory(amd::Memory& mem) const;
+
+  //! Returns the dispatch packet with all fields, which depend only on the kernel and
+  //! the launch shape. The caller patches the grid size and the kernel arguments address
+  const hsa_kernel_dispatch_packet_t& dispatchTemplate(
+      const device::Kernel& devKernel,  //!< Device kernel for execution
+      uint32_t dims,                    //!< Number of launch dimensions
+      const amd::NDRange& local,        //!< Workgroup size
+      uint32_t groupSegmentSize         //!< LDS usage, including the dynamic LDS
+      );
+
   //! Returns a managed buffer for staging copies
   ManagedBuffer& Staging() { return managed_buffer_; }
 
@@ -430,6 +497,8 @@ class VirtualGPU : public device::VirtualDevice {
   Timestamp* timestamp() const { return timestamp_; }
 
   void* allocKernArg(size_t size, size_t alignment);
+  //! Allocates kernel arg memory, which stays valid for the replays of the captured packets
+  void* allocPersistentKernArg(size_t size, size_t alignment);
   bool isFenceDirty() const { return fence_dirty_; }
   void HiddenHeapInit();
 
@@ -440,7 +509,30 @@ class VirtualGPU : public device::VirtualDevice {
   //! Analyzes a crashed AQL queue to find a broken AQL packet
   void AnalyzeAqlQueue() const;
 
+  //! Opens a doorbell batch window. The window holds the execution lock until it's closed
+  void BeginDoorbellBatch();
+  //! Closes the doorbell batch window and rings the deferred doorbell
+  void EndDoorbellBatch();
+  //! Rings the deferred doorbell, must be called before any wait for the queue progress
+  void flushDoorbell() const { doorbell_.Flush(); }
+
+  //! Returns the queue telemetry
+  device::QueueTelemetry& Telemetry() const { return telemetry_; }
+  //! Returns the queue telemetry. Returns false if ROC_QUEUE_STATS is disabled
+  virtual bool GetQueueStats(device::QueueStats* stats) const;
+
  private:
+  //! Prints the queue telemetry into the log
+  void LogQueueStats() const;
+
+  //! Stores the write index into the doorbell signal of the queue
+  struct DoorbellRing {
+    const VirtualGPU& gpu_;
+    void operator()(uint64_t index) const {
+      hsa_signal_store_screlease(gpu_.gpu_queue_->doorbell_signal, index);
+    }
+  };
+
   //! Dispatches a barrier with blocking HSA signals
   void dispatchBlockingWait();
 
@@ -523,6 +615,7 @@ class VirtualGPU : public device::VirtualDevice {
       uint32_t addSystemScope_        : 1; //!< Insert a system scope to the next aql
       uint32_t tracking_created_      : 1; //!< Enabled if tracking object was properly initialized
       uint32_t retainExternalSignals_ : 1; //!< Indicate to retain external signal array
+      uint32_t kernelSystemScope_     : 1; //!< Current kernel accesses memory outside the agent
     };
     uint32_t  state_;
   };
@@ -578,8 +671,25 @@ class VirtualGPU : public device::VirtualDevice {
 
   std::atomic<uint> lastUsedSdmaEngineMask_;     //!< Last Used SDMA Engine mask
 
+  //! Deferred doorbell rings of the batch windows
+  mutable DoorbellBatch<DoorbellRing> doorbell_{DoorbellRing{*this}};
+
+  //! Queue occupancy and stall telemetry, collected with ROC_QUEUE_STATS
+  mutable device::QueueTelemetry telemetry_{ROC_QUEUE_STATS_INTERVAL};
+
   using KernelArgImpl = device::Settings::KernelArgImpl;
 
   amd::Command* currCmd_ = nullptr;  //!< Current command under capture
+
+  //! Pre-filled dispatch packet for a kernel and a launch shape
+  struct DispatchTemplate {
+    const device::Kernel* kernel_ = nullptr;  //!< Device kernel of the template
+    uint64_t code_handle_ = 0;        //!< Code object handle, detects a reused kernel address
+    uint64_t stack_size_ = 0;         //!< Device stack size at the template creation
+    hsa_kernel_dispatch_packet_t packet_ = {};  //!< Packet with the invariant fields
+  };
+  static constexpr uint32_t kDispatchTemplates = 64;  //!< Number of the cached templates
+  //! Direct mapped cache of the dispatch templates, indexed by the kernel address
+  std::array<DispatchTemplate, kDispatchTemplates> dispatchTemplates_;
 };
 }
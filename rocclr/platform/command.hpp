@@ -928,6 +928,35 @@ class BatchMemoryOperationCommand : public Command {
   size_t paramSize_;        // !< size in bytes of the param array passed
 };
 
+//! Entry of the batched copy and fill operation. The layout matches the blit kernel argument
+struct BatchCopyFillEntry {
+  uint64_t dst_;          //!< Destination device address
+  uint64_t src_;          //!< Source device address for the copy or the fill value
+  uint64_t size_;         //!< Size of the operation in bytes
+  uint64_t elementSize_;  //!< Fill element size in bytes (1, 2 or 4), 0 for the copy
+};
+
+/*! \brief      Small device copies and fills in a single blit dispatch
+ *
+ *  \details    All operations run concurrently, hence the destination ranges must not
+ *              overlap with any other range in the batch.
+ */
+class BatchCopyFillCommand : public Command {
+ public:
+  BatchCopyFillCommand(HostQueue& queue, EventWaitList& eventWaitList,
+                       std::vector<BatchCopyFillEntry>&& entries)
+      : Command(queue, ROCCLR_COMMAND_BATCH_COPY_FILL, eventWaitList),
+        entries_(std::move(entries)) {}
+
+  virtual void submit(device::VirtualDevice& device) { device.submitBatchCopyFill(*this); }
+
+  //! Returns the operations of the batch
+  const std::vector<BatchCopyFillEntry>& entries() const { return entries_; }
+
+ private:
+  std::vector<BatchCopyFillEntry> entries_;  //!< Operations of the batch
+};
+
 /*! \brief      A generic copy memory command
  *
  *  \details    Used for both buffers and images. Backends are expected
@@ -1839,15 +1868,17 @@ class VirtualMapCommand : public Command {
 protected:
   Memory* memory_;  //!< Memory to map, nullptr means unmap
   size_t size_;     //!< Size of the mapping in bytes
+  size_t offset_;   //!< Offset in the memory to map
 
 public:
   //! Construct a new VirtualMapCommand
   VirtualMapCommand(HostQueue& queue, const EventWaitList& eventWaitList,
-                   void* ptr, size_t size, Memory* memory)
+                   void* ptr, size_t size, Memory* memory, size_t offset = 0)
       : Command(queue, 1, eventWaitList),
         ptr_(ptr),
         size_(size),
-        memory_(memory) {
+        memory_(memory),
+        offset_(offset) {
     // Sanity checks
     assert(size > 0 && "invalid");
     if (memory_) memory_->retain();
@@ -1867,6 +1898,8 @@ public:
   size_t size() const { return size_; }
   //! Read the pointer
   const void* ptr() const { return ptr_; }
+  //! Read the offset in the memory
+  size_t offset() const { return offset_; }
 };
 
 //! Union used in memory suballocator, must be updated with the new commands
@@ -1899,6 +1932,7 @@ union ComputeCommand {
   SvmPrefetchAsyncCommand       cmd26;
   VirtualMapCommand             cmd27;
   BatchMemoryOperationCommand   cmd28;
+  BatchCopyFillCommand          cmd29;
   ComputeCommand() {}
   ~ComputeCommand() {}
 };
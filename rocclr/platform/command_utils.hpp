@@ -25,6 +25,7 @@
 #define ROCCLR_COMMAND_STREAM_WAIT_VALUE 0x4501
 #define ROCCLR_COMMAND_STREAM_WRITE_VALUE 0x4502
 #define ROCCLR_COMMAND_BATCH_STREAM 0x4503
+#define ROCCLR_COMMAND_BATCH_COPY_FILL 0x4504
 
 // Stream Wait Value Conidtions
 #define ROCCLR_STREAM_WAIT_VALUE_GTE 0x0
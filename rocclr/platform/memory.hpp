@@ -154,6 +154,7 @@ class Memory : public amd::RuntimeObject {
      amd::Memory* vaddr_mem_obj = nullptr; //<! Virtual address mem obj, only set on virtual mem
      uint64_t hsa_handle = 0; //!<Opaque hsa handle saved for Virtual memories
      unsigned int flags = 0; //!< HIP memory flags
+     void* mem_pool = nullptr; //!< HIP memory pool, which owns the allocation
      //! hipMallocPitch allocates buffer using width & height and returns pitch & device pointer.
      //! Since device pointer is void*, It looses the values of width & height used for allocation.
      //! Memory object has total size however it's pitch * height * depth and its not straight forward to
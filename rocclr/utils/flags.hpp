@@ -87,7 +87,7 @@ release(size_t, GPU_RESOURCE_CACHE_SIZE, 64,                                  \
 release(size_t, GPU_MAX_SUBALLOC_SIZE, 4096,                                  \
         "The maximum size accepted for suballocations in KB")                 \
 release(size_t, GPU_NUM_MEM_DEPENDENCY, 256,                                  \
-        "Number of memory objects for dependency tracking")                   \
+        "Initial number of tracked memory objects, 0 disables the tracking")  \
 release(size_t, GPU_XFER_BUFFER_SIZE, 0,                                      \
         "Transfer buffer size for image copy optimization in KB")             \
 release(bool, GPU_IMAGE_DMA, true,                                            \
@@ -202,6 +202,10 @@ release(bool, HIP_MEM_POOL_SUPPORT, true,                                     \
         "Enables memory pool support in HIP")                                 \
 release(bool, HIP_MEM_POOL_USE_VM, true,                                      \
         "Enables memory pool support in HIP")                                 \
+release(uint, HIP_MEM_POOL_CHUNK_SIZE, 0,                                     \
+        "Size in MB of memory pool chunks for small allocations, 0 = off")    \
+release(bool, HIP_MEM_POOL_STREAM_CACHE, false,                               \
+        "Enables per-stream caches of freed allocations in memory pools")     \
 release(bool, PAL_HIP_IPC_FLAG, true,                                         \
         "Enable interprocess flag for device allocation in PAL HIP")          \
 release(uint, PAL_FORCE_ASIC_REVISION, 0,                                     \
@@ -223,6 +227,18 @@ release(uint, ROC_AQL_QUEUE_SIZE, 16384,                                      \
         "AQL queue size in AQL packets")                                      \
 release(uint, ROC_SIGNAL_POOL_SIZE, 64,                                       \
         "Initial size of HSA signal pool")                                    \
+release(uint, ROC_SIGNAL_POOL_MAX_SIZE, 4096,                                 \
+        "Maximum size of HSA signal pool, grown on demand")                   \
+release(bool, ROC_BATCH_DOORBELL, false,                                      \
+        "Ring the doorbell once for a batch of consecutive AQL packets")      \
+release(bool, ROC_FENCE_SCOPE_ANALYSIS, false,                                \
+        "Use agent scope release for the kernels, which access only "         \
+        "device local memory, after an operation with the system scope")      \
+release(bool, ROC_QUEUE_STATS, false,                                         \
+        "Collect the AQL queue occupancy and stall telemetry")                \
+release(uint, ROC_QUEUE_STATS_INTERVAL, 0,                                    \
+        "Interval in ms of the queue telemetry log, "                         \
+        "0 = log on the queue destruction only")                              \
 release(uint, DEBUG_CLR_LIMIT_BLIT_WG, 16,                                    \
         "Limit the number of workgroups in blit operations")                  \
 release(bool, DEBUG_CLR_BLIT_KERNARG_OPT, false,                              \
@@ -255,6 +271,18 @@ release(bool, DEBUG_HIP_FORCE_ASYNC_QUEUE, false,                             \
         "Forces grpahs into async queue mode. DEBUG_HIP_FORCE_GRAPH_QUEUES must be 1") \
 release(uint, DEBUG_HIP_FORCE_GRAPH_QUEUES, 4,                                \
         "Forces the number of streams for the graph parallel execution")      \
+release(bool, DEBUG_HIP_GRAPH_LIST_SCHEDULER, false,                          \
+        "Use critical path list scheduling for the graph stream assignment")  \
+release(uint, DEBUG_HIP_GRAPH_INSTANTIATE_CACHE, 0,                           \
+        "Number of destroyed graph execs cached for reuse, 0 - disabled")     \
+release(bool, DEBUG_HIP_GRAPH_TRANSITIVE_REDUCTION, false,                    \
+        "Remove the transitively implied edges of the instantiated graphs")   \
+release(uint, DEBUG_HIP_GRAPH_BLIT_FUSION_SIZE, 0,                            \
+        "Max size of graph memset/memcpy fused into batched blits, 0 - off")  \
+release(bool, DEBUG_HIP_GRAPH_MEM_ALIASING, false,                            \
+        "Pack graph allocations with disjoint lifetimes into one backing")    \
+release(uint, DEBUG_HIP_GRAPH_CAPTURE_THREADS, 0,                             \
+        "Max threads for the AQL packet capture of large graphs, 0 - off")    \
 release(bool, HIP_ALWAYS_USE_NEW_COMGR_UNBUNDLING_ACTION, false,              \
         "Force to always use new comgr unbundling action")                    \
 release(uint, DEBUG_HIP_BLOCK_SYNC, 50,                                       \
@@ -0,0 +1,508 @@
+/* Copyright (c) 2024 Advanced Micro Devices, Inc.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE. */
+
+#ifndef RANGEMAP_HPP_
+#define RANGEMAP_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <new>
+#include <utility>
+#include <vector>
+
+//! \addtogroup Utils
+
+namespace amd { /*@{*/
+
+/*! \brief A radix map of address ranges with lock-free lookups.
+ *
+ * The radix tree has the page table layout: 4 levels of 512 slots over 48 bits of
+ * the address space with 4KB pages. A slot, fully covered by a range, references the range
+ * record directly, hence a large range updates only the slots on its edges. A page, partially
+ * covered by ranges, references a bucket with all ranges on that page.
+ *
+ * The lookups don't take any lock and don't write shared memory. The updates must be
+ * serialized by the caller. The records are type stable: the retired records are recycled
+ * through the free lists and freed only with the map, hence a stale record is always readable.
+ * A record has a sequence number, bumped on every reuse, and a lookup validates
+ * the sequence and the slot after it reads the record, like a seqlock reader.
+ * The nodes are never unlinked.
+ *
+ * The pages with too many ranges, the addresses above 48 bits and the overlapping ranges
+ * aren't indexed. Then find() fails and the caller must search its own locked structure.
+ * The caller resolves an address through the closest range, which begins before it, hence
+ * an unindexed range also hides the rest of the indexed range, which covers its start.
+ * A separate overflow tree marks only the pages of these shadows, so the lookups of other
+ * pages stay lock-free. The map depends only on the standard library, so it's unit tested
+ * on the host.
+ */
+template <typename T> class ConcurrentRangeMap {
+  static constexpr uint32_t kPageShift = 12;  //!< 4KB pages
+  static constexpr uint32_t kLevelBits = 9;   //!< 512 slots in a node
+  static constexpr uint32_t kLevels = 4;      //!< The number of levels in the tree
+  static constexpr size_t kSlots = size_t(1) << kLevelBits;
+  static constexpr uintptr_t kMaxAddress = uintptr_t(1) << (kPageShift + kLevelBits * kLevels);
+
+  //! A slot is empty, a 4KB aligned node, a record with the capacity tag or the overflow marker
+  static constexpr uintptr_t kTagMask = 7;
+  static constexpr uintptr_t kOverflow = 4;
+
+  struct Range {
+    std::atomic<uintptr_t> start_;  //!< The first address of the range
+    std::atomic<uintptr_t> end_;    //!< The address after the range
+    std::atomic<T*> value_;         //!< The value of the range
+  };
+
+  //! A record with up to N ranges
+  template <uint32_t N> struct Record {
+    Record() : seq_(0), count_(0) {
+      for (auto& range : ranges_) {
+        range.start_.store(0, std::memory_order_relaxed);
+        range.end_.store(0, std::memory_order_relaxed);
+        range.value_.store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    std::atomic<uint64_t> seq_;    //!< Odd while the record is written
+    std::atomic<uint32_t> count_;  //!< The number of valid ranges
+    Range ranges_[N];              //!< Ranges, sorted by the start address
+  };
+
+  //! Records have 3 capacities, the tag in the slot selects the record type
+  static constexpr uint32_t kMaxRanges = 16;
+  static constexpr uint32_t kTags = 4;
+  static constexpr uintptr_t tagOf(uint32_t capacity) {
+    return (capacity == 1) ? 1 : ((capacity <= 4) ? 2 : 3);
+  }
+
+  struct Node {
+    Node() {
+      for (auto& slot : slots_) {
+        slot.store(0, std::memory_order_relaxed);
+      }
+    }
+    std::atomic<uintptr_t> slots_[kSlots];
+  };
+
+  //! Node of the overflow tree. The lookups read only the slots. The writer keeps the children
+  //! under the overflowed slots and the number of the shadows, which cover every slot
+  struct OverflowNode {
+    OverflowNode() {
+      for (size_t i = 0; i < kSlots; ++i) {
+        slots_[i].store(0, std::memory_order_relaxed);
+        children_[i] = nullptr;
+        counts_[i] = 0;
+      }
+    }
+    std::atomic<uintptr_t> slots_[kSlots];  //!< Empty, a child node or the overflow marker
+    OverflowNode* children_[kSlots];        //!< Child nodes for the partially covered slots
+    uint32_t counts_[kSlots];               //!< The number of the shadows, covering the slot
+  };
+
+  //! Writer side state of a range
+  struct Entry {
+    uintptr_t end_;     //!< The address after the range
+    T* value_;          //!< The value of the range
+    uintptr_t record_;  //!< Tagged record for the fully covered slots, created on demand
+    bool indexed_;      //!< The range is in the radix tree
+    uintptr_t shadow_;  //!< The end of the overflowed lookups of an unindexed range
+  };
+
+  //! Plain copy of a range for the record writers
+  struct PlainRange {
+    uintptr_t start_;
+    uintptr_t end_;
+    T* value_;
+  };
+
+  Node* root_;                             //!< The first level of the tree
+  OverflowNode* overflow_;                 //!< The pages, shadowed by the unindexed ranges
+  std::map<uintptr_t, Entry> ranges_;      //!< All ranges for the updates
+  std::vector<void*> free_[kTags];         //!< Retired records for every tag
+  std::vector<std::pair<void*, size_t>> blocks_;  //!< All nodes and records with the alignment
+
+  static bool isNode(uintptr_t value) { return (value != 0) && ((value & kTagMask) == 0); }
+  static uint32_t shiftOf(uint32_t level) { return kPageShift + kLevelBits * (kLevels - 1 - level); }
+
+  //! \brief Allocate an aligned block, which is freed with the map.
+  void* allocBlock(size_t size, size_t alignment);
+
+  //! \brief Return the last indexed range, which begins before the address.
+  typename std::map<uintptr_t, Entry>::iterator lastIndexed(uintptr_t address);
+
+  //! \brief Allocate a zeroed node.
+  Node* allocNode();
+
+  //! \brief Allocate an empty node of the overflow tree.
+  OverflowNode* allocOverflowNode();
+
+  //! \brief Write the ranges into a free record and return the tagged record.
+  template <uint32_t N> uintptr_t makeRecord(const PlainRange* ranges, uint32_t count);
+
+  //! \brief Return the record to the free list.
+  void retire(uintptr_t record);
+
+  //! \brief Rebuild the bucket of the page from the ranges.
+  void updatePage(std::atomic<uintptr_t>* slot, uintptr_t page);
+
+  //! \brief Map or unmap the range in the node and its children.
+  void update(Node* node, uint32_t level, uintptr_t base, uintptr_t start, Entry* entry, bool map);
+
+  //! \brief Add or remove the overflow of the pages in [start, end).
+  void updateOverflow(OverflowNode* node, uint32_t level, uintptr_t base, uintptr_t start,
+                      uintptr_t end, bool add);
+
+  //! \brief Return true if the page of the address is shadowed by an unindexed range.
+  bool isOverflow(uintptr_t address) const;
+
+  //! \brief Read the record, referenced from the slot. Return false if the lookup must retry.
+  template <uint32_t N>
+  static bool readRecord(const std::atomic<uintptr_t>* slot, uintptr_t value, uintptr_t address,
+                         T** found, uintptr_t* start);
+
+ public:
+  //! \brief Initialize an empty map.
+  ConcurrentRangeMap();
+
+  //! \brief Destroy the map and all nodes and records.
+  ~ConcurrentRangeMap();
+
+  //! \brief Insert the range [start, end). The start address must be unique.
+  void insert(uintptr_t start, uintptr_t end, T* value);
+
+  //! \brief Remove the range, which begins at the start address.
+  void remove(uintptr_t start);
+
+  //! \brief Find the range, which contains the address, without a lock.
+  //! Return false if the address isn't indexed and the caller must search its own structure.
+  bool find(uintptr_t address, T** value, uintptr_t* start) const;
+};
+
+/*@}*/
+
+template <typename T> inline ConcurrentRangeMap<T>::ConcurrentRangeMap() {
+  root_ = allocNode();
+  overflow_ = allocOverflowNode();
+}
+
+template <typename T> inline ConcurrentRangeMap<T>::~ConcurrentRangeMap() {
+  for (auto& block : blocks_) {
+    ::operator delete(block.first, std::align_val_t(block.second));
+  }
+}
+
+template <typename T>
+inline void* ConcurrentRangeMap<T>::allocBlock(size_t size, size_t alignment) {
+  void* block = ::operator new(size, std::align_val_t(alignment));
+  blocks_.push_back({block, alignment});
+  return block;
+}
+
+template <typename T>
+inline typename std::map<uintptr_t, typename ConcurrentRangeMap<T>::Entry>::iterator
+ConcurrentRangeMap<T>::lastIndexed(uintptr_t address) {
+  // The indexed ranges don't overlap, but the unindexed ones can be anywhere between them
+  for (auto it = ranges_.lower_bound(address); it != ranges_.begin();) {
+    --it;
+    if (it->second.indexed_) {
+      return it;
+    }
+  }
+  return ranges_.end();
+}
+
+template <typename T>
+inline typename ConcurrentRangeMap<T>::Node* ConcurrentRangeMap<T>::allocNode() {
+  return new (allocBlock(sizeof(Node), size_t(1) << kPageShift)) Node();
+}
+
+template <typename T>
+inline typename ConcurrentRangeMap<T>::OverflowNode* ConcurrentRangeMap<T>::allocOverflowNode() {
+  return new (allocBlock(sizeof(OverflowNode), kTagMask + 1)) OverflowNode();
+}
+
+template <typename T>
+template <uint32_t N>
+inline uintptr_t ConcurrentRangeMap<T>::makeRecord(const PlainRange* ranges, uint32_t count) {
+  constexpr uintptr_t tag = tagOf(N);
+  Record<N>* record = nullptr;
+  if (free_[tag].empty()) {
+    record = new (allocBlock(sizeof(Record<N>), kTagMask + 1)) Record<N>();
+  } else {
+    record = reinterpret_cast<Record<N>*>(free_[tag].back());
+    free_[tag].pop_back();
+  }
+  // The concurrent readers of the recycled record detect the update with the sequence
+  uint64_t seq = record->seq_.load(std::memory_order_relaxed);
+  record->seq_.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (uint32_t i = 0; i < count; ++i) {
+    record->ranges_[i].start_.store(ranges[i].start_, std::memory_order_relaxed);
+    record->ranges_[i].end_.store(ranges[i].end_, std::memory_order_relaxed);
+    record->ranges_[i].value_.store(ranges[i].value_, std::memory_order_relaxed);
+  }
+  record->count_.store(count, std::memory_order_relaxed);
+  record->seq_.store(seq + 2, std::memory_order_release);
+  return reinterpret_cast<uintptr_t>(record) | tag;
+}
+
+template <typename T> inline void ConcurrentRangeMap<T>::retire(uintptr_t record) {
+  free_[record & kTagMask].push_back(reinterpret_cast<void*>(record & ~kTagMask));
+}
+
+template <typename T>
+inline void ConcurrentRangeMap<T>::updatePage(std::atomic<uintptr_t>* slot, uintptr_t page) {
+  const uintptr_t page_end = page + (uintptr_t(1) << kPageShift);
+  PlainRange ranges[kMaxRanges];
+  uint32_t count = 0;
+  bool overflow = false;
+  // Only the last indexed range, which begins before the page, can cover the page start.
+  // An unindexed range can begin after it, hence it isn't the previous range in the map
+  auto it = lastIndexed(page);
+  if (it == ranges_.end()) {
+    it = ranges_.lower_bound(page);
+  }
+  for (; (it != ranges_.end()) && (it->first < page_end); ++it) {
+    if (!it->second.indexed_ || (it->second.end_ <= page)) {
+      continue;
+    }
+    if (count == kMaxRanges) {
+      overflow = true;
+      break;
+    }
+    ranges[count++] = {it->first, it->second.end_, it->second.value_};
+  }
+
+  uintptr_t value = 0;
+  if (overflow) {
+    value = kOverflow;
+  } else if (count == 1) {
+    value = makeRecord<1>(ranges, count);
+  } else if (count > 1) {
+    value = (count <= 4) ? makeRecord<4>(ranges, count) : makeRecord<kMaxRanges>(ranges, count);
+  }
+  uintptr_t old = slot->load(std::memory_order_relaxed);
+  slot->store(value, std::memory_order_release);
+  if ((old != 0) && (old != kOverflow)) {
+    retire(old);
+  }
+}
+
+template <typename T>
+inline void ConcurrentRangeMap<T>::update(Node* node, uint32_t level, uintptr_t base,
+                                          uintptr_t start, Entry* entry, bool map) {
+  const uint32_t shift = shiftOf(level);
+  const uintptr_t span = uintptr_t(1) << shift;
+  const uintptr_t node_end = base + (span << kLevelBits);
+  const uintptr_t end = entry->end_;
+  for (uintptr_t slot_base = std::max(base, start & ~(span - 1));
+       (slot_base < end) && (slot_base < node_end); slot_base += span) {
+    std::atomic<uintptr_t>* slot = &node->slots_[(slot_base >> shift) & (kSlots - 1)];
+    uintptr_t value = slot->load(std::memory_order_relaxed);
+    if (isNode(value)) {
+      update(reinterpret_cast<Node*>(value), level + 1, slot_base, start, entry, map);
+    } else if ((start <= slot_base) && (end >= slot_base + span)) {
+      // The slot is fully covered, hence it references the range record
+      if (map && (entry->record_ == 0)) {
+        PlainRange range = {start, end, entry->value_};
+        entry->record_ = makeRecord<1>(&range, 1);
+      }
+      slot->store(map ? entry->record_ : 0, std::memory_order_release);
+    } else if (level == kLevels - 1) {
+      updatePage(slot, slot_base);
+    } else if (map) {
+      Node* child = allocNode();
+      update(child, level + 1, slot_base, start, entry, map);
+      // Publish the child after it's complete
+      slot->store(reinterpret_cast<uintptr_t>(child), std::memory_order_release);
+    }
+  }
+}
+
+template <typename T>
+inline void ConcurrentRangeMap<T>::updateOverflow(OverflowNode* node, uint32_t level,
+                                                  uintptr_t base, uintptr_t start,
+                                                  uintptr_t end, bool add) {
+  const uint32_t shift = shiftOf(level);
+  const uintptr_t span = uintptr_t(1) << shift;
+  const uintptr_t node_end = base + (span << kLevelBits);
+  for (uintptr_t slot_base = std::max(base, start & ~(span - 1));
+       (slot_base < end) && (slot_base < node_end); slot_base += span) {
+    const size_t i = (slot_base >> shift) & (kSlots - 1);
+    if (((start <= slot_base) && (end >= slot_base + span)) || (level == kLevels - 1)) {
+      // The slot is fully covered or it's a page, hence the whole slot overflows.
+      // The removal walks the same slots as the insertion
+      node->counts_[i] = add ? (node->counts_[i] + 1) : (node->counts_[i] - 1);
+    } else {
+      if (node->children_[i] == nullptr) {
+        node->children_[i] = allocOverflowNode();
+      }
+      updateOverflow(node->children_[i], level + 1, slot_base, start, end, add);
+    }
+    // Publish the child after it's complete
+    const uintptr_t child = reinterpret_cast<uintptr_t>(node->children_[i]);
+    node->slots_[i].store((node->counts_[i] != 0) ? kOverflow : child, std::memory_order_release);
+  }
+}
+
+template <typename T>
+inline void ConcurrentRangeMap<T>::insert(uintptr_t start, uintptr_t end, T* value) {
+  bool indexed = (start < end) && (end <= kMaxAddress);
+  // The overlapping ranges can't be indexed
+  auto next = ranges_.lower_bound(start);
+  if ((next != ranges_.end()) && (next->first < end)) {
+    indexed = false;
+  }
+  if ((next != ranges_.begin()) && (std::prev(next)->second.end_ > start)) {
+    indexed = false;
+  }
+  // An indexed range can cover an unindexed one before the start
+  auto prev = lastIndexed(start);
+  if ((prev != ranges_.end()) && (prev->second.end_ > start)) {
+    indexed = false;
+  }
+  auto it = ranges_.insert(next, {start, Entry{end, value, 0, indexed, 0}});
+  if (indexed) {
+    update(root_, 0, 0, start, &it->second, true);
+  } else if (start < kMaxAddress) {
+    // The lookups after the start resolve to this range or a later one, hence the rest of
+    // the indexed range, which covers the start, is shadowed too
+    uintptr_t shadow = end;
+    if ((prev != ranges_.end()) && (prev->second.end_ > start)) {
+      shadow = std::max(shadow, prev->second.end_);
+    }
+    it->second.shadow_ = std::min(shadow, kMaxAddress);
+    if (start < it->second.shadow_) {
+      updateOverflow(overflow_, 0, 0, start, it->second.shadow_, true);
+    }
+  }
+}
+
+template <typename T> inline void ConcurrentRangeMap<T>::remove(uintptr_t start) {
+  auto it = ranges_.find(start);
+  if (it == ranges_.end()) {
+    return;
+  }
+  Entry entry = it->second;
+  ranges_.erase(it);
+  if (entry.indexed_) {
+    update(root_, 0, 0, start, &entry, false);
+    if (entry.record_ != 0) {
+      retire(entry.record_);
+    }
+  } else if (start < entry.shadow_) {
+    updateOverflow(overflow_, 0, 0, start, entry.shadow_, false);
+  }
+}
+
+template <typename T>
+template <uint32_t N>
+inline bool ConcurrentRangeMap<T>::readRecord(const std::atomic<uintptr_t>* slot, uintptr_t value,
+                                              uintptr_t address, T** found, uintptr_t* start) {
+  const Record<N>* record = reinterpret_cast<const Record<N>*>(value & ~kTagMask);
+  const uint64_t seq = record->seq_.load(std::memory_order_acquire);
+  if ((seq & 1) != 0) {
+    return false;
+  }
+  T* result = nullptr;
+  uintptr_t base = 0;
+  const uint32_t count = std::min<uint32_t>(record->count_.load(std::memory_order_relaxed), N);
+  for (uint32_t i = 0; i < count; ++i) {
+    const uintptr_t range_start = record->ranges_[i].start_.load(std::memory_order_relaxed);
+    if ((address >= range_start) &&
+        (address < record->ranges_[i].end_.load(std::memory_order_relaxed))) {
+      result = record->ranges_[i].value_.load(std::memory_order_relaxed);
+      base = range_start;
+      break;
+    }
+  }
+  // The record must be unchanged and still linked, otherwise it could be recycled for
+  // another page during the read
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if ((slot->load(std::memory_order_acquire) != value) ||
+      (record->seq_.load(std::memory_order_relaxed) != seq)) {
+    return false;
+  }
+  *found = result;
+  *start = base;
+  return true;
+}
+
+template <typename T> inline bool ConcurrentRangeMap<T>::isOverflow(uintptr_t address) const {
+  const OverflowNode* node = overflow_;
+  for (uint32_t level = 0; level < kLevels; ++level) {
+    const uintptr_t value =
+        node->slots_[(address >> shiftOf(level)) & (kSlots - 1)].load(std::memory_order_acquire);
+    if (!isNode(value)) {
+      return value == kOverflow;
+    }
+    node = reinterpret_cast<const OverflowNode*>(value);
+  }
+  return false;
+}
+
+template <typename T>
+inline bool ConcurrentRangeMap<T>::find(uintptr_t address, T** value, uintptr_t* start) const {
+  if ((address >= kMaxAddress) || isOverflow(address)) {
+    return false;
+  }
+  for (;;) {
+    const Node* node = root_;
+    const std::atomic<uintptr_t>* slot = nullptr;
+    uintptr_t entry = 0;
+    for (uint32_t level = 0; level < kLevels; ++level) {
+      slot = &node->slots_[(address >> shiftOf(level)) & (kSlots - 1)];
+      entry = slot->load(std::memory_order_acquire);
+      if (!isNode(entry)) {
+        break;
+      }
+      node = reinterpret_cast<const Node*>(entry);
+    }
+    bool done = true;
+    switch (entry & kTagMask) {
+      case 0:
+        // An empty slot
+        *value = nullptr;
+        break;
+      case tagOf(1):
+        done = readRecord<1>(slot, entry, address, value, start);
+        break;
+      case tagOf(4):
+        done = readRecord<4>(slot, entry, address, value, start);
+        break;
+      case tagOf(kMaxRanges):
+        done = readRecord<kMaxRanges>(slot, entry, address, value, start);
+        break;
+      default:
+        // The page has too many ranges
+        return false;
+    }
+    if (done) {
+      return true;
+    }
+  }
+}
+
+}  // namespace amd
+
+#endif /*RANGEMAP_HPP_*/